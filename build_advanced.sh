@@ -24,6 +24,22 @@ gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/gi.c -o build/gi.o
 gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/audio.c -o build/audio.o
 gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/scripting.c -o build/scripting.o
 gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/compute.c -o build/compute.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/replay.c -o build/replay.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/snapshot.c -o build/snapshot.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/navigation.c -o build/navigation.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/query.c -o build/query.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/entity.c -o build/entity.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/framegraph.c -o build/framegraph.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/arena.c -o build/arena.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/memory.c -o build/memory.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/pipeline.c -o build/pipeline.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/present.c -o build/present.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/pacing.c -o build/pacing.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/scene.c -o build/scene.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/profiler.c -o build/profiler.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/telemetry.c -o build/telemetry.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/debug_view.c -o build/debug_view.o
+gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/flight_recorder.c -o build/flight_recorder.o
 gcc -Iinclude -O3 -march=native -ffast-math -pthread -c src/main.c -o build/main.o
 
 echo "Linking executable..."
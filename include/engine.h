@@ -3,11 +3,17 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <math.h>
 
-// Configuration constants
+// Configuration constants. The internal resolution can be set at build
+// time (make RESOLUTION=WxH).
+#ifndef SCREEN_WIDTH
 #define SCREEN_WIDTH 1280
+#endif
+#ifndef SCREEN_HEIGHT
 #define SCREEN_HEIGHT 720
+#endif
 #define FOV 60.0
 #define MAX_RENDER_DISTANCE 50.0
 #define TEXTURE_SIZE 64
@@ -15,16 +21,24 @@
 #define MAP_WIDTH 64
 #define MAP_HEIGHT 64
 #define SHADOW_MAP_SIZE 512
-#define MAX_LIGHTS 16
-#define MAX_SPRITES 256
-#define MAX_PARTICLES 2048
 #define PHYSICS_SUBSTEPS 4
+#define MAX_PHYSICS_BODIES 256
+#define PHYSICS_SLEEP_VELOCITY 0.05f
+#define PHYSICS_SLEEP_TIME 0.5f
+#define MAP_CHANGE_LOG_SIZE 256
+#define ENTITY_INITIAL_CAPACITY 64
+#define SIMULATION_RATE 60.0f
+#define MAX_TICKS_PER_FRAME 8
+#define NAV_MAX_FLOW_FIELDS 8
+#define NAV_MAX_CACHED_PATHS 32
+#define NAV_MAX_PATH_POINTS 128
+#define NAV_FIELD_LIFETIME 120
 
 // Advanced features configuration
-#define MAX_THREADS 4
+#define MAX_THREADS 4            // Default worker pool size, caller included
+#define THREADING_MAX_THREADS 64
 #define IRRADIANCE_PROBES 64
-#define MAX_AUDIO_SOURCES 32
-#define MAX_SCRIPTS 64
+#define MAX_AUDIO_BUFFERS 32
 
 // Vector and matrix structures
 typedef struct {
@@ -72,7 +86,7 @@ typedef struct {
     float flickering;
 } Light;
 
-// Sprite system
+// Sprite description, passed to sprite_create
 typedef struct {
     Vec2 position;
     float z_height;
@@ -86,16 +100,66 @@ typedef struct {
     float animation_speed;
 } Sprite;
 
-// Particle system
+// Stable reference to a pooled entity: slot index plus generation, 0 is null
+typedef uint32_t EntityHandle;
+#define ENTITY_NULL 0u
+#define ENTITY_INDEX_BITS 20
+
+// Slot table mapping handles to packed component rows
+typedef struct {
+    uint32_t* generation;   // Per slot
+    int* row;               // Slot -> row, -1 if the slot is free
+    int* slot;              // Row -> slot
+    int* free_slots;
+    int free_count;
+    int slot_count;
+    int slot_capacity;
+} EntityIndex;
+
+// Sprite components, one packed row per sprite. Sorting, culling and
+// interpolation touch only the transform columns.
 typedef struct {
-    Vec3 position;
-    Vec3 velocity;
-    ColorF color;
-    float lifetime;
-    float size;
-    float gravity_scale;
     int texture_id;
-} Particle;
+    Vec2 scale;
+    ColorF tint;
+    float rotation;
+    bool billboarding;
+    bool cast_shadow;
+} SpriteVisual;
+
+typedef struct {
+    int frame;
+    float speed;
+} SpriteAnimation;
+
+typedef struct {
+    EntityIndex index;
+    int count;
+    int capacity;
+    Vec2* position;
+    Vec2* prev_position;    // Position at the previous tick
+    float* z_height;
+    SpriteVisual* visual;
+    SpriteAnimation* animation;
+    int* order;             // Rows back to front, rebuilt each frame
+    EntityHandle* animated; // Sprites with a running animation
+    int animated_count;
+    int animated_capacity;
+} SpriteStore;
+
+// Particle components, one packed row per live particle
+typedef struct {
+    int count;
+    int capacity;
+    Vec3* position;
+    Vec3* prev_position;
+    Vec3* velocity;
+    ColorF* color;
+    float* lifetime;
+    float* size;
+    float* gravity_scale;
+    int* texture_id;
+} ParticleStore;
 
 // Physics collision
 typedef struct {
@@ -105,6 +169,10 @@ typedef struct {
     float friction;
     float bounce;
     bool affected_by_gravity;
+    bool sleeping;
+    float sleep_timer;
+    int contact_count;
+    int island;
 } PhysicsBody;
 
 // Ray data structure
@@ -121,6 +189,7 @@ typedef struct {
     float z_height;
     bool hit_door;
     int door_state;
+    int steps;                  // Map cells visited by the DDA walk
 } Ray;
 
 // Door system
@@ -141,6 +210,18 @@ typedef struct {
     float end_distance;
 } Fog;
 
+// Physics world with sleeping bodies grouped into islands
+typedef struct {
+    PhysicsBody bodies[MAX_PHYSICS_BODIES];
+    int body_count;
+    float sleep_velocity;
+    float sleep_time;
+    uint32_t map_revision;
+    int active_count;
+    int sleeping_count;
+    int island_count;
+} PhysicsWorld;
+
 // Player camera
 typedef struct {
     Vec2 position;
@@ -155,6 +236,11 @@ typedef struct {
     PhysicsBody physics;
 } Camera;
 
+// Map cell change record
+typedef struct {
+    int16_t x, y;
+} MapChange;
+
 // World map data
 typedef struct {
     int tiles[MAP_HEIGHT][MAP_WIDTH];
@@ -165,15 +251,64 @@ typedef struct {
     int wall_textures[MAP_HEIGHT][MAP_WIDTH];
     Door doors[64];
     int door_count;
+    int active_doors[64];       // Doors currently opening or closing
+    int active_door_count;
+    
+    // Ring of recently changed cells; consumers remember the revision they saw
+    MapChange change_log[MAP_CHANGE_LOG_SIZE];
+    uint32_t revision;
 } WorldMap;
 
+// Player input consumed by the next simulation tick
+#define INPUT_FORWARD   (1u << 0)
+#define INPUT_BACKWARD  (1u << 1)
+#define INPUT_LEFT      (1u << 2)
+#define INPUT_RIGHT     (1u << 3)
+#define INPUT_CROUCH    (1u << 4)
+#define INPUT_USE       (1u << 5)
+#define INPUT_EMIT      (1u << 6)
+#define INPUT_ONESHOT_MASK (INPUT_USE | INPUT_EMIT)
+
+#define TOGGLE_BLOOM        (1u << 0)
+#define TOGGLE_MOTION_BLUR  (1u << 1)
+#define TOGGLE_VIGNETTE     (1u << 2)
+#define TOGGLE_FXAA         (1u << 3)
+
+typedef struct {
+    uint32_t buttons;
+    int32_t mouse_dx;
+    int32_t mouse_dy;
+    uint32_t toggles;
+} InputFrame;
+
+// Input recording and deterministic replay
+typedef enum {
+    REPLAY_OFF,
+    REPLAY_RECORDING,
+    REPLAY_PLAYING
+} ReplayMode;
+
+typedef struct {
+    ReplayMode mode;
+    void* file;
+    InputFrame last;
+    uint32_t repeat_count;
+    uint64_t tick;
+    bool finished;
+} Replay;
+
+// Destination for finished pixels, e.g. locked texture memory
+typedef struct {
+    uint32_t* pixels;
+    int pitch;                  // Bytes per row
+} RenderTarget;
+
 // Render buffers
 typedef struct {
     float* z_buffer;
     uint32_t* color_buffer;
-    float* shadow_buffer;
     uint8_t* light_buffer;
-    uint32_t* post_process_buffer;
+    RenderTarget output;        // If set, the last post pass writes the frame here
 } RenderBuffers;
 
 // Post-processing effects
@@ -209,8 +344,15 @@ typedef struct {
     int job_count;
     RenderJob jobs[MAX_THREADS];
     void* thread_handles[MAX_THREADS];
+    
+    // Persistent workers started by threading_init
+    void* workers;
+    int worker_count;
 } ThreadPool;
 
+// Processes items [begin, end) of a parallel_for batch
+typedef void (*ParallelTask)(void* context, int begin, int end);
+
 // --- PBR (Physically-Based Rendering) ---
 typedef struct {
     ColorF albedo;
@@ -298,6 +440,327 @@ typedef struct {
     uint32_t* output_buffer;
 } ComputeContext;
 
+// --- Navigation ---
+#define NAV_THROUGH_DOORS (1u << 0)   // Closed doors count as passable
+#define NAV_UNREACHABLE UINT32_MAX
+
+typedef struct {
+    Vec2 points[NAV_MAX_PATH_POINTS];   // Cell centres, start and goal included
+    int count;
+    float length;
+} NavPath;
+
+// Cost-to-goal field shared by any number of agents heading to one cell
+typedef struct {
+    bool in_use;
+    bool dirty;
+    int goal_x, goal_y;
+    uint32_t flags;
+    uint64_t last_used_tick;
+    uint32_t* distance;     // Tenths of a cell, NAV_UNREACHABLE if no route
+    int8_t* direction;      // Neighbour to move to, -1 at the goal or unreachable
+    int* heap;              // Build scratch
+    int* heap_index;
+} NavFlowField;
+
+typedef struct {
+    bool valid;
+    int start, goal;
+    uint32_t flags;
+    uint64_t last_used_tick;
+    NavPath path;
+} NavPathEntry;
+
+typedef struct {
+    uint8_t* walkable[2];   // Per door mode: doors must be open / may be opened
+    bool door_open[64];
+    int door_count;
+    uint32_t map_revision;
+    
+    NavFlowField fields[NAV_MAX_FLOW_FIELDS];
+    NavPathEntry* paths;
+    
+    // Path search scratch
+    uint32_t* cost;
+    uint32_t* score;
+    int* parent;
+    uint8_t* closed;
+    int* heap;
+    int* heap_index;
+    
+    uint32_t field_builds;
+    uint32_t path_queries;
+    uint32_t path_cache_hits;
+} Navigation;
+
+// --- World Queries ---
+#define QUERY_DOORS (1u << 0)   // Closed doors block segments
+
+typedef struct {
+    Vec2 origin;
+    Vec2 target;
+} QuerySegment;
+
+typedef struct {
+    bool hit;               // Segment blocked before reaching its target
+    int cell_x, cell_y;     // First solid cell, if hit
+    float distance;         // Distance to the hit, or segment length
+} QueryHit;
+
+// --- State Snapshots ---
+typedef struct {
+    size_t bytes;
+    double capture_ms;
+    double restore_ms;
+} SnapshotStats;
+
+// --- Aligned Memory ---
+#define MEMORY_ALIGNMENT 64         // Cache line; also covers SSE/AVX loads
+#define MEMORY_HUGE_PAGES 0x01      // Back large blocks with 2 MB pages when possible
+#define MEMORY_ZERO 0x02            // Clear the block, like calloc
+
+// Subsystem charged for an allocation
+typedef enum {
+    MEMORY_TAG_RENDER,          // Frame, depth and light buffers, frames in flight
+    MEMORY_TAG_TEXTURES,
+    MEMORY_TAG_FRAME_ARENA,
+    MEMORY_TAG_COMPUTE,
+    MEMORY_TAG_AUDIO,           // Sound buffers; shared by all engines
+    MEMORY_TAG_ENTITIES,        // Sprite, particle, light, audio source and script storage
+    MEMORY_TAG_NAVIGATION,
+    MEMORY_TAG_SCRIPTS,         // Script property strings
+    MEMORY_TAG_SNAPSHOTS,
+    MEMORY_TAG_THREADS,         // Worker pools, simulation and render thread state
+    MEMORY_TAG_DIAGNOSTICS,     // Profiler, telemetry, flight recorder, benchmarks
+    MEMORY_TAG_COUNT
+} MemoryTag;
+
+typedef struct {
+    int64_t live_bytes;
+    int64_t peak_bytes;
+    int64_t blocks;                 // Live allocations
+    int64_t allocations;            // Made since start
+    int64_t allocated_bytes;        // Allocated since start
+} MemoryTagStats;
+
+typedef struct {
+    MemoryTagStats tags[MEMORY_TAG_COUNT];
+    double taken_ms;
+} MemoryReport;
+
+typedef struct {
+    int64_t live_bytes;
+    int64_t huge_page_bytes;        // Explicit huge page mappings
+    int64_t transparent_bytes;      // Blocks advised for transparent huge pages
+    int64_t allocations;
+} MemoryStats;
+
+// --- Frame Arena ---
+#define FRAME_ARENA_ALIGNMENT MEMORY_ALIGNMENT
+
+typedef struct {
+    size_t capacity;
+    size_t peak_bytes;          // Largest amount live at once this frame
+    int allocations;            // Scratch requests this frame
+    int heap_allocations;       // Block growth and overflow this frame
+} FrameArenaStats;
+
+// Transient scratch memory, rewound after every frame graph level
+typedef struct {
+    uint8_t* base;
+    size_t capacity;
+    size_t offset;
+    void* overflow;             // Heap blocks for requests that did not fit
+    FrameArenaStats stats;
+} FrameArena;
+
+// --- Frame Graph ---
+#define FRAME_MAX_PASSES 32
+#define FRAME_MAX_CHUNKS 256
+
+// Frame resources a render pass may read or write
+#define FRAME_RESOURCE_COLOR         (1u << 0)
+#define FRAME_RESOURCE_DEPTH         (1u << 1)
+#define FRAME_RESOURCE_SPRITE_ORDER  (1u << 2)
+#define FRAME_RESOURCE_PROBES        (1u << 3)
+
+// Runs items [begin, end) of a pass; passes with one item ignore the range
+typedef void (*FramePassFunction)(struct Engine* engine, int begin, int end);
+
+// Called on the executing thread after each enabled pass's level has
+// finished, in pass order; the frame buffers hold that level's result
+typedef void (*FramePassObserver)(void* context, struct Engine* engine, int pass);
+
+typedef struct {
+    const char* name;
+    uint32_t reads;
+    uint32_t writes;
+    int items;              // Independent work items, split across workers by grain
+    int grain;
+    FramePassFunction run;
+    bool enabled;
+    
+    // Filled in by the scheduler
+    uint32_t depends;       // Earlier passes this one must wait for
+    int level;
+    bool critical;          // On the longest dependency chain this frame
+    double start_ms;
+    double end_ms;
+} FramePass;
+
+typedef struct {
+    int pass;
+    int begin;
+    int end;
+    double start_ms;
+    double end_ms;
+} FrameChunk;
+
+typedef struct {
+    FramePass passes[FRAME_MAX_PASSES];
+    int pass_count;
+    int level_count;
+    int executed;
+    FrameChunk chunks[FRAME_MAX_CHUNKS];
+    double total_ms;
+    double critical_path_ms;
+    FrameArenaStats arena;      // Transient memory used by this frame
+    
+    // Optional, kept across frames; used by the golden-image gate
+    FramePassObserver observer;
+    void* observer_context;
+} FrameGraph;
+
+// --- Simulation Pipeline ---
+#define RENDER_STATE_SLOTS 3
+
+// Render-relevant copy of one simulation tick. The simulation thread fills
+// a free slot and publishes it; the render thread draws the latest one.
+typedef struct {
+    uint64_t tick;
+    double publish_ms;          // When the tick was published
+    float sim_accumulator;      // Time carried past the tick at publication
+    float script_ms;            // Script time of the ticks since the last publication
+    float fixed_dt;
+    float time_accumulator;
+    Camera camera;
+    Camera prev_camera;
+    Fog fog;
+    PostProcessing post_fx;
+    WorldMap world;
+    Texture textures[MAX_TEXTURES];
+    int texture_count;
+    Light* lights;
+    int light_count;
+    int light_capacity;
+    SpriteStore sprites;        // Component rows only; no handles
+    ParticleStore particles;
+    bool use_gi;
+    IrradianceProbe gi_probes[IRRADIANCE_PROBES];
+    int probe_count;
+} RenderState;
+
+typedef struct {
+    uint64_t published;         // Ticks handed to the renderer
+    uint64_t rendered;          // Frames drawn from a published tick
+    uint64_t repeated;          // Frames that found no newer tick
+    double update_ms;           // Simulation time spent, including capture
+} SimPipelineStats;
+
+// Simulation thread feeding a render thread through a triple buffer
+typedef struct {
+    RenderState slots[RENDER_STATE_SLOTS];
+    int write_slot;             // Owned by the simulation thread
+    int ready_slot;             // Last published, flagged until the renderer takes it
+    int read_slot;              // Owned by the render thread
+    struct Engine* engine;
+    void* thread;
+    bool running;
+    SimPipelineStats stats;
+} SimPipeline;
+
+// --- Presentation Queue ---
+#define PRESENT_MAX_FRAMES 3
+
+// One colour target cycling between the render thread and the presenter.
+// The presenter may point `target` at new memory while it holds the frame.
+typedef struct {
+    RenderTarget target;
+    int index;
+    uint64_t number;
+    double begin_ms;            // Rendering started
+    double ready_ms;            // Rendering finished
+} PresentFrame;
+
+typedef struct {
+    uint64_t frames;            // Frames presented
+    double latency_ms;          // Sum of render start to present
+    double max_latency_ms;
+    double wait_ms;             // Render thread blocked on a free target
+    double first_ms;
+    double last_ms;
+} PresentStats;
+
+// Renders one frame into frame->target; runs on the render thread
+typedef void (*PresentRenderFunction)(void* context, PresentFrame* frame);
+
+// Render thread producing frames ahead of presentation
+typedef struct {
+    PresentFrame frames[PRESENT_MAX_FRAMES];
+    int frames_in_flight;
+    int ready[PRESENT_MAX_FRAMES];      // Rendered, oldest first
+    int ready_count;
+    int free[PRESENT_MAX_FRAMES];
+    int free_count;
+    uint32_t* storage[PRESENT_MAX_FRAMES];  // Targets allocated by the queue
+    PresentRenderFunction render;
+    void* context;
+    void* thread;
+    bool running;
+    PresentStats stats;
+} PresentQueue;
+
+// --- Render-Cost Debug Views ---
+typedef enum {
+    DEBUG_VIEW_NONE,
+    DEBUG_VIEW_DDA_STEPS,       // Map cells each column's ray visited
+    DEBUG_VIEW_OVERDRAW,        // Floor, ceiling, wall, sprite and particle writes per pixel
+    DEBUG_VIEW_LIGHT_COST,      // Light loop iterations plus shadow march steps per pixel
+    DEBUG_VIEW_COUNT
+} DebugView;
+
+// --- Frame Pacing ---
+#define LATENCY_SAMPLES 4096
+#define LATENCY_PENDING 64
+
+// Deadline scheduler: sleeps to just short of each frame's deadline, then
+// spins the rest, learning how late the OS wakes it up
+typedef struct {
+    double period_ms;           // 0 disables pacing
+    double deadline_ms;         // Start of the next frame
+    double spin_ms;             // Tail spun instead of slept
+    uint64_t frames;
+    uint64_t missed;            // Frames that overran their deadline
+    double error_ms;            // Sum of |wake - deadline| for paced frames
+    double max_error_ms;
+} FramePacer;
+
+// Input-to-photon latency: when input events arrive and when the first
+// frame that could show them reaches the screen
+typedef struct {
+    double pending[LATENCY_PENDING];    // Input times not yet shown, oldest first
+    int pending_count;
+    float samples[LATENCY_SAMPLES];     // Most recent latencies, in ms
+    int sample_count;
+    int next_sample;
+    uint64_t frames;            // Frames that showed new input
+    uint64_t dropped;           // Input stamps lost to a full pending list
+} LatencyTracker;
+
+// Folds mouse motion that arrived since the frame's input was read into
+// `pending`, just before the frame is cast
+typedef void (*LateLatchFunction)(void* context, InputFrame* pending);
+
 // =============================================================================
 // MAIN ENGINE STATE
 // =============================================================================
@@ -307,12 +770,16 @@ typedef struct Engine {
     WorldMap world;
     Texture textures[MAX_TEXTURES];
     int texture_count;
-    Light lights[MAX_LIGHTS];
+    Light* lights;
     int light_count;
-    Sprite sprites[MAX_SPRITES];
-    int sprite_count;
-    Particle particles[MAX_PARTICLES];
-    int particle_count;
+    int light_capacity;
+    int* flickering_lights;     // Indices of lights with flickering > 0
+    int flickering_light_count;
+    int flickering_light_capacity;
+    SpriteStore sprites;
+    ParticleStore particles;
+    PhysicsWorld physics_world;
+    Navigation navigation;
     RenderBuffers buffers;
     Fog fog;
     PostProcessing post_fx;
@@ -321,6 +788,18 @@ typedef struct Engine {
     uint64_t frame_count;
     float time_accumulator;
     
+    // Fixed-timestep simulation
+    uint32_t seed;
+    uint32_t rng_state;
+    Replay replay;
+    InputFrame input;
+    float fixed_dt;
+    float sim_accumulator;
+    uint64_t tick_count;
+    float script_ms;            // Script time in the ticks of the last update
+    float interpolation_alpha;
+    Camera prev_camera;
+    
     // Advanced features
     bool use_multithreading;
     ThreadPool thread_pool;
@@ -329,13 +808,25 @@ typedef struct Engine {
     IrradianceProbe gi_probes[IRRADIANCE_PROBES];
     int probe_count;
     
-    AudioSource audio_sources[MAX_AUDIO_SOURCES];
+    AudioSource* audio_sources;
     int audio_source_count;
+    int audio_source_capacity;
     
-    Script scripts[MAX_SCRIPTS];
+    Script* scripts;
     int script_count;
+    int script_capacity;
     
     ComputeContext compute_ctx;
+    
+    SnapshotStats snapshot_stats;
+    LateLatchFunction late_latch;   // Optional; view rotation re-sampled at render
+    void* late_latch_context;
+    FrameGraph frame_graph;
+    FrameArena frame_arena;
+    
+    DebugView debug_view;       // Shown instead of the image; render only
+    uint16_t* debug_counts;     // Per pixel, while a view is on
+    int debug_scale;            // Count drawn as white in the last frame
 } Engine;
 
 // =============================================================================
@@ -344,8 +835,14 @@ typedef struct Engine {
 
 // Core engine functions
 void engine_init(Engine* engine);
+void engine_init_seeded(Engine* engine, uint32_t seed);
+uint32_t engine_random(Engine* engine);
+float engine_random_float(Engine* engine);
 void engine_cleanup(Engine* engine);
 void engine_update(Engine* engine, float delta_time);
+void engine_step(Engine* engine, float delta_time);
+void engine_set_tick_rate(Engine* engine, float ticks_per_second);
+Camera engine_interpolated_camera(Engine* engine);
 void engine_render(Engine* engine);
 
 // Math utilities
@@ -393,9 +890,9 @@ void apply_fog(Engine* engine);
 void post_process_bloom(Engine* engine);
 void post_process_motion_blur(Engine* engine);
 void post_process_chromatic_aberration(Engine* engine);
-void post_process_fxaa(Engine* engine);
-void post_process_tone_mapping(Engine* engine);
-void post_process_vignette(Engine* engine);
+void post_process_fxaa(Engine* engine, RenderTarget target);
+void post_process_tone_mapping(Engine* engine, RenderTarget target);
+void post_process_vignette(Engine* engine, RenderTarget target);
 
 // Physics and collision
 bool physics_check_collision(Engine* engine, Vec2 position, float radius);
@@ -403,16 +900,33 @@ void physics_resolve_collision(PhysicsBody* body, Vec2 normal, float penetration
 void physics_update(Engine* engine, PhysicsBody* body, float delta_time);
 void physics_apply_gravity(PhysicsBody* body, float delta_time);
 
+// Physics world (sleeping and simulation islands)
+void physics_world_init(PhysicsWorld* world);
+int physics_world_add_body(PhysicsWorld* world, PhysicsBody body);
+void physics_world_step(Engine* engine, float delta_time);
+void physics_wake_body(PhysicsWorld* world, int index);
+void physics_wake_area(PhysicsWorld* world, Vec2 center, float radius);
+void physics_apply_impulse(PhysicsWorld* world, int index, Vec2 impulse);
+
 // Door system
-void door_open(Door* door);
-void door_close(Door* door);
+void door_open(WorldMap* map, int index);
+void door_close(WorldMap* map, int index);
 void door_update(Door* door, float delta_time);
+void door_update_active(WorldMap* map, float delta_time);
 bool door_check_collision(Door* door, Vec2 position);
 
+// Input recording and replay
+bool replay_begin_record(Engine* engine, const char* filename);
+bool replay_read_seed(const char* filename, uint32_t* seed);
+bool replay_begin_playback(Engine* engine, const char* filename);
+void replay_tick(Engine* engine);
+void replay_close(Engine* engine);
+uint32_t replay_state_checksum(Engine* engine);
+
 // Sprite sorting and rendering
-void sprite_sort_by_distance(Sprite* sprites, int count, Vec2 camera_pos);
+void sprite_sort_by_distance(SpriteStore* sprites, Vec2 camera_pos);
 void sprite_render(Engine* engine, Sprite* sprite);
-void sprite_animate(Sprite* sprite, float delta_time);
+void sprite_animate(SpriteStore* sprites, float delta_time);
 
 // Particle effects
 void particle_emit(Engine* engine, Vec3 position, Vec3 velocity, ColorF color, float lifetime);
@@ -448,11 +962,17 @@ void camera_update_headbob(Camera* cam, float delta_time, bool moving);
 // Map utilities
 int map_get_tile(WorldMap* map, int x, int y);
 void map_set_tile(WorldMap* map, int x, int y, int value);
+void map_mark_changed(WorldMap* map, int x, int y);
+void map_invalidate_all(WorldMap* map);
+bool map_changes_overflowed(const WorldMap* map, uint32_t since);
 float map_get_floor_height(WorldMap* map, int x, int y);
 float map_get_ceiling_height(WorldMap* map, int x, int y);
 void map_load_from_file(WorldMap* map, const char* filename);
 void map_generate_procedural(WorldMap* map, uint32_t seed);
 
+// Scene setup
+void scene_load_demo(Engine* engine);
+
 // Optimization utilities
 void optimize_frustum_culling(Engine* engine);
 void optimize_occlusion_culling(Engine* engine);
@@ -492,6 +1012,170 @@ void profile_end(ProfileSection* section);
 void profile_reset(ProfileSection* section);
 float profile_get_ms(ProfileSection* section);
 
+// Scoped profiler (profiler.c). Scopes nest per thread and are recorded into
+// per-thread event buffers; build with ENGINE_PROFILER to enable them. In
+// other builds the macros expand to nothing.
+#define PROFILER_MAX_SCOPES 128
+
+// Hardware counters read around each scope (Linux, profiler_enable_counters)
+typedef enum {
+    PROFILER_CYCLES,
+    PROFILER_INSTRUCTIONS,
+    PROFILER_LLC_MISSES,
+    PROFILER_BRANCH_MISSES,
+    PROFILER_COUNTER_COUNT
+} ProfilerCounter;
+
+typedef struct {
+    const char* name;
+    double last_ms;             // Time in the scope during the last frame
+    double average_ms;          // Rolling average over recent frames
+    double max_ms;
+    double total_ms;
+    uint64_t calls;
+    uint64_t frames;            // Frames the scope appeared in
+    double counters[PROFILER_COUNTER_COUNT];   // Per frame, rolling average; 0 without counters
+} ProfilerScopeStats;
+
+void profiler_begin(const char* name);
+void profiler_end(void);
+void profiler_frame_end(void);
+int profiler_get_summary(ProfilerScopeStats* stats, int max_stats);
+void profiler_print_summary(void);
+bool profiler_write_trace(const char* filename);
+int profiler_append_trace_events(void* file, uint64_t since_ns, uint64_t base_ns);
+void profiler_reset(void);
+uint64_t profiler_now_ns(void);
+bool profiler_enable_counters(void);
+bool profiler_counters_active(void);
+
+#ifdef ENGINE_PROFILER
+#define PROFILE_BEGIN(name) profiler_begin(name)
+#define PROFILE_END() profiler_end()
+#define PROFILE_FRAME_END() profiler_frame_end()
+#else
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END() ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+#endif
+
+// Telemetry (telemetry.c): counters, gauges and log-linear histograms that
+// stay on in every build. Each thread writes into a shard of its own without
+// locks; snapshots sum the shards. Values are recorded as integers (times in
+// nanoseconds) and multiplied by the metric's scale on export.
+#define TELEMETRY_MAX_METRICS 128
+#define TELEMETRY_NAME_LENGTH 96
+#define TELEMETRY_SUB_BUCKET_BITS 5         // 32 buckets per power of two, ~3% error
+#define TELEMETRY_HISTOGRAM_BUCKETS 1024    // Covers values below 2^36 (68 s in ns)
+
+typedef enum {
+    TELEMETRY_COUNTER,
+    TELEMETRY_GAUGE,
+    TELEMETRY_HISTOGRAM
+} TelemetryKind;
+
+// Metrics registered up front, so hot paths need no lookup
+enum {
+    TELEMETRY_FRAMES,               // Frames presented
+    TELEMETRY_FRAME_TIME,           // Present to present, ns
+    TELEMETRY_RENDER_TIME,          // engine_render, ns
+    TELEMETRY_TICKS,                // Simulation ticks
+    TELEMETRY_SCRIPT_TIME,          // script_update_all per tick, ns
+    TELEMETRY_RAYS,                 // Wall rays cast
+    TELEMETRY_DDA_STEPS,            // Map cells visited by wall rays
+    TELEMETRY_LIGHTS_EVALUATED,     // Light contributions in the lighting pass
+    TELEMETRY_PARTICLES,            // Live particles
+    TELEMETRY_SPRITES,              // Live sprites
+    TELEMETRY_AUDIO_VOICES,         // Sources mixed by the last audio callback
+    TELEMETRY_BUILTIN_COUNT
+};
+
+typedef struct {
+    char name[TELEMETRY_NAME_LENGTH];   // Prometheus series, e.g. name{label="value"}
+    const char* help;
+    TelemetryKind kind;
+    double scale;               // Exported unit per recorded unit
+    uint64_t total;             // Counter total, or sum of histogram samples
+    double gauge;
+    uint64_t count;             // Histogram samples
+    uint64_t max;               // Largest sample (bucket bound after a subtract)
+    uint64_t* buckets;          // Histogram only, TELEMETRY_HISTOGRAM_BUCKETS counts
+} TelemetryMetric;
+
+typedef struct {
+    TelemetryMetric metrics[TELEMETRY_MAX_METRICS];
+    int metric_count;
+    double taken_ms;
+    uint64_t* storage;          // Bucket memory owned by the snapshot
+} TelemetrySnapshot;
+
+int telemetry_register(const char* name, const char* help, TelemetryKind kind, double scale);
+void telemetry_add(int metric, uint64_t amount);
+void telemetry_set(int metric, double value);
+void telemetry_record(int metric, uint64_t value);
+void telemetry_record_frame_graph(const FrameGraph* graph);
+bool telemetry_snapshot(TelemetrySnapshot* snapshot);
+void telemetry_snapshot_subtract(TelemetrySnapshot* snapshot, const TelemetrySnapshot* earlier);
+void telemetry_snapshot_free(TelemetrySnapshot* snapshot);
+double telemetry_percentile(const TelemetryMetric* metric, double percentile);
+double telemetry_mean(const TelemetryMetric* metric);
+size_t telemetry_format_prometheus(const TelemetrySnapshot* snapshot, char* buffer, size_t capacity);
+bool telemetry_export(const char* target);
+void telemetry_export_every(const char* target, double interval_ms);
+void telemetry_poll(double now_ms);
+
+// Flight recorder (flight_recorder.c): an always-on ring of per-frame
+// summaries. When a frame takes longer than the threshold, or a dump is
+// requested (SIGUSR1), the last few seconds are written as a Chrome trace
+// together with the profiler events of the same span.
+#define FLIGHT_MAX_FRAMES 1024
+#define FLIGHT_HISTORY_MS 5000.0
+
+typedef struct {
+    const char* name;
+    int index;                  // In the frame graph; the pass's track in a dump
+    float start_ms;             // From the frame's begin_ms
+    float duration_ms;
+} FlightPass;
+
+typedef struct {
+    uint64_t frame;
+    uint64_t tick;              // Replay log position of the rendered state
+    double begin_ms;            // End of the previous frame; sim_pipeline_now_ms clock
+    double end_ms;
+    float render_ms;            // Frame graph execution
+    float critical_ms;
+    float script_ms;
+    int particles;
+    int sprites;
+    int lights;
+    size_t arena_peak_bytes;
+    int arena_heap_allocations; // Frame arena growth, e.g. a bloom buffer that did not fit
+    int pass_count;
+    FlightPass passes[FRAME_MAX_PASSES];    // Enabled passes only
+} FlightFrame;
+
+typedef struct {
+    FlightFrame* frames;        // Ring of FLIGHT_MAX_FRAMES
+    int next;
+    int count;
+    double threshold_ms;        // Frame time that triggers a dump; 0 for requests only
+    double history_ms;          // Span written to a dump
+    double last_end_ms;
+    double quiet_until_ms;      // One automatic dump per history span
+    const char* directory;
+    const char* replay_file;    // Log being recorded or played, noted in dumps
+    uint32_t seed;
+    int dumps;
+} FlightRecorder;
+
+bool flight_recorder_init(FlightRecorder* recorder, double threshold_ms, const char* directory);
+void flight_recorder_cleanup(FlightRecorder* recorder);
+void flight_recorder_frame(FlightRecorder* recorder, const Engine* engine, double now_ms);
+bool flight_recorder_dump(FlightRecorder* recorder, const char* reason);
+void flight_recorder_request_dump(void);
+bool flight_recorder_install_signal(void);
+
 // =============================================================================
 // ADVANCED FEATURES - FUNCTION DECLARATIONS
 // =============================================================================
@@ -501,6 +1185,10 @@ void threading_init(ThreadPool* pool);
 void threading_cleanup(ThreadPool* pool);
 void* threading_render_job(void* arg);
 void threading_render_parallel(Engine* engine);
+void threading_set_thread_count(ThreadPool* pool, int thread_count);
+int threading_grain(const ThreadPool* pool, int count);
+void threading_parallel_for(ThreadPool* pool, int count, int grain, 
+                            ParallelTask task, void* context);
 
 // PBR
 void pbr_init_material(PBRMaterial* mat);
@@ -522,11 +1210,14 @@ void gi_propagate_light(Engine* engine);
 void audio_init(Engine* engine);
 void audio_cleanup(Engine* engine);
 void audio_update(Engine* engine);
+void audio_mix(Engine* engine, float* output, int sample_count);
 int audio_load_sound(const char* filename);
 void audio_play(AudioSource* source);
 void audio_stop(AudioSource* source);
 void audio_set_listener(Vec3 position, Vec3 forward, Vec3 up);
 void audio_update_3d(AudioSource* source, Vec3 listener_pos);
+void audio_lock(void);
+void audio_unlock(void);
 
 // Scripting
 void script_init(Engine* engine);
@@ -536,6 +1227,8 @@ void script_update_all(Engine* engine);
 ScriptValue script_call_function(Script* script, const char* func_name, 
                                  Engine* engine, ScriptValue* args, int arg_count);
 void script_register_function(const char* name, ScriptFunction func);
+int script_function_id(ScriptFunction func);
+ScriptFunction script_function_from_id(int id);
 ScriptValue script_create_value_number(float value);
 ScriptValue script_create_value_vector(Vec3 value);
 ScriptValue script_create_value_bool(bool value);
@@ -551,4 +1244,111 @@ void compute_dispatch_lighting(ComputeContext* ctx, Engine* engine);
 void compute_dispatch_post_process_simd(ComputeContext* ctx, uint32_t* input,
                                        uint32_t* output, int width, int height);
 
+// Entity storage
+bool entity_reserve(void** array, int* capacity, int needed, size_t element_size);
+void entity_cleanup(Engine* engine);
+bool entity_index_reserve(EntityIndex* index, int slots);
+void entity_index_rebuild_free_list(EntityIndex* index);
+EntityHandle sprite_create(Engine* engine, const Sprite* desc);
+void sprite_destroy(Engine* engine, EntityHandle handle);
+int sprite_row(const SpriteStore* sprites, EntityHandle handle);
+void sprite_set_animation_speed(Engine* engine, EntityHandle handle, float speed);
+bool sprite_store_reserve(SpriteStore* sprites, int capacity);
+bool particle_store_reserve(ParticleStore* particles, int capacity);
+void particle_store_remove(ParticleStore* particles, int row);
+int light_add(Engine* engine, const Light* light);
+void light_set_flickering(Engine* engine, int index, float flickering);
+void entity_rebuild_active_lists(Engine* engine);
+void sprite_store_copy_rows(SpriteStore* dst, const SpriteStore* src);
+void sprite_store_free(SpriteStore* sprites);
+void particle_store_copy(ParticleStore* dst, const ParticleStore* src);
+void particle_store_free(ParticleStore* particles);
+AudioSource* audio_source_add(Engine* engine);
+Script* script_add(Engine* engine);
+
+// Navigation
+void navigation_init(Engine* engine);
+void navigation_cleanup(Engine* engine);
+void navigation_sync(Engine* engine);
+void navigation_update(Engine* engine);
+bool nav_is_walkable(Engine* engine, int x, int y, uint32_t flags);
+bool nav_find_path(Engine* engine, Vec2 start, Vec2 goal, uint32_t flags, NavPath* path);
+int nav_flow_field(Engine* engine, int goal_x, int goal_y, uint32_t flags);
+Vec2 nav_flow_direction(Engine* engine, int field, Vec2 position);
+float nav_flow_distance(Engine* engine, int field, Vec2 position);
+
+// World queries
+void world_query_segments(Engine* engine, const QuerySegment* segments, QueryHit* results,
+                          int count, uint32_t flags);
+bool world_query_line_of_sight(Engine* engine, Vec2 from, Vec2 to, uint32_t flags);
+bool world_query_hitscan(Engine* engine, Vec2 origin, Vec2 direction, float range,
+                         uint32_t flags, QueryHit* hit);
+
+// State snapshots
+size_t engine_snapshot_size(Engine* engine);
+size_t engine_snapshot_save(Engine* engine, void* buffer, size_t capacity);
+bool engine_snapshot_load(Engine* engine, const void* buffer, size_t size);
+bool engine_snapshot_write_file(Engine* engine, const char* filename);
+bool engine_snapshot_read_file(Engine* engine, const char* filename);
+
+// Aligned memory
+void* memory_alloc(size_t size, uint32_t flags, MemoryTag tag);
+void* memory_realloc(void* ptr, size_t size, MemoryTag tag);
+void memory_free(void* ptr);
+void memory_get_stats(MemoryStats* stats);
+const char* memory_tag_name(MemoryTag tag);
+void memory_get_report(MemoryReport* report);
+void memory_print_report(const MemoryReport* report, const MemoryReport* earlier);
+bool memory_check_leaks(void);
+
+// Frame arena
+void frame_arena_begin(FrameArena* arena);
+void* frame_arena_alloc(FrameArena* arena, size_t size);
+size_t frame_arena_mark(FrameArena* arena);
+void frame_arena_release(FrameArena* arena, size_t mark);
+void frame_arena_cleanup(FrameArena* arena);
+
+// Frame graph
+void frame_graph_begin(FrameGraph* graph);
+int frame_graph_add_pass(FrameGraph* graph, const char* name, uint32_t reads, uint32_t writes,
+                         int items, int grain, FramePassFunction run, bool enabled);
+void frame_graph_execute(Engine* engine, FrameGraph* graph);
+void frame_graph_print(const FrameGraph* graph);
+
+// Simulation pipeline
+void render_state_capture(RenderState* state, Engine* engine);
+void render_state_apply(Engine* view, const RenderState* state, double now_ms);
+void render_state_free(RenderState* state);
+bool sim_pipeline_start(SimPipeline* pipeline, Engine* engine);
+void sim_pipeline_stop(SimPipeline* pipeline, Engine* view);
+void sim_pipeline_lock(SimPipeline* pipeline);
+void sim_pipeline_unlock(SimPipeline* pipeline);
+const RenderState* sim_pipeline_acquire(SimPipeline* pipeline);
+double sim_pipeline_now_ms(void);
+
+// Presentation queue
+bool present_queue_start(PresentQueue* queue, int frames_in_flight, const RenderTarget* targets,
+                         PresentRenderFunction render, void* context);
+void present_queue_stop(PresentQueue* queue);
+PresentFrame* present_queue_acquire(PresentQueue* queue, double timeout_ms);
+void present_queue_release(PresentQueue* queue, PresentFrame* frame);
+void present_queue_print_stats(const PresentQueue* queue);
+
+// Render-cost debug views
+const char* debug_view_name(DebugView view);
+DebugView debug_view_from_name(const char* name);
+bool debug_view_set(Engine* engine, DebugView view);
+uint16_t* debug_view_counts(Engine* engine, DebugView view);
+void debug_view_clear(Engine* engine);
+void debug_view_resolve(Engine* engine, RenderTarget target);
+
+// Frame pacing and latency
+void frame_pacer_init(FramePacer* pacer, double frames_per_second);
+void frame_pacer_wait(FramePacer* pacer);
+void frame_pacer_print_stats(const FramePacer* pacer);
+void latency_input(LatencyTracker* tracker, double input_ms);
+void latency_present(LatencyTracker* tracker, double frame_begin_ms, double present_ms);
+float latency_percentile(const LatencyTracker* tracker, float percentile);
+void latency_print_stats(const LatencyTracker* tracker);
+
 #endif // ENGINE_H
@@ -0,0 +1,95 @@
+#include "../include/engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-frame transient memory. Passes take scratch buffers from one block by
+// bumping an offset; the frame graph rewinds the offset after every level,
+// so buffers of passes that never run together share the same bytes.
+// Requests that do not fit are served from the heap for this frame only and
+// the block is grown to the frame's high-water mark at the next
+// frame_arena_begin, after which a steady frame does no heap allocation.
+
+typedef struct ArenaOverflow {
+    struct ArenaOverflow* next;
+} ArenaOverflow;
+
+static size_t frame_arena_round(size_t size) {
+    return (size + FRAME_ARENA_ALIGNMENT - 1) & ~(size_t)(FRAME_ARENA_ALIGNMENT - 1);
+}
+
+static void frame_arena_free_overflow(FrameArena* arena) {
+    ArenaOverflow* block = (ArenaOverflow*)arena->overflow;
+    while (block) {
+        ArenaOverflow* next = block->next;
+        memory_free(block);
+        block = next;
+    }
+    arena->overflow = NULL;
+}
+
+// Start a frame: release last frame's overflow and grow the block to fit it
+void frame_arena_begin(FrameArena* arena) {
+    frame_arena_free_overflow(arena);
+    
+    arena->stats.heap_allocations = 0;
+    if (arena->stats.peak_bytes > arena->capacity) {
+        size_t capacity = frame_arena_round(arena->stats.peak_bytes);
+        void* block = memory_alloc(capacity, MEMORY_HUGE_PAGES, MEMORY_TAG_FRAME_ARENA);
+        if (block) {
+            memory_free(arena->base);
+            arena->base = (uint8_t*)block;
+            arena->capacity = capacity;
+            arena->stats.heap_allocations++;
+        } else {
+            fprintf(stderr, "Cannot grow frame arena to %zu bytes\n", capacity);
+        }
+    }
+    
+    arena->offset = 0;
+    arena->stats.allocations = 0;
+    arena->stats.peak_bytes = 0;
+    arena->stats.capacity = arena->capacity;
+}
+
+// 64-byte aligned scratch valid until the arena is rewound. Safe to call
+// from several workers at once. Returns NULL only when out of memory.
+void* frame_arena_alloc(FrameArena* arena, size_t size) {
+    size = frame_arena_round(size > 0 ? size : 1);
+    size_t begin = __atomic_fetch_add(&arena->offset, size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&arena->stats.allocations, 1, __ATOMIC_RELAXED);
+    
+    if (begin + size <= arena->capacity) {
+        return arena->base + begin;
+    }
+    
+    // Spill to the heap; the offset still counts the bytes so the block is
+    // sized to cover them next frame
+    ArenaOverflow* block = (ArenaOverflow*)memory_alloc(FRAME_ARENA_ALIGNMENT + size, 0, MEMORY_TAG_FRAME_ARENA);
+    if (!block) return NULL;
+    
+    block->next = (ArenaOverflow*)__atomic_load_n(&arena->overflow, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n((ArenaOverflow**)&arena->overflow, &block->next, block,
+                                        true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    __atomic_fetch_add(&arena->stats.heap_allocations, 1, __ATOMIC_RELAXED);
+    return (uint8_t*)block + FRAME_ARENA_ALIGNMENT;
+}
+
+size_t frame_arena_mark(FrameArena* arena) {
+    return __atomic_load_n(&arena->offset, __ATOMIC_RELAXED);
+}
+
+// Rewind to a mark once nothing allocated after it is in use
+void frame_arena_release(FrameArena* arena, size_t mark) {
+    if (arena->offset > arena->stats.peak_bytes) {
+        arena->stats.peak_bytes = arena->offset;
+    }
+    arena->offset = mark;
+}
+
+void frame_arena_cleanup(FrameArena* arena) {
+    frame_arena_free_overflow(arena);
+    memory_free(arena->base);
+    memset(arena, 0, sizeof(FrameArena));
+}
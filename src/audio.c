@@ -1,11 +1,17 @@
 #include "../include/engine.h"
-#include <SDL2/SDL.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Headless builds (ENGINE_HEADLESS) have no audio device: sounds still load
+// and sources still update, but nothing is mixed and play/stop are ignored
+#ifndef ENGINE_HEADLESS
+#include <SDL2/SDL.h>
+
 static SDL_AudioDeviceID audio_device = 0;
 static SDL_AudioSpec audio_spec;
+#endif
+
 static Vec3 listener_position = {0, 0, 0};
 static Vec3 listener_forward = {1, 0, 0};
 static Vec3 listener_up = {0, 0, 1};
@@ -17,23 +23,39 @@ typedef struct {
     int channels;
 } AudioBuffer;
 
-static AudioBuffer audio_buffers[32];
+static AudioBuffer audio_buffers[MAX_AUDIO_BUFFERS];
 static int audio_buffer_count = 0;
 
-// Audio callback for SDL
-static void audio_callback(void* userdata, Uint8* stream, int len) {
-    Engine* engine = (Engine*)userdata;
-    float* output = (float*)stream;
-    int sample_count = len / sizeof(float);
-    
+// Lock the mixer out; false when there is no device to lock
+static bool audio_device_lock(void) {
+#ifndef ENGINE_HEADLESS
+    if (audio_device == 0) return false;
+    SDL_LockAudioDevice(audio_device);
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void audio_device_unlock(void) {
+#ifndef ENGINE_HEADLESS
+    if (audio_device != 0) SDL_UnlockAudioDevice(audio_device);
+#endif
+}
+
+// Mix all playing sources into `sample_count` floats. Runs on the audio
+// thread from the SDL callback; public so the mixer can be measured alone.
+void audio_mix(Engine* engine, float* output, int sample_count) {
     // Clear output
-    memset(output, 0, len);
+    memset(output, 0, sample_count * sizeof(float));
     
     // Mix all active audio sources
+    int voices = 0;
     for (int i = 0; i < engine->audio_source_count; i++) {
         AudioSource* source = &engine->audio_sources[i];
         
         if (!source->playing || source->audio_buffer_id < 0) continue;
+        voices++;
         
         AudioBuffer* buffer = &audio_buffers[source->audio_buffer_id];
         
@@ -76,9 +98,18 @@ static void audio_callback(void* userdata, Uint8* stream, int len) {
         if (output[i] > 1.0f) output[i] = 1.0f;
         if (output[i] < -1.0f) output[i] = -1.0f;
     }
+    telemetry_set(TELEMETRY_AUDIO_VOICES, voices);
 }
 
+#ifndef ENGINE_HEADLESS
+// Audio callback for SDL
+static void audio_callback(void* userdata, Uint8* stream, int len) {
+    audio_mix((Engine*)userdata, (float*)stream, len / sizeof(float));
+}
+#endif
+
 void audio_init(Engine* engine) {
+#ifndef ENGINE_HEADLESS
     SDL_AudioSpec desired_spec;
     SDL_zero(desired_spec);
     
@@ -98,6 +129,7 @@ void audio_init(Engine* engine) {
     
     // Start audio playback
     SDL_PauseAudioDevice(audio_device, 0);
+#endif
     
     engine->audio_source_count = 0;
     memset(audio_buffers, 0, sizeof(audio_buffers));
@@ -105,15 +137,17 @@ void audio_init(Engine* engine) {
 }
 
 void audio_cleanup(Engine* engine) {
+#ifndef ENGINE_HEADLESS
     if (audio_device != 0) {
         SDL_CloseAudioDevice(audio_device);
         audio_device = 0;
     }
+#endif
     
     // Free audio buffers
     for (int i = 0; i < audio_buffer_count; i++) {
         if (audio_buffers[i].samples) {
-            free(audio_buffers[i].samples);
+            memory_free(audio_buffers[i].samples);
             audio_buffers[i].samples = NULL;
         }
     }
@@ -130,12 +164,12 @@ void audio_update(Engine* engine) {
 
 int audio_load_sound(const char* filename) {
     // Simplified: Generate procedural sound
-    if (audio_buffer_count >= 32) return -1;
+    if (audio_buffer_count >= MAX_AUDIO_BUFFERS) return -1;
     
     AudioBuffer* buffer = &audio_buffers[audio_buffer_count];
     buffer->sample_count = 44100; // 1 second
     buffer->channels = 1;
-    buffer->samples = (float*)malloc(buffer->sample_count * sizeof(float));
+    buffer->samples = (float*)memory_alloc(buffer->sample_count * sizeof(float), 0, MEMORY_TAG_AUDIO);
     
     // Generate simple tone
     float frequency = 440.0f; // A4 note
@@ -152,31 +186,37 @@ int audio_load_sound(const char* filename) {
 }
 
 void audio_play(AudioSource* source) {
-    if (audio_device == 0) return;
+    if (!audio_device_lock()) return;
     
-    SDL_LockAudioDevice(audio_device);
     source->playing = true;
     source->playback_position = 0.0f;
-    SDL_UnlockAudioDevice(audio_device);
+    audio_device_unlock();
 }
 
 void audio_stop(AudioSource* source) {
-    if (audio_device == 0) return;
+    if (!audio_device_lock()) return;
     
-    SDL_LockAudioDevice(audio_device);
     source->playing = false;
     source->playback_position = 0.0f;
-    SDL_UnlockAudioDevice(audio_device);
+    audio_device_unlock();
+}
+
+// Hold off the mixer while the caller touches engine audio sources
+void audio_lock(void) {
+    audio_device_lock();
+}
+
+void audio_unlock(void) {
+    audio_device_unlock();
 }
 
 void audio_set_listener(Vec3 position, Vec3 forward, Vec3 up) {
-    if (audio_device == 0) return;
+    if (!audio_device_lock()) return;
     
-    SDL_LockAudioDevice(audio_device);
     listener_position = position;
     listener_forward = forward;
     listener_up = up;
-    SDL_UnlockAudioDevice(audio_device);
+    audio_device_unlock();
 }
 
 void audio_update_3d(AudioSource* source, Vec3 listener_pos) {
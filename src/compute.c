@@ -5,8 +5,11 @@
 
 void compute_init(ComputeContext* ctx, int buffer_size) {
     ctx->buffer_size = buffer_size;
-    ctx->input_buffer = (uint32_t*)malloc(buffer_size * sizeof(uint32_t));
-    ctx->output_buffer = (uint32_t*)malloc(buffer_size * sizeof(uint32_t));
+    // The SIMD kernels use aligned 128-bit loads and stores
+    ctx->input_buffer = (uint32_t*)memory_alloc(buffer_size * sizeof(uint32_t), MEMORY_HUGE_PAGES,
+                                                 MEMORY_TAG_COMPUTE);
+    ctx->output_buffer = (uint32_t*)memory_alloc(buffer_size * sizeof(uint32_t), MEMORY_HUGE_PAGES,
+                                                  MEMORY_TAG_COMPUTE);
     ctx->use_compute = true;
     
     memset(ctx->input_buffer, 0, buffer_size * sizeof(uint32_t));
@@ -15,11 +18,11 @@ void compute_init(ComputeContext* ctx, int buffer_size) {
 
 void compute_cleanup(ComputeContext* ctx) {
     if (ctx->input_buffer) {
-        free(ctx->input_buffer);
+        memory_free(ctx->input_buffer);
         ctx->input_buffer = NULL;
     }
     if (ctx->output_buffer) {
-        free(ctx->output_buffer);
+        memory_free(ctx->output_buffer);
         ctx->output_buffer = NULL;
     }
 }
@@ -0,0 +1,113 @@
+#include "../include/engine.h"
+#include <stdio.h>
+#include <string.h>
+
+// Render-cost debug views. While a view is on, the passes that feed it add
+// into a per-pixel count buffer, cleared with the frame, and a final pass
+// turns the counts into a heat map in place of post-processing. With no
+// view the passes only test a NULL pointer once per row, column or sprite.
+//
+// Every pass that counts also writes colour, so the frame graph already
+// orders them and no pass needs its own resource for the counts.
+
+static const char* debug_view_names[DEBUG_VIEW_COUNT] = {
+    "none", "dda_steps", "overdraw", "light_cost"
+};
+
+// Counts that map to the hot end of the ramp when nothing in the frame
+// exceeds them, so a cheap frame does not look expensive
+static const int debug_view_floor[DEBUG_VIEW_COUNT] = {1, 16, 4, 1};
+
+const char* debug_view_name(DebugView view) {
+    return view >= 0 && view < DEBUG_VIEW_COUNT ? debug_view_names[view] : "unknown";
+}
+
+// DEBUG_VIEW_COUNT when `name` is not a view
+DebugView debug_view_from_name(const char* name) {
+    for (int i = 0; i < DEBUG_VIEW_COUNT; i++) {
+        if (strcmp(name, debug_view_names[i]) == 0) return (DebugView)i;
+    }
+    return DEBUG_VIEW_COUNT;
+}
+
+// Switch views; the count buffer is allocated on first use and kept
+bool debug_view_set(Engine* engine, DebugView view) {
+    if (view == engine->debug_view) return true;
+    
+    if (view != DEBUG_VIEW_NONE && !engine->debug_counts) {
+        engine->debug_counts = (uint16_t*)memory_alloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint16_t),
+                                                       MEMORY_HUGE_PAGES, MEMORY_TAG_RENDER);
+        if (!engine->debug_counts) {
+            fprintf(stderr, "Out of memory for the %s debug view\n", debug_view_name(view));
+            return false;
+        }
+        memset(engine->debug_counts, 0, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint16_t));
+    }
+    
+    engine->debug_view = view;
+    return true;
+}
+
+// The count buffer when `view` is the active one, NULL otherwise
+uint16_t* debug_view_counts(Engine* engine, DebugView view) {
+    return engine->debug_view == view ? engine->debug_counts : NULL;
+}
+
+void debug_view_clear(Engine* engine) {
+    if (engine->debug_view == DEBUG_VIEW_NONE) return;
+    memset(engine->debug_counts, 0, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint16_t));
+}
+
+// Black for no work, then blue, green, yellow and red up to white at the
+// frame's highest count
+static uint32_t debug_view_heat(float t) {
+    static const Color stops[] = {
+        {0, 0, 0, 255}, {0, 0, 255, 255}, {0, 255, 0, 255},
+        {255, 255, 0, 255}, {255, 0, 0, 255}, {255, 255, 255, 255}
+    };
+    const int segments = (int)(sizeof(stops) / sizeof(stops[0])) - 1;
+    
+    if (t <= 0.0f) return color_to_uint32(stops[0]);
+    if (t >= 1.0f) return color_to_uint32(stops[segments]);
+    
+    float position = t * segments;
+    int segment = (int)position;
+    float blend = position - segment;
+    Color a = stops[segment];
+    Color b = stops[segment + 1];
+    Color color = {
+        (uint8_t)(a.r + (b.r - a.r) * blend),
+        (uint8_t)(a.g + (b.g - a.g) * blend),
+        (uint8_t)(a.b + (b.b - a.b) * blend),
+        255
+    };
+    return color_to_uint32(color);
+}
+
+// Writes the active view into `target` and records the count shown as white
+void debug_view_resolve(Engine* engine, RenderTarget target) {
+    const uint16_t* counts = engine->debug_counts;
+    if (engine->debug_view == DEBUG_VIEW_NONE || !counts) return;
+    
+    int max = debug_view_floor[engine->debug_view];
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        if (counts[i] > max) max = counts[i];
+    }
+    
+    // Counts are small integers, so the ramp is looked up per count
+    uint32_t ramp[256];
+    int ramp_size = max < 255 ? max + 1 : 256;
+    for (int i = 0; i < ramp_size; i++) {
+        ramp[i] = debug_view_heat((float)i / (ramp_size - 1));
+    }
+    
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        uint32_t* row = (uint32_t*)((uint8_t*)target.pixels + (size_t)y * target.pitch);
+        const uint16_t* count_row = counts + y * SCREEN_WIDTH;
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            int count = count_row[x];
+            row[x] = ramp[max < 255 ? count : count * 255 / max];
+        }
+    }
+    engine->debug_scale = max;
+}
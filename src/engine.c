@@ -9,8 +9,24 @@
 #define DEG_TO_RAD (PI / 180.0f)
 #define RAD_TO_DEG (180.0f / PI)
 
+#ifdef ENGINE_LEAK_CHECK
+// Engines alive; the last engine_cleanup checks for leaked blocks
+static int engine_live_count = 0;
+#endif
+
 void engine_init(Engine* engine) {
+    engine_init_seeded(engine, (uint32_t)time(NULL));
+}
+
+// All simulation randomness derives from the seed, so a seed plus the
+// recorded per-tick input reproduces a run exactly
+void engine_init_seeded(Engine* engine, uint32_t seed) {
     memset(engine, 0, sizeof(Engine));
+#ifdef ENGINE_LEAK_CHECK
+    __atomic_add_fetch(&engine_live_count, 1, __ATOMIC_RELAXED);
+#endif
+    engine->seed = seed;
+    engine->rng_state = seed ? seed : 0x9E3779B9u;
     
     // Initialize camera
     engine->camera.position = (Vec2){MAP_WIDTH / 2.0f, MAP_HEIGHT / 2.0f};
@@ -27,12 +43,20 @@ void engine_init(Engine* engine) {
     engine->camera.physics.friction = 0.85f;
     engine->camera.physics.bounce = 0.0f;
     
-    // Allocate render buffers
-    engine->buffers.z_buffer = (float*)malloc(SCREEN_WIDTH * sizeof(float));
-    engine->buffers.color_buffer = (uint32_t*)malloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
-    engine->buffers.shadow_buffer = (float*)malloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(float));
-    engine->buffers.light_buffer = (uint8_t*)malloc(SCREEN_WIDTH * SCREEN_HEIGHT * 4);
-    engine->buffers.post_process_buffer = (uint32_t*)malloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    physics_world_init(&engine->physics_world);
+    threading_init(&engine->thread_pool);
+    
+    // Fixed simulation rate, independent of the render rate
+    engine->fixed_dt = 1.0f / SIMULATION_RATE;
+    engine->prev_camera = engine->camera;
+    
+    // Allocate render buffers; full-screen ones are walked every pass, so
+    // they go on huge pages to keep TLB misses down
+    engine->buffers.z_buffer = (float*)memory_alloc(SCREEN_WIDTH * sizeof(float), 0, MEMORY_TAG_RENDER);
+    engine->buffers.color_buffer = (uint32_t*)memory_alloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t),
+                                                           MEMORY_HUGE_PAGES, MEMORY_TAG_RENDER);
+    engine->buffers.light_buffer = (uint8_t*)memory_alloc(SCREEN_WIDTH * SCREEN_HEIGHT * 4,
+                                                          MEMORY_HUGE_PAGES, MEMORY_TAG_RENDER);
     
     // Initialize fog
     engine->fog.color = (ColorF){0.5f, 0.5f, 0.6f, 1.0f};
@@ -51,45 +75,191 @@ void engine_init(Engine* engine) {
     engine->post_fx.vignette_intensity = 0.4f;
     
     // Generate procedural map
-    map_generate_procedural(&engine->world, (uint32_t)time(NULL));
+    map_generate_procedural(&engine->world, seed);
+    navigation_init(engine);
     
     // Add default lights
-    engine->lights[0].position = (Vec3){MAP_WIDTH / 2.0f, MAP_HEIGHT / 2.0f, 2.0f};
-    engine->lights[0].color = (ColorF){1.0f, 0.9f, 0.7f, 1.0f};
-    engine->lights[0].intensity = 5.0f;
-    engine->lights[0].radius = 15.0f;
-    engine->lights[0].cast_shadows = true;
-    engine->light_count = 1;
+    Light sun = {0};
+    sun.position = (Vec3){MAP_WIDTH / 2.0f, MAP_HEIGHT / 2.0f, 2.0f};
+    sun.color = (ColorF){1.0f, 0.9f, 0.7f, 1.0f};
+    sun.intensity = 5.0f;
+    sun.radius = 15.0f;
+    sun.cast_shadows = true;
+    light_add(engine, &sun);
     
     engine->texture_count = 0;
-    engine->sprite_count = 0;
-    engine->particle_count = 0;
+}
+
+// Xorshift32 generator for simulation code
+uint32_t engine_random(Engine* engine) {
+    uint32_t x = engine->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    engine->rng_state = x;
+    return x;
+}
+
+float engine_random_float(Engine* engine) {
+    return (engine_random(engine) >> 8) * (1.0f / 16777216.0f);
 }
 
 void engine_cleanup(Engine* engine) {
-    free(engine->buffers.z_buffer);
-    free(engine->buffers.color_buffer);
-    free(engine->buffers.shadow_buffer);
-    free(engine->buffers.light_buffer);
-    free(engine->buffers.post_process_buffer);
+    replay_close(engine);
+    navigation_cleanup(engine);
+    threading_cleanup(&engine->thread_pool);
+    script_cleanup(engine);
+    entity_cleanup(engine);
+    
+    memory_free(engine->buffers.z_buffer);
+    memory_free(engine->buffers.color_buffer);
+    memory_free(engine->buffers.light_buffer);
+    memory_free(engine->debug_counts);
+    frame_arena_cleanup(&engine->frame_arena);
     
     for (int i = 0; i < engine->texture_count; i++) {
-        if (engine->textures[i].pixels) free(engine->textures[i].pixels);
-        if (engine->textures[i].normal_map) free(engine->textures[i].normal_map);
-        if (engine->textures[i].specular_map) free(engine->textures[i].specular_map);
-        if (engine->textures[i].emission_map) free(engine->textures[i].emission_map);
+        memory_free(engine->textures[i].pixels);
+        memory_free(engine->textures[i].normal_map);
+        memory_free(engine->textures[i].specular_map);
+        memory_free(engine->textures[i].emission_map);
     }
+    
+#ifdef ENGINE_LEAK_CHECK
+    if (__atomic_sub_fetch(&engine_live_count, 1, __ATOMIC_ACQ_REL) == 0) memory_check_leaks();
+#endif
 }
 
-void engine_update(Engine* engine, float delta_time) {
-    engine->delta_time = delta_time;
-    engine->frame_count++;
+#define MOUSE_SENSITIVITY 0.002f
+
+static void engine_apply_mouse_look(Camera* camera, const InputFrame* input) {
+    if (input->mouse_dx != 0) {
+        camera_rotate(camera, input->mouse_dx * MOUSE_SENSITIVITY);
+    }
+    if (input->mouse_dy != 0) {
+        float pitch_change = input->mouse_dy * MOUSE_SENSITIVITY;
+        if (pitch_change < 0) {
+            camera_look_up(camera, -pitch_change);
+        } else {
+            camera_look_down(camera, pitch_change);
+        }
+    }
+}
+
+// Apply one tick worth of player input to the camera and world
+static void engine_apply_input(Engine* engine, float delta_time) {
+    const float MOVE_SPEED = 5.0f;
+    InputFrame* input = &engine->input;
+    
+    // Mouse look
+    engine_apply_mouse_look(&engine->camera, input);
+    
+    // Movement
+    if (input->buttons & INPUT_FORWARD) {
+        camera_move_forward(&engine->camera, MOVE_SPEED * delta_time);
+    }
+    if (input->buttons & INPUT_BACKWARD) {
+        camera_move_backward(&engine->camera, MOVE_SPEED * delta_time);
+    }
+    if (input->buttons & INPUT_LEFT) {
+        camera_strafe_left(&engine->camera, MOVE_SPEED * delta_time);
+    }
+    if (input->buttons & INPUT_RIGHT) {
+        camera_strafe_right(&engine->camera, MOVE_SPEED * delta_time);
+    }
+    
+    camera_crouch(&engine->camera, (input->buttons & INPUT_CROUCH) != 0);
+    
+    // Open/close nearby doors
+    if (input->buttons & INPUT_USE) {
+        int px = (int)engine->camera.position.x;
+        int py = (int)engine->camera.position.y;
+        
+        for (int i = 0; i < engine->world.door_count; i++) {
+            Door* door = &engine->world.doors[i];
+            if (abs(door->x - px) <= 1 && abs(door->y - py) <= 1) {
+                if (door->open_amount < 0.5f) {
+                    door_open(&engine->world, i);
+                } else {
+                    door_close(&engine->world, i);
+                }
+            }
+        }
+    }
+    
+    // Spawn particles
+    if (input->buttons & INPUT_EMIT) {
+        for (int i = 0; i < 100; i++) {
+            Vec3 pos = {
+                engine->camera.position.x,
+                engine->camera.position.y,
+                engine->camera.z_position
+            };
+            Vec3 vel = {
+                (engine_random_float(engine) - 0.5f) * 5.0f,
+                (engine_random_float(engine) - 0.5f) * 5.0f,
+                engine_random_float(engine) * 8.0f
+            };
+            ColorF color = {
+                engine_random_float(engine),
+                engine_random_float(engine),
+                engine_random_float(engine),
+                1.0f
+            };
+            particle_emit(engine, pos, vel, color, 2.0f);
+        }
+    }
+    
+    // Feature toggles
+    if (input->toggles & TOGGLE_BLOOM) {
+        engine->post_fx.bloom_enabled = !engine->post_fx.bloom_enabled;
+    }
+    if (input->toggles & TOGGLE_MOTION_BLUR) {
+        engine->post_fx.motion_blur_enabled = !engine->post_fx.motion_blur_enabled;
+    }
+    if (input->toggles & TOGGLE_VIGNETTE) {
+        engine->post_fx.vignette = !engine->post_fx.vignette;
+    }
+    if (input->toggles & TOGGLE_FXAA) {
+        engine->post_fx.fxaa_enabled = !engine->post_fx.fxaa_enabled;
+    }
+    
+    // Mouse motion, toggles and one-shot actions are consumed by a single tick
+    input->mouse_dx = 0;
+    input->mouse_dy = 0;
+    input->toggles = 0;
+    input->buttons &= ~INPUT_ONESHOT_MASK;
+}
+
+void engine_set_tick_rate(Engine* engine, float ticks_per_second) {
+    if (ticks_per_second > 0.0f) {
+        engine->fixed_dt = 1.0f / ticks_per_second;
+    }
+}
+
+// Advance the simulation by one fixed tick
+void engine_step(Engine* engine, float delta_time) {
+    engine->tick_count++;
     engine->time_accumulator += delta_time;
     
+    // Remember the previous state for render interpolation
+    engine->prev_camera = engine->camera;
+    memcpy(engine->sprites.prev_position, engine->sprites.position, 
+           engine->sprites.count * sizeof(Vec2));
+    memcpy(engine->particles.prev_position, engine->particles.position, 
+           engine->particles.count * sizeof(Vec3));
+    
+    // Record this tick's input, or replace it with the logged one
+    PROFILE_BEGIN("input");
+    replay_tick(engine);
+    engine_apply_input(engine, delta_time);
+    PROFILE_END();
+    
     // Update physics with substeps for stability
+    PROFILE_BEGIN("physics");
     float substep_dt = delta_time / PHYSICS_SUBSTEPS;
     for (int i = 0; i < PHYSICS_SUBSTEPS; i++) {
         physics_update(engine, &engine->camera.physics, substep_dt);
+        physics_world_step(engine, substep_dt);
     }
     
     // Sync camera position with physics
@@ -98,27 +268,114 @@ void engine_update(Engine* engine, float delta_time) {
     // Update camera headbob
     float speed = vec2_length(engine->camera.physics.velocity);
     camera_update_headbob(&engine->camera, delta_time, speed > 0.01f);
+    PROFILE_END();
     
-    // Update doors
-    for (int i = 0; i < engine->world.door_count; i++) {
-        door_update(&engine->world.doors[i], delta_time);
-    }
+    // Update moving doors
+    PROFILE_BEGIN("doors");
+    door_update_active(&engine->world, delta_time);
+    PROFILE_END();
     
-    // Update sprites
-    for (int i = 0; i < engine->sprite_count; i++) {
-        sprite_animate(&engine->sprites[i], delta_time);
-    }
+    // Bring navigation caches up to date with map and door changes
+    PROFILE_BEGIN("navigation");
+    navigation_update(engine);
+    PROFILE_END();
+    
+    // Update animated sprites
+    PROFILE_BEGIN("sprite_animation");
+    sprite_animate(&engine->sprites, delta_time);
+    PROFILE_END();
     
     // Update particles
+    PROFILE_BEGIN("particle_update");
     particle_update(engine, delta_time);
-    
-    // Update light flickering
-    for (int i = 0; i < engine->light_count; i++) {
-        if (engine->lights[i].flickering > 0.0f) {
-            float flicker = fast_sin(engine->time_accumulator * 10.0f + i * 2.0f);
-            engine->lights[i].intensity *= 1.0f + flicker * engine->lights[i].flickering;
+    PROFILE_END();
+    
+    // Update flickering lights
+    PROFILE_BEGIN("light_flicker");
+    for (int f = 0; f < engine->flickering_light_count; f++) {
+        int i = engine->flickering_lights[f];
+        float flicker = fast_sin(engine->time_accumulator * 10.0f + i * 2.0f);
+        engine->lights[i].intensity *= 1.0f + flicker * engine->lights[i].flickering;
+    }
+    PROFILE_END();
+    
+    // Update scripts
+    PROFILE_BEGIN("scripts");
+    uint64_t script_start = profiler_now_ns();
+    script_update_all(engine);
+    uint64_t script_ns = profiler_now_ns() - script_start;
+    telemetry_record(TELEMETRY_SCRIPT_TIME, script_ns);
+    engine->script_ms += script_ns / 1.0e6f;
+    PROFILE_END();
+    
+    telemetry_add(TELEMETRY_TICKS, 1);
+}
+
+// Run as many fixed ticks as the elapsed frame time covers. The remainder is
+// carried over and used to interpolate rendering between the last two ticks.
+void engine_update(Engine* engine, float delta_time) {
+    engine->delta_time = delta_time;
+    engine->frame_count++;
+    engine->sim_accumulator += delta_time;
+    engine->script_ms = 0.0f;
+    
+    int ticks = 0;
+    while (engine->sim_accumulator >= engine->fixed_dt) {
+        if (ticks == MAX_TICKS_PER_FRAME) {
+            // Too far behind; drop the backlog instead of spiralling
+            engine->sim_accumulator = fmodf(engine->sim_accumulator, engine->fixed_dt);
+            break;
         }
+        
+        PROFILE_BEGIN("engine_step");
+        engine_step(engine, engine->fixed_dt);
+        PROFILE_END();
+        engine->sim_accumulator -= engine->fixed_dt;
+        ticks++;
     }
+    
+    engine->interpolation_alpha = engine->sim_accumulator / engine->fixed_dt;
+}
+
+static Vec2 vec2_lerp(Vec2 a, Vec2 b, float t) {
+    return (Vec2){a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+}
+
+// Camera blended between the previous and current tick
+Camera engine_interpolated_camera(Engine* engine) {
+    Camera* prev = &engine->prev_camera;
+    Camera cam = engine->camera;
+    float t = engine->interpolation_alpha;
+    
+    if (engine->tick_count < 2) return cam;
+    
+    cam.position = vec2_lerp(prev->position, engine->camera.position, t);
+    cam.direction = vec2_normalize(vec2_lerp(prev->direction, engine->camera.direction, t));
+    
+    float plane_length = vec2_length(engine->camera.plane);
+    cam.plane = vec2_mul(vec2_normalize(vec2_lerp(prev->plane, engine->camera.plane, t)),
+                         plane_length);
+    
+    cam.pitch = prev->pitch + (engine->camera.pitch - prev->pitch) * t;
+    cam.z_position = prev->z_position + (engine->camera.z_position - prev->z_position) * t;
+    cam.bob_offset = prev->bob_offset + (engine->camera.bob_offset - prev->bob_offset) * t;
+    
+    return cam;
+}
+
+// Late latch: re-sample look input right before the frame is cast. The view
+// turns from the newest tick by all mouse motion no tick has consumed yet,
+// including motion that arrived after this frame's input was read, so a
+// turn reaches the screen without waiting for the next tick. Position stays
+// interpolated; the simulation applies the same motion when it ticks.
+static void engine_late_latch(Engine* engine, Camera look, Camera* cam) {
+    InputFrame pending = engine->input;
+    engine->late_latch(engine->late_latch_context, &pending);
+    engine_apply_mouse_look(&look, &pending);
+    
+    cam->direction = look.direction;
+    cam->plane = look.plane;
+    cam->pitch = look.pitch;
 }
 
 void raycast_dda(Engine* engine, int x, Ray* ray) {
@@ -155,9 +412,11 @@ void raycast_dda(Engine* engine, int x, Ray* ray) {
     
     bool hit = false;
     ray->hit_door = false;
+    ray->steps = 0;
     
     // DDA algorithm
     while (!hit && ray->distance < MAX_RENDER_DISTANCE) {
+        ray->steps++;
         if (side_dist_x < side_dist_y) {
             side_dist_x += delta_dist_x;
             ray->map_x += step_x;
@@ -241,6 +500,7 @@ void raycast_floor_ceiling(Engine* engine, int y, int x) {
     
     float floor_x = engine->camera.position.x + row_distance * ray_dir_x0;
     float floor_y = engine->camera.position.y + row_distance * ray_dir_y0;
+    uint16_t* overdraw = debug_view_counts(engine, DEBUG_VIEW_OVERDRAW);
     
     for (int x = 0; x < SCREEN_WIDTH; x++) {
         int cell_x = (int)floor_x;
@@ -259,6 +519,7 @@ void raycast_floor_ceiling(Engine* engine, int y, int x) {
                 int idx = y * SCREEN_WIDTH + x;
                 engine->buffers.color_buffer[idx] = color_to_uint32(color);
                 engine->buffers.z_buffer[x] = row_distance;
+                if (overdraw) overdraw[idx]++;
             }
             
             // Render ceiling
@@ -267,6 +528,7 @@ void raycast_floor_ceiling(Engine* engine, int y, int x) {
                 Color color = texture_sample_bilinear(&engine->textures[ceiling_tex], tx, ty);
                 int idx = ceiling_y * SCREEN_WIDTH + x;
                 engine->buffers.color_buffer[idx] = color_to_uint32(color);
+                if (overdraw) overdraw[idx]++;
             }
         }
         
@@ -327,67 +589,199 @@ void render_textured_wall(Engine* engine, int x, Ray* ray) {
         engine->buffers.color_buffer[y * SCREEN_WIDTH + x] = color_to_uint32(color);
     }
     
+    uint16_t* overdraw = debug_view_counts(engine, DEBUG_VIEW_OVERDRAW);
+    if (overdraw) {
+        for (int y = draw_start; y < draw_end; y++) overdraw[y * SCREEN_WIDTH + x]++;
+    }
+    
     engine->buffers.z_buffer[x] = ray->perpendicular_distance;
 }
 
-void engine_render(Engine* engine) {
-    // Clear buffers
+// Render passes, run by the frame graph. Multi-item passes receive a range
+// of columns or probes and must only touch those.
+static void render_pass_clear(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
     memset(engine->buffers.color_buffer, 0, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
     for (int i = 0; i < SCREEN_WIDTH; i++) {
         engine->buffers.z_buffer[i] = MAX_RENDER_DISTANCE;
     }
-    
-    // Render floor and ceiling
+    debug_view_clear(engine);
+}
+
+// One item: every floor row also writes the depth of whole columns
+static void render_pass_floor_ceiling(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
     for (int y = SCREEN_HEIGHT / 2; y < SCREEN_HEIGHT; y++) {
         raycast_floor_ceiling(engine, y, 0);
     }
-    
-    // Render walls using DDA raycasting
-    for (int x = 0; x < SCREEN_WIDTH; x++) {
+}
+
+static void render_pass_walls(Engine* engine, int begin, int end) {
+    uint16_t* step_view = debug_view_counts(engine, DEBUG_VIEW_DDA_STEPS);
+    uint64_t steps = 0;
+    for (int x = begin; x < end; x++) {
         Ray ray = {0};
         raycast_dda(engine, x, &ray);
+        steps += ray.steps;
+        
+        if (step_view) {
+            for (int y = 0; y < SCREEN_HEIGHT; y++) step_view[y * SCREEN_WIDTH + x] = (uint16_t)ray.steps;
+        }
         
         if (ray.distance < MAX_RENDER_DISTANCE) {
             render_textured_wall(engine, x, &ray);
         }
     }
-    
-    // Render sprites (sorted by distance)
-    sprite_sort_by_distance(engine->sprites, engine->sprite_count, engine->camera.position);
+    telemetry_add(TELEMETRY_RAYS, end - begin);
+    telemetry_add(TELEMETRY_DDA_STEPS, steps);
+}
+
+static void render_pass_sprite_sort(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
+    sprite_sort_by_distance(&engine->sprites, engine->camera.position);
+}
+
+static void render_pass_gi_probes(Engine* engine, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        gi_update_probe(engine, &engine->gi_probes[i]);
+    }
+}
+
+static void render_pass_sprites(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
     render_sprites(engine);
-    
-    // Render particles
+}
+
+static void render_pass_particles(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
     particle_render(engine);
-    
-    // Apply lighting
+}
+
+static void render_pass_lighting(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
     apply_lighting(engine);
-    
-    // Apply shadows
+}
+
+static void render_pass_shadows(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
     apply_shadows(engine);
-    
-    // Apply fog
+}
+
+static void render_pass_fog(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
     apply_fog(engine);
-    
-    // Post-processing pipeline
-    if (engine->post_fx.bloom_enabled) {
-        post_process_bloom(engine);
-    }
-    
-    if (engine->post_fx.motion_blur_enabled) {
-        post_process_motion_blur(engine);
-    }
-    
-    if (engine->post_fx.chromatic_aberration) {
-        post_process_chromatic_aberration(engine);
-    }
-    
-    post_process_tone_mapping(engine);
-    
-    if (engine->post_fx.vignette) {
-        post_process_vignette(engine);
-    }
-    
-    if (engine->post_fx.fxaa_enabled) {
-        post_process_fxaa(engine);
-    }
+}
+
+static void render_pass_bloom(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
+    post_process_bloom(engine);
+}
+
+static void render_pass_motion_blur(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
+    post_process_motion_blur(engine);
+}
+
+static void render_pass_chromatic_aberration(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
+    post_process_chromatic_aberration(engine);
+}
+
+// Where a post pass writes: the output target when the pass finishes the
+// frame, the colour buffer otherwise
+static RenderTarget render_pass_target(Engine* engine, bool last) {
+    if (last && engine->buffers.output.pixels) return engine->buffers.output;
+    return (RenderTarget){engine->buffers.color_buffer, SCREEN_WIDTH * sizeof(uint32_t)};
+}
+
+static void render_pass_tone_mapping(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
+    bool last = !engine->post_fx.vignette && !engine->post_fx.fxaa_enabled;
+    post_process_tone_mapping(engine, render_pass_target(engine, last));
+}
+
+static void render_pass_vignette(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
+    post_process_vignette(engine, render_pass_target(engine, !engine->post_fx.fxaa_enabled));
+}
+
+static void render_pass_fxaa(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
+    post_process_fxaa(engine, render_pass_target(engine, true));
+}
+
+static void render_pass_debug_view(Engine* engine, int begin, int end) {
+    (void)begin;
+    (void)end;
+    debug_view_resolve(engine, render_pass_target(engine, true));
+}
+
+void engine_render(Engine* engine) {
+    PROFILE_BEGIN("engine_render");
+    
+    // Render from the camera interpolated between the last two ticks
+    Camera sim_camera = engine->camera;
+    engine->camera = engine_interpolated_camera(engine);
+    if (engine->late_latch) engine_late_latch(engine, sim_camera, &engine->camera);
+    
+    const uint32_t color = FRAME_RESOURCE_COLOR;
+    const uint32_t depth = FRAME_RESOURCE_DEPTH;
+    const uint32_t order = FRAME_RESOURCE_SPRITE_ORDER;
+    PostProcessing* fx = &engine->post_fx;
+    FrameGraph* graph = &engine->frame_graph;
+    
+    // A debug view replaces post-processing; the scene passes still run
+    // because they are what it measures
+    bool post = engine->debug_view == DEBUG_VIEW_NONE;
+    
+    // Declared in the order the passes composite; the graph runs
+    // independent ones side by side
+    frame_graph_begin(graph);
+    frame_graph_add_pass(graph, "clear", 0, color | depth, 1, 1, render_pass_clear, true);
+    frame_graph_add_pass(graph, "floor_ceiling", 0, color | depth, 1, 1,
+                         render_pass_floor_ceiling, true);
+    frame_graph_add_pass(graph, "walls", 0, color | depth, SCREEN_WIDTH,
+                         threading_grain(&engine->thread_pool, SCREEN_WIDTH), render_pass_walls, true);
+    frame_graph_add_pass(graph, "sprite_sort", 0, order, 1, 1, render_pass_sprite_sort, true);
+    frame_graph_add_pass(graph, "gi_probes", 0, FRAME_RESOURCE_PROBES, engine->probe_count, 4,
+                         render_pass_gi_probes, engine->use_gi);
+    frame_graph_add_pass(graph, "sprites", depth | order, color, 1, 1, render_pass_sprites, true);
+    frame_graph_add_pass(graph, "particles", depth, color, 1, 1, render_pass_particles, true);
+    frame_graph_add_pass(graph, "lighting", depth, color, 1, 1, render_pass_lighting, true);
+    frame_graph_add_pass(graph, "shadows", depth, color, 1, 1, render_pass_shadows, true);
+    frame_graph_add_pass(graph, "fog", depth, color, 1, 1, render_pass_fog, true);
+    frame_graph_add_pass(graph, "bloom", 0, color, 1, 1,
+                         render_pass_bloom, post && fx->bloom_enabled);
+    frame_graph_add_pass(graph, "motion_blur", 0, color, 1, 1,
+                         render_pass_motion_blur, post && fx->motion_blur_enabled);
+    frame_graph_add_pass(graph, "chromatic_aberration", 0, color, 1, 1,
+                         render_pass_chromatic_aberration, post && fx->chromatic_aberration);
+    frame_graph_add_pass(graph, "tone_mapping", 0, color, 1, 1, render_pass_tone_mapping, post);
+    frame_graph_add_pass(graph, "vignette", 0, color, 1, 1, render_pass_vignette, post && fx->vignette);
+    frame_graph_add_pass(graph, "fxaa", 0, color, 1, 1,
+                         render_pass_fxaa, post && fx->fxaa_enabled);
+    frame_graph_add_pass(graph, "debug_view", 0, color, 1, 1, render_pass_debug_view, !post);
+    frame_graph_execute(engine, graph);
+    
+    telemetry_record_frame_graph(graph);
+    telemetry_set(TELEMETRY_PARTICLES, engine->particles.count);
+    telemetry_set(TELEMETRY_SPRITES, engine->sprites.count);
+    
+    engine->camera = sim_camera;
+    PROFILE_END();
+    PROFILE_FRAME_END();
 }
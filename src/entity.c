@@ -0,0 +1,417 @@
+#include "../include/engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Entity storage. Components live in packed arrays (one row per entity) that
+// grow on demand; systems walk only the columns they use. Sprites are
+// addressed through generation-checked handles so rows can be swap-removed
+// without invalidating references held elsewhere.
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_GENERATION_MASK (UINT32_MAX >> ENTITY_INDEX_BITS)
+
+// Grow a heap array to hold at least `needed` elements (doubling)
+bool entity_reserve(void** array, int* capacity, int needed, size_t element_size) {
+    if (needed <= *capacity) return true;
+    
+    int new_capacity = *capacity > 0 ? *capacity : ENTITY_INITIAL_CAPACITY;
+    while (new_capacity < needed) new_capacity *= 2;
+    
+    void* grown = memory_realloc(*array, (size_t)new_capacity * element_size, MEMORY_TAG_ENTITIES);
+    if (!grown) {
+        fprintf(stderr, "Out of memory growing entity storage to %d\n", new_capacity);
+        return false;
+    }
+    
+    *array = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+// Grow several parallel columns to the same capacity
+static bool entity_reserve_columns(void** columns[], const size_t sizes[], int column_count,
+                                   int* capacity, int needed) {
+    if (needed <= *capacity) return true;
+    
+    for (int i = 0; i < column_count; i++) {
+        int column_capacity = *capacity;
+        if (!entity_reserve(columns[i], &column_capacity, needed, sizes[i])) return false;
+    }
+    
+    int new_capacity = *capacity > 0 ? *capacity : ENTITY_INITIAL_CAPACITY;
+    while (new_capacity < needed) new_capacity *= 2;
+    *capacity = new_capacity;
+    return true;
+}
+
+// =============================================================================
+// Handle slots
+// =============================================================================
+
+bool entity_index_reserve(EntityIndex* index, int slots) {
+    int capacity = index->slot_capacity;
+    void** columns[] = {(void**)&index->generation, (void**)&index->row,
+                        (void**)&index->free_slots};
+    const size_t sizes[] = {sizeof(uint32_t), sizeof(int), sizeof(int)};
+    
+    if (!entity_reserve_columns(columns, sizes, 3, &capacity, slots)) return false;
+    index->slot_capacity = capacity;
+    return true;
+}
+
+// Recreate the free list from the slot table after a bulk restore
+void entity_index_rebuild_free_list(EntityIndex* index) {
+    index->free_count = 0;
+    for (int slot = index->slot_count - 1; slot >= 0; slot--) {
+        if (index->row[slot] < 0) index->free_slots[index->free_count++] = slot;
+    }
+}
+
+static int entity_index_alloc(EntityIndex* index, EntityHandle* handle) {
+    int slot;
+    if (index->free_count > 0) {
+        slot = index->free_slots[--index->free_count];
+    } else {
+        if (index->slot_count >= (int)ENTITY_INDEX_MASK) return -1;
+        if (!entity_index_reserve(index, index->slot_count + 1)) return -1;
+        
+        slot = index->slot_count++;
+        index->generation[slot] = 1;
+    }
+    
+    *handle = (index->generation[slot] << ENTITY_INDEX_BITS) | (uint32_t)slot;
+    return slot;
+}
+
+static void entity_index_release(EntityIndex* index, int slot) {
+    // Skip generation 0 so a live handle is never ENTITY_NULL
+    uint32_t generation = (index->generation[slot] + 1) & ENTITY_GENERATION_MASK;
+    index->generation[slot] = generation ? generation : 1;
+    index->row[slot] = -1;
+    index->free_slots[index->free_count++] = slot;
+}
+
+static int entity_index_lookup(const EntityIndex* index, EntityHandle handle) {
+    int slot = (int)(handle & ENTITY_INDEX_MASK);
+    if (handle == ENTITY_NULL || slot >= index->slot_count) return -1;
+    if (index->generation[slot] != handle >> ENTITY_INDEX_BITS) return -1;
+    return index->row[slot];
+}
+
+static void entity_index_free(EntityIndex* index) {
+    memory_free(index->generation);
+    memory_free(index->row);
+    memory_free(index->slot);
+    memory_free(index->free_slots);
+    memset(index, 0, sizeof(EntityIndex));
+}
+
+// =============================================================================
+// Sprites
+// =============================================================================
+
+bool sprite_store_reserve(SpriteStore* sprites, int capacity) {
+    int row_capacity = sprites->capacity;
+    void** columns[] = {
+        (void**)&sprites->position, (void**)&sprites->prev_position, (void**)&sprites->z_height,
+        (void**)&sprites->visual, (void**)&sprites->animation, (void**)&sprites->order,
+        (void**)&sprites->index.slot
+    };
+    const size_t sizes[] = {
+        sizeof(Vec2), sizeof(Vec2), sizeof(float),
+        sizeof(SpriteVisual), sizeof(SpriteAnimation), sizeof(int),
+        sizeof(int)
+    };
+    
+    if (!entity_reserve_columns(columns, sizes, 7, &row_capacity, capacity)) return false;
+    sprites->capacity = row_capacity;
+    return true;
+}
+
+EntityHandle sprite_create(Engine* engine, const Sprite* desc) {
+    SpriteStore* sprites = &engine->sprites;
+    if (!sprite_store_reserve(sprites, sprites->count + 1)) return ENTITY_NULL;
+    
+    EntityHandle handle;
+    int slot = entity_index_alloc(&sprites->index, &handle);
+    if (slot < 0) return ENTITY_NULL;
+    
+    int row = sprites->count++;
+    sprites->index.row[slot] = row;
+    sprites->index.slot[row] = slot;
+    
+    sprites->position[row] = desc->position;
+    sprites->prev_position[row] = desc->position;
+    sprites->z_height[row] = desc->z_height;
+    sprites->visual[row] = (SpriteVisual){
+        desc->texture_id, desc->scale, desc->tint, desc->rotation,
+        desc->billboarding, desc->cast_shadow
+    };
+    sprites->animation[row] = (SpriteAnimation){desc->animation_frame, 0.0f};
+    sprites->order[row] = row;
+    
+    sprite_set_animation_speed(engine, handle, desc->animation_speed);
+    return handle;
+}
+
+// Swap-remove: the last row moves into the hole and its slot is repointed
+void sprite_destroy(Engine* engine, EntityHandle handle) {
+    SpriteStore* sprites = &engine->sprites;
+    int row = entity_index_lookup(&sprites->index, handle);
+    if (row < 0) return;
+    
+    int last = --sprites->count;
+    if (row != last) {
+        sprites->position[row] = sprites->position[last];
+        sprites->prev_position[row] = sprites->prev_position[last];
+        sprites->z_height[row] = sprites->z_height[last];
+        sprites->visual[row] = sprites->visual[last];
+        sprites->animation[row] = sprites->animation[last];
+        
+        int moved_slot = sprites->index.slot[last];
+        sprites->index.slot[row] = moved_slot;
+        sprites->index.row[moved_slot] = row;
+    }
+    
+    entity_index_release(&sprites->index, (int)(handle & ENTITY_INDEX_MASK));
+    
+    // Keep the render order a permutation of the live rows
+    for (int i = 0; i < sprites->count; i++) sprites->order[i] = i;
+}
+
+// Row of a live sprite, or -1 for a stale or null handle
+int sprite_row(const SpriteStore* sprites, EntityHandle handle) {
+    return entity_index_lookup(&sprites->index, handle);
+}
+
+// Starting an animation puts the sprite on the animated list and stopping it
+// takes it off again, so a restart never lists it twice; sprite_animate
+// drops the handles of destroyed sprites
+void sprite_set_animation_speed(Engine* engine, EntityHandle handle, float speed) {
+    SpriteStore* sprites = &engine->sprites;
+    int row = entity_index_lookup(&sprites->index, handle);
+    if (row < 0) return;
+    
+    bool was_animated = sprites->animation[row].speed > 0.0f;
+    sprites->animation[row].speed = speed;
+    
+    if (speed > 0.0f && !was_animated) {
+        if (entity_reserve((void**)&sprites->animated, &sprites->animated_capacity,
+                           sprites->animated_count + 1, sizeof(EntityHandle))) {
+            sprites->animated[sprites->animated_count++] = handle;
+        }
+    } else if (speed <= 0.0f && was_animated) {
+        for (int i = 0; i < sprites->animated_count; i++) {
+            if (sprites->animated[i] == handle) {
+                sprites->animated[i] = sprites->animated[--sprites->animated_count];
+                break;
+            }
+        }
+    }
+}
+
+// Copy the component rows of a store into another (render state capture);
+// handles and active lists are not copied
+void sprite_store_copy_rows(SpriteStore* dst, const SpriteStore* src) {
+    if (!sprite_store_reserve(dst, src->count)) return;
+    
+    // Last frame's draw order stays valid while the row count is unchanged
+    if (dst->count != src->count) {
+        for (int row = 0; row < src->count; row++) dst->order[row] = row;
+    }
+    
+    dst->count = src->count;
+    memcpy(dst->position, src->position, src->count * sizeof(Vec2));
+    memcpy(dst->prev_position, src->prev_position, src->count * sizeof(Vec2));
+    memcpy(dst->z_height, src->z_height, src->count * sizeof(float));
+    memcpy(dst->visual, src->visual, src->count * sizeof(SpriteVisual));
+    memcpy(dst->animation, src->animation, src->count * sizeof(SpriteAnimation));
+}
+
+void sprite_store_free(SpriteStore* sprites) {
+    memory_free(sprites->position);
+    memory_free(sprites->prev_position);
+    memory_free(sprites->z_height);
+    memory_free(sprites->visual);
+    memory_free(sprites->animation);
+    memory_free(sprites->order);
+    memory_free(sprites->animated);
+    entity_index_free(&sprites->index);
+    memset(sprites, 0, sizeof(SpriteStore));
+}
+
+// =============================================================================
+// Particles
+// =============================================================================
+
+bool particle_store_reserve(ParticleStore* particles, int capacity) {
+    void** columns[] = {
+        (void**)&particles->position, (void**)&particles->prev_position,
+        (void**)&particles->velocity, (void**)&particles->color,
+        (void**)&particles->lifetime, (void**)&particles->size,
+        (void**)&particles->gravity_scale, (void**)&particles->texture_id
+    };
+    const size_t sizes[] = {
+        sizeof(Vec3), sizeof(Vec3), sizeof(Vec3), sizeof(ColorF),
+        sizeof(float), sizeof(float), sizeof(float), sizeof(int)
+    };
+    
+    return entity_reserve_columns(columns, sizes, 8, &particles->capacity, capacity);
+}
+
+void particle_store_remove(ParticleStore* particles, int row) {
+    int last = --particles->count;
+    if (row == last) return;
+    
+    particles->position[row] = particles->position[last];
+    particles->prev_position[row] = particles->prev_position[last];
+    particles->velocity[row] = particles->velocity[last];
+    particles->color[row] = particles->color[last];
+    particles->lifetime[row] = particles->lifetime[last];
+    particles->size[row] = particles->size[last];
+    particles->gravity_scale[row] = particles->gravity_scale[last];
+    particles->texture_id[row] = particles->texture_id[last];
+}
+
+void particle_store_copy(ParticleStore* dst, const ParticleStore* src) {
+    if (!particle_store_reserve(dst, src->count)) return;
+    
+    dst->count = src->count;
+    memcpy(dst->position, src->position, src->count * sizeof(Vec3));
+    memcpy(dst->prev_position, src->prev_position, src->count * sizeof(Vec3));
+    memcpy(dst->velocity, src->velocity, src->count * sizeof(Vec3));
+    memcpy(dst->color, src->color, src->count * sizeof(ColorF));
+    memcpy(dst->lifetime, src->lifetime, src->count * sizeof(float));
+    memcpy(dst->size, src->size, src->count * sizeof(float));
+    memcpy(dst->gravity_scale, src->gravity_scale, src->count * sizeof(float));
+    memcpy(dst->texture_id, src->texture_id, src->count * sizeof(int));
+}
+
+void particle_store_free(ParticleStore* particles) {
+    memory_free(particles->position);
+    memory_free(particles->prev_position);
+    memory_free(particles->velocity);
+    memory_free(particles->color);
+    memory_free(particles->lifetime);
+    memory_free(particles->size);
+    memory_free(particles->gravity_scale);
+    memory_free(particles->texture_id);
+    memset(particles, 0, sizeof(ParticleStore));
+}
+
+// =============================================================================
+// Lights, audio sources and scripts (small, iterated whole; kept as rows)
+// =============================================================================
+
+// Returns the new light's index, or -1 if out of memory
+int light_add(Engine* engine, const Light* light) {
+    if (!entity_reserve((void**)&engine->lights, &engine->light_capacity,
+                        engine->light_count + 1, sizeof(Light))) {
+        return -1;
+    }
+    
+    int index = engine->light_count++;
+    engine->lights[index] = *light;
+    engine->lights[index].flickering = 0.0f;
+    light_set_flickering(engine, index, light->flickering);
+    return index;
+}
+
+// Lights join the flickering list when they start flickering and leave it
+// when set back to zero, so steady lights cost nothing per tick
+void light_set_flickering(Engine* engine, int index, float flickering) {
+    bool was_flickering = engine->lights[index].flickering > 0.0f;
+    engine->lights[index].flickering = flickering;
+    
+    if (flickering > 0.0f && !was_flickering) {
+        if (entity_reserve((void**)&engine->flickering_lights, &engine->flickering_light_capacity,
+                           engine->flickering_light_count + 1, sizeof(int))) {
+            engine->flickering_lights[engine->flickering_light_count++] = index;
+        }
+    } else if (flickering <= 0.0f && was_flickering) {
+        for (int i = 0; i < engine->flickering_light_count; i++) {
+            if (engine->flickering_lights[i] == index) {
+                engine->flickering_lights[i] = engine->flickering_lights[--engine->flickering_light_count];
+                break;
+            }
+        }
+    }
+}
+
+// The mixer reads the sources from the audio thread, so growth happens
+// under the audio lock
+AudioSource* audio_source_add(Engine* engine) {
+    AudioSource* source = NULL;
+    
+    audio_lock();
+    if (entity_reserve((void**)&engine->audio_sources, &engine->audio_source_capacity,
+                       engine->audio_source_count + 1, sizeof(AudioSource))) {
+        source = &engine->audio_sources[engine->audio_source_count++];
+        memset(source, 0, sizeof(AudioSource));
+    }
+    audio_unlock();
+    
+    return source;
+}
+
+Script* script_add(Engine* engine) {
+    if (!entity_reserve((void**)&engine->scripts, &engine->script_capacity,
+                        engine->script_count + 1, sizeof(Script))) {
+        return NULL;
+    }
+    
+    Script* script = &engine->scripts[engine->script_count++];
+    memset(script, 0, sizeof(Script));
+    return script;
+}
+
+// Active lists are derived state; rebuild them after rows were restored in bulk
+void entity_rebuild_active_lists(Engine* engine) {
+    SpriteStore* sprites = &engine->sprites;
+    
+    sprites->animated_count = 0;
+    for (int row = 0; row < sprites->count; row++) {
+        if (sprites->animation[row].speed <= 0.0f) continue;
+        
+        int slot = sprites->index.slot[row];
+        EntityHandle handle = (sprites->index.generation[slot] << ENTITY_INDEX_BITS) | (uint32_t)slot;
+        if (!entity_reserve((void**)&sprites->animated, &sprites->animated_capacity,
+                            sprites->animated_count + 1, sizeof(EntityHandle))) {
+            break;
+        }
+        sprites->animated[sprites->animated_count++] = handle;
+    }
+    
+    engine->flickering_light_count = 0;
+    for (int i = 0; i < engine->light_count; i++) {
+        float flickering = engine->lights[i].flickering;
+        engine->lights[i].flickering = 0.0f;
+        light_set_flickering(engine, i, flickering);
+    }
+}
+
+void entity_cleanup(Engine* engine) {
+    sprite_store_free(&engine->sprites);
+    particle_store_free(&engine->particles);
+    
+    memory_free(engine->lights);
+    engine->lights = NULL;
+    engine->light_count = 0;
+    engine->light_capacity = 0;
+    memory_free(engine->flickering_lights);
+    engine->flickering_lights = NULL;
+    engine->flickering_light_count = 0;
+    engine->flickering_light_capacity = 0;
+    
+    audio_lock();
+    memory_free(engine->audio_sources);
+    engine->audio_sources = NULL;
+    engine->audio_source_count = 0;
+    engine->audio_source_capacity = 0;
+    audio_unlock();
+    
+    memory_free(engine->scripts);
+    engine->scripts = NULL;
+    engine->script_count = 0;
+    engine->script_capacity = 0;
+}
@@ -0,0 +1,204 @@
+#include "../include/engine.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Flight recorder. Every presented frame leaves a small summary in a ring:
+// its interval, the frame graph pass spans, the arena and scene counts and
+// the script time of its ticks. Recording is a copy of a few hundred bytes,
+// so it stays on in every build. A dump writes the frames of the last
+// history span as a Chrome trace (chrome://tracing, Perfetto): frames and
+// passes on their own tracks, counters for the scene state, and whatever
+// the profiler rings hold for the same span in ENGINE_PROFILER builds.
+//
+// Dumps happen on the thread that records frames, right after the frame
+// that asked for one, never inside the signal handler.
+
+static volatile sig_atomic_t flight_dump_requested = 0;
+
+// Async-signal-safe; the next recorded frame writes the dump
+void flight_recorder_request_dump(void) {
+    flight_dump_requested = 1;
+}
+
+#ifdef SIGUSR1
+static void flight_recorder_signal(int signal_number) {
+    (void)signal_number;
+    flight_recorder_request_dump();
+}
+#endif
+
+// SIGUSR1 requests a dump, e.g. `kill -USR1 <pid>` while a stall reproduces
+bool flight_recorder_install_signal(void) {
+#ifdef SIGUSR1
+    return signal(SIGUSR1, flight_recorder_signal) != SIG_ERR;
+#else
+    return false;
+#endif
+}
+
+bool flight_recorder_init(FlightRecorder* recorder, double threshold_ms, const char* directory) {
+    memset(recorder, 0, sizeof(FlightRecorder));
+    recorder->frames = (FlightFrame*)memory_alloc(FLIGHT_MAX_FRAMES * sizeof(FlightFrame), 0,
+                                                  MEMORY_TAG_DIAGNOSTICS);
+    if (!recorder->frames) {
+        fprintf(stderr, "Out of memory for the flight recorder\n");
+        return false;
+    }
+    recorder->threshold_ms = threshold_ms;
+    recorder->history_ms = FLIGHT_HISTORY_MS;
+    recorder->directory = directory ? directory : ".";
+    return true;
+}
+
+void flight_recorder_cleanup(FlightRecorder* recorder) {
+    memory_free(recorder->frames);
+    recorder->frames = NULL;
+    recorder->count = 0;
+}
+
+// Call once per presented frame, after engine_render, on the thread that
+// renders. `now_ms` is sim_pipeline_now_ms at the end of the frame.
+void flight_recorder_frame(FlightRecorder* recorder, const Engine* engine, double now_ms) {
+    if (!recorder->frames) return;
+    
+    const FrameGraph* graph = &engine->frame_graph;
+    FlightFrame* frame = &recorder->frames[recorder->next];
+    frame->frame = engine->frame_count;
+    frame->tick = engine->tick_count;
+    frame->begin_ms = recorder->count > 0 ? recorder->last_end_ms : now_ms - graph->total_ms;
+    frame->end_ms = now_ms;
+    frame->render_ms = (float)graph->total_ms;
+    frame->critical_ms = (float)graph->critical_path_ms;
+    frame->script_ms = engine->script_ms;
+    frame->particles = engine->particles.count;
+    frame->sprites = engine->sprites.count;
+    frame->lights = engine->light_count;
+    frame->arena_peak_bytes = graph->arena.peak_bytes;
+    frame->arena_heap_allocations = graph->arena.heap_allocations;
+    
+    frame->pass_count = 0;
+    for (int i = 0; i < graph->pass_count; i++) {
+        const FramePass* pass = &graph->passes[i];
+        if (!pass->enabled) continue;
+        frame->passes[frame->pass_count++] = (FlightPass){
+            pass->name, i, (float)(pass->start_ms - frame->begin_ms), (float)(pass->end_ms - pass->start_ms)
+        };
+    }
+    
+    recorder->next = (recorder->next + 1) % FLIGHT_MAX_FRAMES;
+    if (recorder->count < FLIGHT_MAX_FRAMES) recorder->count++;
+    recorder->last_end_ms = now_ms;
+    
+    double frame_ms = frame->end_ms - frame->begin_ms;
+    if (flight_dump_requested) {
+        flight_dump_requested = 0;
+        flight_recorder_dump(recorder, "request");
+    } else if (recorder->threshold_ms > 0.0 && frame_ms > recorder->threshold_ms &&
+               now_ms >= recorder->quiet_until_ms) {
+        // Later spikes in the same span are already in this dump's tail
+        // or will lead the next one
+        char reason[64];
+        snprintf(reason, sizeof(reason), "frame took %.1f ms", frame_ms);
+        flight_recorder_dump(recorder, reason);
+        recorder->quiet_until_ms = now_ms + recorder->history_ms;
+    }
+}
+
+static void flight_write_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static const FlightFrame* flight_recorder_at(const FlightRecorder* recorder, int age) {
+    int index = (recorder->next - 1 - age + FLIGHT_MAX_FRAMES) % FLIGHT_MAX_FRAMES;
+    return &recorder->frames[index];
+}
+
+// Writes the frames of the last history span to DIRECTORY/flight-FRAME.json
+bool flight_recorder_dump(FlightRecorder* recorder, const char* reason) {
+    if (!recorder->frames || recorder->count == 0) return false;
+    
+    const FlightFrame* last = flight_recorder_at(recorder, 0);
+    int count = 1;
+    while (count < recorder->count &&
+           last->end_ms - flight_recorder_at(recorder, count)->begin_ms <= recorder->history_ms) {
+        count++;
+    }
+    const FlightFrame* first = flight_recorder_at(recorder, count - 1);
+    double base_ms = first->begin_ms;
+    
+    char filename[512];
+    snprintf(filename, sizeof(filename), "%s/flight-%06llu.json", recorder->directory,
+             (unsigned long long)last->frame);
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write flight recorder dump %s\n", filename);
+        return false;
+    }
+    
+    fprintf(file, "{\"displayTimeUnit\": \"ms\",\n\"flightRecorder\": {\"reason\": ");
+    flight_write_string(file, reason);
+    fprintf(file, ", \"frame\": %llu, \"tick\": %llu, \"seed\": %u, \"frames\": %d, "
+                  "\"threshold_ms\": %.3f, \"replay\": ",
+            (unsigned long long)last->frame, (unsigned long long)last->tick, recorder->seed,
+            count, recorder->threshold_ms);
+    if (recorder->replay_file) {
+        flight_write_string(file, recorder->replay_file);
+    } else {
+        fprintf(file, "null");
+    }
+    
+    fprintf(file, "},\n\"traceEvents\": [\n"
+                  "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"engine\"}},\n"
+                  "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 2, \"args\": {\"name\": \"flight recorder\"}},\n"
+                  "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 2, \"tid\": 0, \"args\": {\"name\": \"frames\"}}");
+    uint32_t named_tracks = 0;      // Pass tracks given a name so far
+    
+    for (int age = count - 1; age >= 0; age--) {
+        const FlightFrame* frame = flight_recorder_at(recorder, age);
+        double ts = (frame->begin_ms - base_ms) * 1000.0;
+        
+        fprintf(file, ",\n{\"name\": \"frame %llu\", \"ph\": \"X\", \"pid\": 2, \"tid\": 0, "
+                      "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"tick\": %llu, \"render_ms\": %.3f, "
+                      "\"critical_ms\": %.3f, \"script_ms\": %.3f, \"arena_heap_allocations\": %d}}",
+                (unsigned long long)frame->frame, ts, (frame->end_ms - frame->begin_ms) * 1000.0,
+                (unsigned long long)frame->tick, frame->render_ms, frame->critical_ms,
+                frame->script_ms, frame->arena_heap_allocations);
+        fprintf(file, ",\n{\"name\": \"scene\", \"ph\": \"C\", \"pid\": 2, \"ts\": %.3f, "
+                      "\"args\": {\"particles\": %d, \"sprites\": %d, \"lights\": %d}}",
+                ts, frame->particles, frame->sprites, frame->lights);
+        fprintf(file, ",\n{\"name\": \"frame arena KB\", \"ph\": \"C\", \"pid\": 2, \"ts\": %.3f, "
+                      "\"args\": {\"peak\": %.1f}}",
+                ts, frame->arena_peak_bytes / 1024.0);
+        
+        for (int p = 0; p < frame->pass_count; p++) {
+            const FlightPass* pass = &frame->passes[p];
+            if (!(named_tracks & (1u << pass->index))) {
+                named_tracks |= 1u << pass->index;
+                fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 2, \"tid\": %d, "
+                              "\"args\": {\"name\": ", pass->index + 1);
+                flight_write_string(file, pass->name);
+                fprintf(file, "}}");
+            }
+            fprintf(file, ",\n{\"name\": ");
+            flight_write_string(file, pass->name);
+            fprintf(file, ", \"ph\": \"X\", \"pid\": 2, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    pass->index + 1, ts + pass->start_ms * 1000.0, pass->duration_ms * 1000.0);
+        }
+    }
+    
+    uint64_t base_ns = (uint64_t)(base_ms * 1.0e6);
+    profiler_append_trace_events(file, base_ns, base_ns);
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    
+    recorder->dumps++;
+    printf("Flight recorder: %s, %d frames written to %s\n", reason, count, filename);
+    return true;
+}
@@ -0,0 +1,235 @@
+#include "../include/engine.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Frame graph. Passes are declared in submission order together with the
+// frame resources they read and write. Two passes conflict when one writes
+// something the other touches; every pass waits for the earlier passes it
+// conflicts with. Passes are then grouped into levels and each level runs as
+// one batch on the worker pool, with multi-item passes split into chunks so
+// a wide pass (wall casting) and small independent ones (sprite sorting)
+// share the workers. Scratch memory from the frame arena is rewound after
+// each level.
+
+static double frame_graph_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+void frame_graph_begin(FrameGraph* graph) {
+    graph->pass_count = 0;
+    graph->level_count = 0;
+    graph->executed = 0;
+    graph->total_ms = 0.0;
+    graph->critical_path_ms = 0.0;
+}
+
+// Returns the pass index, or -1 if the graph is full. A pass with no items
+// (no probes to update) is kept in the graph but disabled.
+int frame_graph_add_pass(FrameGraph* graph, const char* name, uint32_t reads, uint32_t writes,
+                         int items, int grain, FramePassFunction run, bool enabled) {
+    if (graph->pass_count == FRAME_MAX_PASSES) {
+        fprintf(stderr, "Frame graph full, dropping pass %s\n", name);
+        return -1;
+    }
+    
+    FramePass* pass = &graph->passes[graph->pass_count];
+    memset(pass, 0, sizeof(FramePass));
+    pass->name = name;
+    pass->reads = reads;
+    pass->writes = writes;
+    pass->items = items > 0 ? items : 0;
+    pass->grain = grain > 0 ? grain : pass->items;
+    pass->run = run;
+    pass->enabled = enabled && run && pass->items > 0;
+    pass->level = -1;
+    return graph->pass_count++;
+}
+
+// Build dependencies between enabled passes and assign levels. Passes run as
+// late as their consumers allow, so an independent pass overlaps the passes
+// just before its first reader instead of holding up the start of the frame.
+static void frame_graph_schedule(FrameGraph* graph) {
+    FramePass* passes = graph->passes;
+    int count = graph->pass_count;
+    int earliest[FRAME_MAX_PASSES];
+    int last_level = 0;
+    
+    for (int i = 0; i < count; i++) {
+        FramePass* pass = &passes[i];
+        pass->depends = 0;
+        if (!pass->enabled) continue;
+        
+        uint32_t touched = pass->reads | pass->writes;
+        earliest[i] = 0;
+        for (int j = 0; j < i; j++) {
+            if (!passes[j].enabled) continue;
+            
+            uint32_t other = passes[j].reads | passes[j].writes;
+            if ((pass->writes & other) || (passes[j].writes & touched)) {
+                pass->depends |= 1u << j;
+                if (earliest[j] + 1 > earliest[i]) earliest[i] = earliest[j] + 1;
+            }
+        }
+        if (earliest[i] > last_level) last_level = earliest[i];
+    }
+    
+    for (int i = count - 1; i >= 0; i--) {
+        FramePass* pass = &passes[i];
+        if (!pass->enabled) continue;
+        
+        pass->level = last_level;
+        for (int j = i + 1; j < count; j++) {
+            if (passes[j].enabled && (passes[j].depends & (1u << i)) && passes[j].level - 1 < pass->level) {
+                pass->level = passes[j].level - 1;
+            }
+        }
+    }
+    
+    graph->level_count = last_level + 1;
+}
+
+typedef struct {
+    Engine* engine;
+    FrameGraph* graph;
+} FrameBatch;
+
+static void frame_graph_run_chunks(void* context, int begin, int end) {
+    FrameBatch* batch = (FrameBatch*)context;
+    
+    for (int i = begin; i < end; i++) {
+        FrameChunk* chunk = &batch->graph->chunks[i];
+        FramePass* pass = &batch->graph->passes[chunk->pass];
+        PROFILE_BEGIN(pass->name);
+        chunk->start_ms = frame_graph_now_ms();
+        pass->run(batch->engine, chunk->begin, chunk->end);
+        chunk->end_ms = frame_graph_now_ms();
+        PROFILE_END();
+    }
+}
+
+// Split the passes of one level into chunks; returns the chunk count. Each
+// pass keeps enough slots in reserve for the passes after it.
+static int frame_graph_gather_level(FrameGraph* graph, int level) {
+    int chunk_count = 0;
+    
+    for (int i = 0; i < graph->pass_count; i++) {
+        FramePass* pass = &graph->passes[i];
+        if (!pass->enabled || pass->level != level) continue;
+        
+        int budget = FRAME_MAX_CHUNKS - chunk_count - (FRAME_MAX_PASSES - 1 - i);
+        int grain = pass->grain;
+        if ((pass->items + grain - 1) / grain > budget) {
+            grain = (pass->items + budget - 1) / budget;
+        }
+        
+        for (int begin = 0; begin < pass->items; begin += grain) {
+            int end = begin + grain < pass->items ? begin + grain : pass->items;
+            graph->chunks[chunk_count++] = (FrameChunk){i, begin, end, 0.0, 0.0};
+        }
+    }
+    
+    return chunk_count;
+}
+
+// Longest chain of pass durations through the dependency graph
+static void frame_graph_mark_critical_path(FrameGraph* graph) {
+    double finish[FRAME_MAX_PASSES];
+    int previous[FRAME_MAX_PASSES];
+    int last = -1;
+    
+    for (int i = 0; i < graph->pass_count; i++) {
+        FramePass* pass = &graph->passes[i];
+        pass->critical = false;
+        if (!pass->enabled) continue;
+        
+        double longest = 0.0;
+        previous[i] = -1;
+        for (int j = 0; j < i; j++) {
+            if ((pass->depends & (1u << j)) && finish[j] > longest) {
+                longest = finish[j];
+                previous[i] = j;
+            }
+        }
+        finish[i] = longest + (pass->end_ms - pass->start_ms);
+        if (last < 0 || finish[i] > finish[last]) last = i;
+    }
+    
+    graph->critical_path_ms = last >= 0 ? finish[last] : 0.0;
+    for (int i = last; i >= 0; i = previous[i]) {
+        graph->passes[i].critical = true;
+    }
+}
+
+void frame_graph_execute(Engine* engine, FrameGraph* graph) {
+    double frame_start = frame_graph_now_ms();
+    FrameBatch batch = {engine, graph};
+    FrameArena* arena = &engine->frame_arena;
+    
+    frame_graph_schedule(graph);
+    frame_arena_begin(arena);
+    
+    for (int level = 0; level < graph->level_count; level++) {
+        int chunk_count = frame_graph_gather_level(graph, level);
+        
+        if (chunk_count > 1) {
+            threading_parallel_for(&engine->thread_pool, chunk_count, 1,
+                                   frame_graph_run_chunks, &batch);
+        } else {
+            frame_graph_run_chunks(&batch, 0, chunk_count);
+        }
+        
+        // A pass spans from its first chunk starting to its last finishing
+        for (int c = 0; c < chunk_count; c++) {
+            FrameChunk* chunk = &graph->chunks[c];
+            FramePass* pass = &graph->passes[chunk->pass];
+            if (chunk->begin == 0 || chunk->start_ms < pass->start_ms) pass->start_ms = chunk->start_ms;
+            if (chunk->begin == 0 || chunk->end_ms > pass->end_ms) pass->end_ms = chunk->end_ms;
+        }
+        
+        // Scratch of this level is dead; the next level reuses the bytes
+        frame_arena_release(arena, 0);
+        
+        if (graph->observer) {
+            for (int i = 0; i < graph->pass_count; i++) {
+                if (graph->passes[i].enabled && graph->passes[i].level == level) {
+                    graph->observer(graph->observer_context, engine, i);
+                }
+            }
+        }
+    }
+    
+    graph->executed = 0;
+    for (int i = 0; i < graph->pass_count; i++) {
+        if (graph->passes[i].enabled) graph->executed++;
+    }
+    
+    frame_graph_mark_critical_path(graph);
+    graph->total_ms = frame_graph_now_ms() - frame_start;
+    graph->arena = arena->stats;
+}
+
+void frame_graph_print(const FrameGraph* graph) {
+    printf("Frame graph: %d/%d passes in %d levels, %.3f ms (critical path %.3f ms)\n",
+           graph->executed, graph->pass_count, graph->level_count,
+           graph->total_ms, graph->critical_path_ms);
+    printf("  Transient memory: peak %zu KB of %zu KB, %d allocations, %d from the heap\n",
+           graph->arena.peak_bytes / 1024, graph->arena.capacity / 1024,
+           graph->arena.allocations, graph->arena.heap_allocations);
+    
+    for (int level = 0; level < graph->level_count; level++) {
+        for (int i = 0; i < graph->pass_count; i++) {
+            const FramePass* pass = &graph->passes[i];
+            if (!pass->enabled || pass->level != level) continue;
+            
+            printf("  L%-2d %-20s %8.3f ms%s\n", level, pass->name,
+                   pass->end_ms - pass->start_ms, pass->critical ? "  *" : "");
+        }
+    }
+    
+    for (int i = 0; i < graph->pass_count; i++) {
+        if (!graph->passes[i].enabled) printf("  --  %-20s skipped\n", graph->passes[i].name);
+    }
+}
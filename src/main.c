@@ -2,9 +2,13 @@
 #include <SDL2/SDL.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #define TARGET_FPS 60
-#define FRAME_TIME (1000.0f / TARGET_FPS)
+#define TITLE_INTERVAL_MS 500.0
+#define METRICS_INTERVAL_MS 1000.0
 
 typedef struct {
     SDL_Window* window;
@@ -14,6 +18,22 @@ typedef struct {
     bool keys[SDL_NUM_SCANCODES];
     int mouse_dx;
     int mouse_dy;
+    int latched_dx;             // Motion taken by the late latch, for the next tick
+    int latched_dy;
+    void* quicksave;
+    size_t quicksave_size;
+    Engine* view;               // Engine drawn when the simulation is pipelined
+    SimPipeline* pipeline;
+    PresentQueue* present;      // Render thread, when presentation is pipelined
+    SDL_Texture* frame_textures[PRESENT_MAX_FRAMES];    // One per frame in flight
+    double frame_begin_ms;      // Input read for the frame being rendered
+    FramePacer pacer;
+    LatencyTracker latency;
+    DebugView debug_view;       // Requested view, applied by whichever thread renders
+    double present_ms;          // Last present, for the frame time histogram
+    TelemetrySnapshot* title_snapshot;  // Telemetry at the last title update
+    FlightRecorder flight;      // Used by whichever thread renders
+    MemoryReport memory_report; // At the last memory report, for allocation rates
 } Application;
 
 void application_init(Application* app) {
@@ -71,6 +91,25 @@ void application_init(Application* app) {
     app->running = true;
     app->mouse_dx = 0;
     app->mouse_dy = 0;
+    app->latched_dx = 0;
+    app->latched_dy = 0;
+    app->quicksave = NULL;
+    app->quicksave_size = 0;
+    app->view = NULL;
+    app->pipeline = NULL;
+    app->present = NULL;
+    app->frame_begin_ms = 0.0;
+    frame_pacer_init(&app->pacer, TARGET_FPS);
+    memset(&app->latency, 0, sizeof(LatencyTracker));
+    app->debug_view = DEBUG_VIEW_NONE;
+    app->present_ms = 0.0;
+    app->title_snapshot = NULL;
+    memset(&app->flight, 0, sizeof(FlightRecorder));
+    memory_get_report(&app->memory_report);
+    
+    for (int i = 0; i < PRESENT_MAX_FRAMES; i++) {
+        app->frame_textures[i] = NULL;
+    }
     
     for (int i = 0; i < SDL_NUM_SCANCODES; i++) {
         app->keys[i] = false;
@@ -78,18 +117,67 @@ void application_init(Application* app) {
 }
 
 void application_cleanup(Application* app) {
+    memory_free(app->quicksave);
+    if (app->title_snapshot) telemetry_snapshot_free(app->title_snapshot);
+    memory_free(app->title_snapshot);
+    flight_recorder_cleanup(&app->flight);
+    for (int i = 0; i < PRESENT_MAX_FRAMES; i++) {
+        if (app->frame_textures[i]) SDL_DestroyTexture(app->frame_textures[i]);
+    }
     SDL_DestroyTexture(app->screen_texture);
     SDL_DestroyRenderer(app->renderer);
     SDL_DestroyWindow(app->window);
     SDL_Quit();
 }
 
+void application_quicksave(Application* app, Engine* engine) {
+    size_t size = engine_snapshot_size(engine);
+    if (size > app->quicksave_size) {
+        void* buffer = memory_realloc(app->quicksave, size, MEMORY_TAG_SNAPSHOTS);
+        if (!buffer) return;
+        app->quicksave = buffer;
+    }
+    app->quicksave_size = size;
+    
+    if (engine_snapshot_save(engine, app->quicksave, app->quicksave_size)) {
+        printf("Snapshot saved: %zu bytes in %.3f ms\n", 
+               engine->snapshot_stats.bytes, engine->snapshot_stats.capture_ms);
+    }
+}
+
+void application_quickload(Application* app, Engine* engine) {
+    if (!app->quicksave) return;
+    
+    // Restoring would desynchronise the input log from the state
+    if (engine->replay.mode != REPLAY_OFF) {
+        printf("Snapshot restore is disabled while recording or replaying\n");
+        return;
+    }
+    
+    if (engine_snapshot_load(engine, app->quicksave, app->quicksave_size)) {
+        printf("Snapshot restored: %zu bytes in %.3f ms\n", 
+               engine->snapshot_stats.bytes, engine->snapshot_stats.restore_ms);
+    }
+}
+
+// When an event entered SDL's queue, on the sim_pipeline_now_ms clock
+static double application_event_time(const SDL_Event* event) {
+    Uint32 age = SDL_GetTicks() - event->common.timestamp;
+    return sim_pipeline_now_ms() - age;
+}
+
 void application_handle_events(Application* app, Engine* engine) {
     SDL_Event event;
-    app->mouse_dx = 0;
-    app->mouse_dy = 0;
+    app->mouse_dx = app->latched_dx;
+    app->mouse_dy = app->latched_dy;
+    app->latched_dx = 0;
+    app->latched_dy = 0;
     
     while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP || event.type == SDL_MOUSEMOTION) {
+            latency_input(&app->latency, application_event_time(&event));
+        }
+        
         switch (event.type) {
             case SDL_QUIT:
                 app->running = false;
@@ -104,41 +192,57 @@ void application_handle_events(Application* app, Engine* engine) {
                     app->running = false;
                 }
                 
-                // Toggle features
+                // Toggle features (applied by the next tick so replays see them)
                 if (event.key.keysym.sym == SDLK_b) {
-                    engine->post_fx.bloom_enabled = !engine->post_fx.bloom_enabled;
+                    engine->input.toggles ^= TOGGLE_BLOOM;
                 }
                 if (event.key.keysym.sym == SDLK_m) {
-                    engine->post_fx.motion_blur_enabled = !engine->post_fx.motion_blur_enabled;
+                    engine->input.toggles ^= TOGGLE_MOTION_BLUR;
                 }
                 if (event.key.keysym.sym == SDLK_v) {
-                    engine->post_fx.vignette = !engine->post_fx.vignette;
+                    engine->input.toggles ^= TOGGLE_VIGNETTE;
                 }
                 if (event.key.keysym.sym == SDLK_f) {
-                    engine->post_fx.fxaa_enabled = !engine->post_fx.fxaa_enabled;
+                    engine->input.toggles ^= TOGGLE_FXAA;
                 }
                 
-                // Spawn particles
+                // One-shot actions, consumed by the next simulation tick
                 if (event.key.keysym.sym == SDLK_SPACE) {
-                    for (int i = 0; i < 100; i++) {
-                        Vec3 pos = {
-                            engine->camera.position.x,
-                            engine->camera.position.y,
-                            engine->camera.z_position
-                        };
-                        Vec3 vel = {
-                            (rand() / (float)RAND_MAX - 0.5f) * 5.0f,
-                            (rand() / (float)RAND_MAX - 0.5f) * 5.0f,
-                            (rand() / (float)RAND_MAX) * 8.0f
-                        };
-                        ColorF color = {
-                            rand() / (float)RAND_MAX,
-                            rand() / (float)RAND_MAX,
-                            rand() / (float)RAND_MAX,
-                            1.0f
-                        };
-                        particle_emit(engine, pos, vel, color, 2.0f);
-                    }
+                    engine->input.buttons |= INPUT_EMIT;
+                }
+                if (event.key.keysym.sym == SDLK_e && !event.key.repeat) {
+                    engine->input.buttons |= INPUT_USE;
+                }
+                
+                // Quick save / quick load of the simulation state
+                if (event.key.keysym.sym == SDLK_F5 && !event.key.repeat) {
+                    application_quicksave(app, engine);
+                }
+                if (event.key.keysym.sym == SDLK_F9 && !event.key.repeat) {
+                    application_quickload(app, engine);
+                }
+                
+                // Pass timings of the last rendered frame
+                if (event.key.keysym.sym == SDLK_g && !event.key.repeat) {
+                    frame_graph_print(app->view ? &app->view->frame_graph : &engine->frame_graph);
+                }
+                if (event.key.keysym.sym == SDLK_p && !event.key.repeat) {
+                    profiler_print_summary();
+                }
+                
+                // Memory by subsystem; rates since the last report
+                if (event.key.keysym.sym == SDLK_F4 && !event.key.repeat) {
+                    MemoryReport report;
+                    memory_get_report(&report);
+                    memory_print_report(&report, &app->memory_report);
+                    app->memory_report = report;
+                }
+                
+                // Render-cost views; drawing only, so not part of the input
+                if (event.key.keysym.sym == SDLK_F3 && !event.key.repeat) {
+                    DebugView view = (DebugView)((app->debug_view + 1) % DEBUG_VIEW_COUNT);
+                    __atomic_store_n(&app->debug_view, view, __ATOMIC_RELAXED);
+                    printf("Debug view: %s\n", debug_view_name(view));
                 }
                 break;
                 
@@ -149,98 +253,348 @@ void application_handle_events(Application* app, Engine* engine) {
                 break;
                 
             case SDL_MOUSEMOTION:
-                app->mouse_dx = event.motion.xrel;
-                app->mouse_dy = event.motion.yrel;
+                app->mouse_dx += event.motion.xrel;
+                app->mouse_dy += event.motion.yrel;
                 break;
         }
     }
 }
 
+void application_read_input(Application* app, Engine* engine) {
+    InputFrame* input = &engine->input;
+    
+    // Mouse motion accumulates until a simulation tick consumes it
+    input->mouse_dx += app->mouse_dx;
+    input->mouse_dy += app->mouse_dy;
+    
+    // Held buttons; one-shot bits are set from key events
+    input->buttons &= INPUT_ONESHOT_MASK;
+    if (app->keys[SDL_SCANCODE_W]) input->buttons |= INPUT_FORWARD;
+    if (app->keys[SDL_SCANCODE_S]) input->buttons |= INPUT_BACKWARD;
+    if (app->keys[SDL_SCANCODE_A]) input->buttons |= INPUT_LEFT;
+    if (app->keys[SDL_SCANCODE_D]) input->buttons |= INPUT_RIGHT;
+    if (app->keys[SDL_SCANCODE_LCTRL]) input->buttons |= INPUT_CROUCH;
+}
+
 void application_update(Application* app, Engine* engine, float delta_time) {
-    const float MOVE_SPEED = 5.0f;
-    const float MOUSE_SENSITIVITY = 0.002f;
+    application_read_input(app, engine);
+    
+    // Update engine (runs zero or more fixed ticks)
+    engine_update(engine, delta_time);
+}
+
+// Late latch, called by engine_render just before casting: take mouse motion
+// that arrived since the frame's events were handled. The render camera
+// turns by it now; the next tick receives it through the input frame.
+static void application_late_latch(void* context, InputFrame* pending) {
+    Application* app = (Application*)context;
+    SDL_Event events[64];
     
-    // Mouse look
-    if (app->mouse_dx != 0) {
-        camera_rotate(&engine->camera, app->mouse_dx * MOUSE_SENSITIVITY);
+    SDL_PumpEvents();
+    int count = SDL_PeepEvents(events, 64, SDL_GETEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+    for (int i = 0; i < count; i++) {
+        app->latched_dx += events[i].motion.xrel;
+        app->latched_dy += events[i].motion.yrel;
+        latency_input(&app->latency, application_event_time(&events[i]));
     }
-    if (app->mouse_dy != 0) {
-        float pitch_change = app->mouse_dy * MOUSE_SENSITIVITY;
-        if (pitch_change < 0) {
-            camera_look_up(&engine->camera, -pitch_change);
-        } else {
-            camera_look_down(&engine->camera, pitch_change);
-        }
+    
+    pending->mouse_dx += app->latched_dx;
+    pending->mouse_dy += app->latched_dy;
+    app->frame_begin_ms = sim_pipeline_now_ms();
+}
+
+// Lock a streaming texture so the last post pass writes the frame straight
+// into its memory instead of the colour buffer
+bool application_lock_target(SDL_Texture* texture, RenderTarget* target) {
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(texture, NULL, &pixels, &pitch) != 0) {
+        fprintf(stderr, "Texture lock failed: %s\n", SDL_GetError());
+        return false;
     }
     
-    // Movement
-    if (app->keys[SDL_SCANCODE_W]) {
-        camera_move_forward(&engine->camera, MOVE_SPEED * delta_time);
+    *target = (RenderTarget){(uint32_t*)pixels, pitch};
+    return true;
+}
+
+// Frame rate and frame time percentiles over the last title interval
+static void application_update_title(Application* app, uint64_t frame_number) {
+    TelemetrySnapshot* earlier = app->title_snapshot;
+    TelemetrySnapshot* now = (TelemetrySnapshot*)memory_alloc(sizeof(TelemetrySnapshot), 0,
+                                                              MEMORY_TAG_DIAGNOSTICS);
+    if (!now || !telemetry_snapshot(now)) {
+        memory_free(now);
+        return;
     }
-    if (app->keys[SDL_SCANCODE_S]) {
-        camera_move_backward(&engine->camera, MOVE_SPEED * delta_time);
+    app->title_snapshot = now;
+    if (!earlier) return;
+    
+    // A second snapshot to subtract from, so `now` stays whole for the next
+    // interval; frame times are recorded on this thread, so the two agree
+    TelemetrySnapshot* interval = (TelemetrySnapshot*)memory_alloc(sizeof(TelemetrySnapshot), 0,
+                                                                   MEMORY_TAG_DIAGNOSTICS);
+    if (interval && telemetry_snapshot(interval)) {
+        telemetry_snapshot_subtract(interval, earlier);
+        
+        const TelemetryMetric* frames = &interval->metrics[TELEMETRY_FRAME_TIME];
+        char title[128];
+        snprintf(title, sizeof(title), "FPS: %.1f | p50 %.2f ms | p99 %.2f ms | Frame: %llu",
+                 interval->taken_ms > 0.0 ? frames->count * 1000.0 / interval->taken_ms : 0.0,
+                 telemetry_percentile(frames, 50.0) * 1000.0,
+                 telemetry_percentile(frames, 99.0) * 1000.0,
+                 (unsigned long long)frame_number);
+        SDL_SetWindowTitle(app->window, title);
+        telemetry_snapshot_free(interval);
     }
-    if (app->keys[SDL_SCANCODE_A]) {
-        camera_strafe_left(&engine->camera, MOVE_SPEED * delta_time);
+    memory_free(interval);
+    
+    telemetry_snapshot_free(earlier);
+    memory_free(earlier);
+}
+
+// Present a texture that already holds the finished frame
+void application_present(Application* app, SDL_Texture* texture, uint64_t frame_number) {
+    SDL_RenderClear(app->renderer);
+    SDL_RenderCopy(app->renderer, texture, NULL, NULL);
+    SDL_RenderPresent(app->renderer);
+    
+    double now = sim_pipeline_now_ms();
+    if (app->present_ms > 0.0) {
+        telemetry_record(TELEMETRY_FRAME_TIME, (uint64_t)((now - app->present_ms) * 1.0e6));
     }
-    if (app->keys[SDL_SCANCODE_D]) {
-        camera_strafe_right(&engine->camera, MOVE_SPEED * delta_time);
+    telemetry_add(TELEMETRY_FRAMES, 1);
+    app->present_ms = now;
+    
+    if (!app->title_snapshot || now - app->title_snapshot->taken_ms >= TITLE_INTERVAL_MS) {
+        application_update_title(app, frame_number);
     }
+    telemetry_poll(now);
+}
+
+void application_render(Application* app, Engine* engine) {
+    // Render engine straight into the screen texture
+    if (!application_lock_target(app->screen_texture, &engine->buffers.output)) return;
+    app->frame_begin_ms = sim_pipeline_now_ms();
+    debug_view_set(engine, app->debug_view);
+    engine_render(engine);
+    flight_recorder_frame(&app->flight, engine, sim_pipeline_now_ms());
+    engine->buffers.output = (RenderTarget){0};
+    SDL_UnlockTexture(app->screen_texture);
     
-    // Crouch
-    camera_crouch(&engine->camera, app->keys[SDL_SCANCODE_LCTRL]);
+    application_present(app, app->screen_texture, engine->frame_count);
+    latency_present(&app->latency, app->frame_begin_ms, sim_pipeline_now_ms());
+}
+
+// Draw the latest published tick into `target`
+static void application_render_view(Application* app, RenderTarget target) {
+    Engine* view = app->view;
+    const RenderState* state = sim_pipeline_acquire(app->pipeline);
+    if (state) render_state_apply(view, state, sim_pipeline_now_ms());
+    view->frame_count++;
+    debug_view_set(view, __atomic_load_n(&app->debug_view, __ATOMIC_RELAXED));
     
-    // Open/close nearby doors
-    if (app->keys[SDL_SCANCODE_E]) {
-        int px = (int)engine->camera.position.x;
-        int py = (int)engine->camera.position.y;
-        
-        for (int dy = -1; dy <= 1; dy++) {
-            for (int dx = -1; dx <= 1; dx++) {
-                for (int i = 0; i < engine->world.door_count; i++) {
-                    Door* door = &engine->world.doors[i];
-                    if (door->x == px + dx && door->y == py + dy) {
-                        if (door->open_amount < 0.5f) {
-                            door_open(door);
-                        } else {
-                            door_close(door);
-                        }
-                    }
-                }
-            }
+    view->buffers.output = target;
+    engine_render(view);
+    flight_recorder_frame(&app->flight, view, sim_pipeline_now_ms());
+    view->buffers.output = (RenderTarget){0};
+}
+
+// Render thread body when presentation is pipelined
+static void application_render_frame(void* context, PresentFrame* frame) {
+    application_render_view((Application*)context, frame->target);
+}
+
+// Render thread targets: one streaming texture per frame in flight, kept
+// locked except while the main thread presents it
+bool application_start_present(Application* app, PresentQueue* queue, int frames_in_flight) {
+    RenderTarget targets[PRESENT_MAX_FRAMES];
+    int count = frames_in_flight < PRESENT_MAX_FRAMES ? frames_in_flight : PRESENT_MAX_FRAMES;
+    
+    for (int i = 0; i < count; i++) {
+        app->frame_textures[i] = SDL_CreateTexture(app->renderer, SDL_PIXELFORMAT_ARGB8888,
+                                                   SDL_TEXTUREACCESS_STREAMING,
+                                                   SCREEN_WIDTH, SCREEN_HEIGHT);
+        if (!app->frame_textures[i] || !application_lock_target(app->frame_textures[i], &targets[i])) {
+            fprintf(stderr, "Frame texture creation failed: %s\n", SDL_GetError());
+            return false;
         }
     }
     
-    // Update engine
-    engine_update(engine, delta_time);
+    if (!present_queue_start(queue, count, targets, application_render_frame, app)) return false;
+    app->present = queue;
+    return true;
 }
 
-void application_render(Application* app, Engine* engine) {
-    // Render engine to buffer
-    engine_render(engine);
+// Pipelined frame: hand input to the simulation thread, then present the
+// next frame. With a render thread that frame was drawn while the previous
+// one was being presented; otherwise it is drawn here.
+void application_pipelined_frame(Application* app, Engine* engine) {
+    sim_pipeline_lock(app->pipeline);
+    application_handle_events(app, engine);
+    application_read_input(app, engine);
+    sim_pipeline_unlock(app->pipeline);
     
-    // Update SDL texture
-    void* pixels;
-    int pitch;
-    SDL_LockTexture(app->screen_texture, NULL, &pixels, &pitch);
-    memcpy(pixels, engine->buffers.color_buffer, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    if (app->present) {
+        PresentFrame* frame = present_queue_acquire(app->present, 100.0);
+        if (!frame) return;
+        
+        SDL_Texture* texture = app->frame_textures[frame->index];
+        SDL_UnlockTexture(texture);
+        application_present(app, texture, frame->number);
+        latency_present(&app->latency, frame->begin_ms, sim_pipeline_now_ms());
+        
+        // Lock again for the render thread; without a target it cannot go on
+        if (!application_lock_target(texture, &frame->target)) {
+            app->running = false;
+            return;
+        }
+        present_queue_release(app->present, frame);
+        return;
+    }
+    
+    RenderTarget target;
+    if (!application_lock_target(app->screen_texture, &target)) return;
+    double begin_ms = sim_pipeline_now_ms();
+    application_render_view(app, target);
     SDL_UnlockTexture(app->screen_texture);
+    application_present(app, app->screen_texture, app->view->frame_count);
+    latency_present(&app->latency, begin_ms, sim_pipeline_now_ms());
+}
+
+// Drive the engine from a replay log without opening a window. Rendered
+// replays keep a flight recorder whose dumps name the log they came from.
+int application_run_replay(const char* filename, bool render, double flight_threshold_ms,
+                           const char* flight_dir) {
+    static Engine engine;
+    static FlightRecorder flight;
+    uint32_t seed;
     
-    // Present to screen
-    SDL_RenderClear(app->renderer);
-    SDL_RenderCopy(app->renderer, app->screen_texture, NULL, NULL);
+    if (!replay_read_seed(filename, &seed)) {
+        fprintf(stderr, "Cannot read replay log %s\n", filename);
+        return 1;
+    }
     
-    // Draw simple FPS counter
-    char fps_text[64];
-    snprintf(fps_text, sizeof(fps_text), "FPS: %.1f | Frame: %llu", 
-             1.0f / engine->delta_time, engine->frame_count);
+    engine_init_seeded(&engine, seed);
+    scene_load_demo(&engine);
     
-    SDL_SetWindowTitle(app->window, fps_text);
+    if (!replay_begin_playback(&engine, filename)) {
+        engine_cleanup(&engine);
+        return 1;
+    }
     
-    SDL_RenderPresent(app->renderer);
+    if (render && flight_recorder_init(&flight, flight_threshold_ms, flight_dir)) {
+        flight.seed = seed;
+        flight.replay_file = filename;
+        flight_recorder_install_signal();
+    }
+    
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 sim_ticks = 0;
+    Uint64 render_ticks = 0;
+    double critical_path_ms = 0.0;
+    
+    while (!engine.replay.finished) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        engine_update(&engine, engine.fixed_dt);
+        Uint64 mid = SDL_GetPerformanceCounter();
+        
+        if (render) {
+            engine_render(&engine);
+            critical_path_ms += engine.frame_graph.critical_path_ms;
+            flight_recorder_frame(&flight, &engine, sim_pipeline_now_ms());
+        }
+        
+        Uint64 end = SDL_GetPerformanceCounter();
+        sim_ticks += mid - start;
+        render_ticks += end - mid;
+    }
+    
+    // The final tick only discovered the end of the log
+    uint64_t ticks = engine.tick_count > 0 ? engine.tick_count - 1 : 0;
+    double sim_ms = sim_ticks * 1000.0 / frequency;
+    double render_ms = render_ticks * 1000.0 / frequency;
+    
+    printf("Replay: %s (seed %u)\n", filename, seed);
+    printf("  Ticks:      %llu\n", (unsigned long long)ticks);
+    printf("  Simulation: %.3f ms total, %.4f ms/tick\n", sim_ms, 
+           ticks ? sim_ms / ticks : 0.0);
+    if (render) {
+        printf("  Rendering:  %.3f ms total, %.4f ms/frame\n", render_ms, 
+               ticks ? render_ms / ticks : 0.0);
+        printf("  Critical:   %.4f ms/frame (longest pass chain)\n",
+               ticks ? critical_path_ms / ticks : 0.0);
+    }
+    printf("  Checksum:   %08x\n", replay_state_checksum(&engine));
+    
+    flight_recorder_cleanup(&flight);
+    engine_cleanup(&engine);
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
+    const char* record_path = NULL;
+    const char* replay_path = NULL;
+    const char* trace_path = NULL;
+    const char* metrics_target = NULL;
+    const char* flight_dir = NULL;
+    double flight_threshold_ms = 0.0;
+    bool replay_render = false;
+    bool pipelined = false;
+    bool late_latch = true;
+    bool counters = false;
+    int frames_in_flight = 1;
+    double frames_per_second = TARGET_FPS;
+    uint32_t seed = (uint32_t)time(NULL);
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--render") == 0) {
+            replay_render = true;
+        } else if (strcmp(argv[i], "--pipeline") == 0) {
+            pipelined = true;
+        } else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            pipelined = true;
+            frames_in_flight = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            frames_per_second = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-late-latch") == 0) {
+            late_latch = false;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--counters") == 0) {
+            counters = true;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_target = argv[++i];
+        } else if (strcmp(argv[i], "--flight-threshold") == 0 && i + 1 < argc) {
+            flight_threshold_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--flight-dir") == 0 && i + 1 < argc) {
+            flight_dir = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--seed N] [--record FILE] [--pipeline] "
+                            "[--frames-in-flight N] [--fps N] [--no-late-latch] [--trace FILE] "
+                            "[--counters] [--metrics FILE|unix:PATH] [--flight-threshold MS] "
+                            "[--flight-dir DIR] [--replay FILE [--render]]\n", argv[0]);
+            return 1;
+        }
+    }
+    
+    if (counters) profiler_enable_counters();
+    if (metrics_target) telemetry_export_every(metrics_target, METRICS_INTERVAL_MS);
+    
+    if (replay_path) {
+        int result = application_run_replay(replay_path, replay_render, flight_threshold_ms,
+                                            flight_dir);
+        if (metrics_target && !telemetry_export(metrics_target)) {
+            fprintf(stderr, "Cannot export telemetry to %s\n", metrics_target);
+        }
+        return result;
+    }
+    
     printf("Advanced Raycasting Engine\n");
     printf("===========================\n");
     printf("Controls:\n");
@@ -253,6 +607,10 @@ int main(int argc, char* argv[]) {
     printf("  M - Toggle motion blur\n");
     printf("  V - Toggle vignette\n");
     printf("  F - Toggle FXAA\n");
+    printf("  F5 / F9 - Quick save / quick load\n");
+    printf("  G - Print frame graph timings\n");
+    printf("  P - Print profiler summary\n");
+    printf("  F4 - Print memory by subsystem\n");
     printf("  ESC - Quit\n");
     printf("===========================\n\n");
     
@@ -260,79 +618,103 @@ int main(int argc, char* argv[]) {
     Engine engine;
     
     application_init(&app);
-    engine_init(&engine);
-    
-    // Generate some procedural textures
-    for (int i = 0; i < 4 && engine.texture_count < MAX_TEXTURES; i++) {
-        Texture* tex = &engine.textures[engine.texture_count];
-        tex->width = TEXTURE_SIZE;
-        tex->height = TEXTURE_SIZE;
-        tex->pixels = (uint32_t*)malloc(TEXTURE_SIZE * TEXTURE_SIZE * sizeof(uint32_t));
-        
-        // Generate different patterns
-        for (int y = 0; y < TEXTURE_SIZE; y++) {
-            for (int x = 0; x < TEXTURE_SIZE; x++) {
-                uint8_t r, g, b;
-                
-                switch (i) {
-                    case 0: // Brick pattern
-                        r = 150 + (x % 8 < 1 || y % 8 < 1 ? 50 : 0);
-                        g = 80 + (x % 8 < 1 || y % 8 < 1 ? 30 : 0);
-                        b = 70 + (x % 8 < 1 || y % 8 < 1 ? 20 : 0);
-                        break;
-                    case 1: // Stone pattern
-                        r = g = b = 100 + ((x * y) % 50);
-                        break;
-                    case 2: // Wood grain
-                        r = 139 + (int)(20 * perlin_noise_2d(x * 0.1f, y * 0.5f));
-                        g = 90 + (int)(15 * perlin_noise_2d(x * 0.1f, y * 0.5f));
-                        b = 60 + (int)(10 * perlin_noise_2d(x * 0.1f, y * 0.5f));
-                        break;
-                    case 3: // Metal
-                        r = g = b = 180 + (int)(30 * perlin_noise_2d(x * 0.2f, y * 0.2f));
-                        break;
-                }
-                
-                Color c = {r, g, b, 255};
-                tex->pixels[y * TEXTURE_SIZE + x] = color_to_uint32(c);
-            }
+    engine_init_seeded(&engine, seed);
+    scene_load_demo(&engine);
+    
+    MemoryStats memory;
+    memory_get_stats(&memory);
+    printf("Memory: %lld KB in %lld blocks (%lld KB huge pages, %lld KB transparent huge pages)\n",
+           (long long)memory.live_bytes / 1024, (long long)memory.allocations,
+           (long long)memory.huge_page_bytes / 1024, (long long)memory.transparent_bytes / 1024);
+    
+    if (record_path && replay_begin_record(&engine, record_path)) {
+        printf("Recording input to %s (seed %u)\n", record_path, seed);
+    }
+    
+    // Keep the last seconds of frames; dump them on a spike or SIGUSR1
+    if (flight_recorder_init(&app.flight, flight_threshold_ms, flight_dir)) {
+        app.flight.seed = seed;
+        // Playback runs through application_run_replay, which names its own log
+        app.flight.replay_file = engine.replay.mode == REPLAY_RECORDING ? record_path : NULL;
+        flight_recorder_install_signal();
+    }
+    
+    // Simulate on a separate thread and render published ticks
+    static SimPipeline pipeline;
+    static PresentQueue present;
+    static Engine view;
+    if (pipelined) {
+        engine_init_seeded(&view, seed);
+        if (sim_pipeline_start(&pipeline, &engine)) {
+            app.view = &view;
+            app.pipeline = &pipeline;
+            printf("Simulation runs on its own thread\n");
+        } else {
+            engine_cleanup(&view);
         }
-        
-        engine.texture_count++;
     }
     
-    // Add some dynamic lights
-    if (engine.light_count < MAX_LIGHTS) {
-        engine.lights[engine.light_count++] = (Light){
-            {10.0f, 10.0f, 2.0f},
-            {1.0f, 0.3f, 0.1f, 1.0f},
-            8.0f,
-            12.0f,
-            true,
-            0.2f
-        };
+    // Render ahead on another thread while this one presents
+    if (app.view && frames_in_flight > 1 && application_start_present(&app, &present, frames_in_flight)) {
+        printf("Rendering %d frames in flight\n", present.frames_in_flight);
+    }
+    
+    // Re-sample mouse look just before casting; the render thread cannot
+    // pump SDL events, so pipelined runs go without
+    if (late_latch && !app.view) {
+        engine.late_latch = application_late_latch;
+        engine.late_latch_context = &app;
     }
     
-    // Main loop
-    Uint32 last_time = SDL_GetTicks();
+    // Main loop, paced to deadlines (0 fps leaves it to vsync)
+    frame_pacer_init(&app.pacer, frames_per_second);
+    double last_time = sim_pipeline_now_ms();
     
     while (app.running) {
-        Uint32 current_time = SDL_GetTicks();
-        float delta_time = (current_time - last_time) / 1000.0f;
+        double current_time = sim_pipeline_now_ms();
+        float delta_time = (float)(current_time - last_time) / 1000.0f;
         last_time = current_time;
         
         // Cap delta time to prevent huge jumps
         if (delta_time > 0.1f) delta_time = 0.1f;
         
-        application_handle_events(&app, &engine);
-        application_update(&app, &engine, delta_time);
-        application_render(&app, &engine);
-        
-        // Simple frame rate limiting
-        Uint32 frame_time = SDL_GetTicks() - current_time;
-        if (frame_time < FRAME_TIME) {
-            SDL_Delay((Uint32)(FRAME_TIME - frame_time));
+        if (app.view) {
+            application_pipelined_frame(&app, &engine);
+        } else {
+            application_handle_events(&app, &engine);
+            application_update(&app, &engine, delta_time);
+            application_render(&app, &engine);
         }
+        
+        frame_pacer_wait(&app.pacer);
+    }
+    
+    frame_pacer_print_stats(&app.pacer);
+    latency_print_stats(&app.latency);
+    
+    if (app.present) {
+        present_queue_stop(&present);
+        present_queue_print_stats(&present);
+    }
+    
+    if (app.view) {
+        sim_pipeline_stop(&pipeline, &view);
+        printf("Pipeline: %llu ticks published, %llu frames drawn, %llu repeated, "
+               "%.4f ms/tick simulating\n",
+               (unsigned long long)pipeline.stats.published,
+               (unsigned long long)pipeline.stats.rendered,
+               (unsigned long long)pipeline.stats.repeated,
+               pipeline.stats.published ? pipeline.stats.update_ms / pipeline.stats.published : 0.0);
+        engine_cleanup(&view);
+    }
+    
+    // Threads have stopped, so the event rings are stable
+    if (trace_path && profiler_write_trace(trace_path)) {
+        printf("Profiler trace written to %s\n", trace_path);
+    }
+    
+    if (metrics_target && !telemetry_export(metrics_target)) {
+        fprintf(stderr, "Cannot export telemetry to %s\n", metrics_target);
     }
     
     engine_cleanup(&engine);
@@ -30,9 +30,27 @@ int map_get_tile(WorldMap* map, int x, int y) {
 void map_set_tile(WorldMap* map, int x, int y, int value) {
     if (x >= 0 && x < MAP_WIDTH && y >= 0 && y < MAP_HEIGHT) {
         map->tiles[y][x] = value;
+        map_mark_changed(map, x, y);
     }
 }
 
+// Change log: consumers keep the last revision they processed and replay
+// entries from there; once they fall a full ring behind they rebuild instead
+void map_mark_changed(WorldMap* map, int x, int y) {
+    MapChange* change = &map->change_log[map->revision % MAP_CHANGE_LOG_SIZE];
+    change->x = (int16_t)x;
+    change->y = (int16_t)y;
+    map->revision++;
+}
+
+void map_invalidate_all(WorldMap* map) {
+    map->revision += MAP_CHANGE_LOG_SIZE + 1;
+}
+
+bool map_changes_overflowed(const WorldMap* map, uint32_t since) {
+    return map->revision - since > MAP_CHANGE_LOG_SIZE;
+}
+
 float map_get_floor_height(WorldMap* map, int x, int y) {
     if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) {
         return 0.0f;
@@ -65,6 +83,7 @@ void map_load_from_file(WorldMap* map, const char* filename) {
     }
     
     fclose(file);
+    map_invalidate_all(map);
 }
 
 // Cellular automata for cave generation
@@ -154,6 +173,7 @@ static void carve_corridor(WorldMap* map, int x1, int y1, int x2, int y2) {
 void map_generate_procedural(WorldMap* map, uint32_t seed) {
     map_seed = seed;
     map->door_count = 0;
+    map->active_door_count = 0;
     
     // Initialize everything to walls
     for (int y = 0; y < MAP_HEIGHT; y++) {
@@ -270,6 +290,8 @@ void map_generate_procedural(WorldMap* map, uint32_t seed) {
             map->ceiling_textures[y][x] = rand_range(0, 3);
         }
     }
+    
+    map_invalidate_all(map);
 }
 
 // Optimization utilities (stubs for enterprise features)
@@ -292,25 +314,3 @@ void optimize_spatial_partitioning(Engine* engine) {
     // Spatial partitioning (quadtree, octree, BSP) for faster queries
     // Reduces collision checks and ray intersection tests
 }
-
-// Performance profiling
-void profile_begin(ProfileSection* section) {
-    // Would use high-resolution timer
-    section->start_time = 0;
-    section->call_count++;
-}
-
-void profile_end(ProfileSection* section) {
-    // Would calculate elapsed time
-    section->total_time += 0;
-}
-
-void profile_reset(ProfileSection* section) {
-    section->total_time = 0;
-    section->call_count = 0;
-}
-
-float profile_get_ms(ProfileSection* section) {
-    if (section->call_count == 0) return 0.0f;
-    return (float)section->total_time / section->call_count / 1000.0f;
-}
@@ -0,0 +1,268 @@
+#include "../include/engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Aligned allocation for all engine memory. Every block starts with a
+// MEMORY_ALIGNMENT-sized header recording how it was obtained and which
+// subsystem it is charged to, so memory_free works for all of them and the
+// per-tag totals stay exact. Large requests with MEMORY_HUGE_PAGES try
+// explicit 2 MB pages first, then transparent huge pages, then fall back to
+// ordinary aligned memory.
+//
+// Totals are updated with relaxed atomics; a report is a consistent view
+// of each counter, not of all of them at one instant.
+#define MEMORY_HUGE_PAGE_SIZE (2u * 1024u * 1024u)
+
+typedef enum {
+    MEMORY_KIND_ALIGNED,        // aligned heap block
+    MEMORY_KIND_MAPPED,         // explicit huge page mapping
+    MEMORY_KIND_TRANSPARENT     // heap block advised for transparent huge pages
+} MemoryKind;
+
+typedef struct {
+    void* base;
+    size_t bytes;
+    int kind;
+    int tag;
+} MemoryHeader;
+
+static MemoryStats memory_stats;
+static MemoryTagStats memory_tags[MEMORY_TAG_COUNT];
+
+static const char* memory_tag_names[MEMORY_TAG_COUNT] = {
+    "render", "textures", "frame_arena", "compute", "audio", "entities",
+    "navigation", "scripts", "snapshots", "threads", "diagnostics"
+};
+
+// Tags whose blocks belong to an engine and are gone once every engine has
+// been cleaned up. Audio buffers are global, snapshots and diagnostics are
+// owned by the front end.
+#define MEMORY_ENGINE_TAGS (~((1u << MEMORY_TAG_AUDIO) | (1u << MEMORY_TAG_SNAPSHOTS) | \
+                              (1u << MEMORY_TAG_DIAGNOSTICS)))
+
+static size_t memory_round(size_t size, size_t alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+static void memory_count(size_t bytes, int kind, int tag, int sign) {
+    int64_t delta = sign * (int64_t)bytes;
+    __atomic_fetch_add(&memory_stats.live_bytes, delta, __ATOMIC_RELAXED);
+    if (kind == MEMORY_KIND_MAPPED) {
+        __atomic_fetch_add(&memory_stats.huge_page_bytes, delta, __ATOMIC_RELAXED);
+    } else if (kind == MEMORY_KIND_TRANSPARENT) {
+        __atomic_fetch_add(&memory_stats.transparent_bytes, delta, __ATOMIC_RELAXED);
+    }
+    if (sign > 0) __atomic_fetch_add(&memory_stats.allocations, 1, __ATOMIC_RELAXED);
+    
+    MemoryTagStats* stats = &memory_tags[tag];
+    int64_t live = __atomic_add_fetch(&stats->live_bytes, delta, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->blocks, sign, __ATOMIC_RELAXED);
+    if (sign < 0) return;
+    
+    __atomic_fetch_add(&stats->allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->allocated_bytes, (int64_t)bytes, __ATOMIC_RELAXED);
+    int64_t peak = __atomic_load_n(&stats->peak_bytes, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&stats->peak_bytes, &peak, live, true,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // `peak` was reloaded; retry while this allocation is still higher
+    }
+}
+
+static void* memory_aligned_block(size_t bytes, size_t alignment) {
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, alignment);
+#else
+    void* block = NULL;
+    return posix_memalign(&block, alignment, bytes) == 0 ? block : NULL;
+#endif
+}
+
+static void memory_aligned_block_free(void* block) {
+#if defined(_WIN32)
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+// Explicit huge pages: MAP_HUGETLB on Linux, large pages on Windows (needs
+// the lock-pages privilege). Fails quietly when none are available.
+static void* memory_map_huge(size_t bytes) {
+#if defined(_WIN32)
+    SIZE_T large_page = GetLargePageMinimum();
+    if (large_page == 0 || bytes % large_page != 0) return NULL;
+    return VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+#elif defined(MAP_HUGETLB)
+    void* block = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    return block == MAP_FAILED ? NULL : block;
+#else
+    (void)bytes;
+    return NULL;
+#endif
+}
+
+static void memory_unmap_huge(void* block, size_t bytes) {
+#if defined(_WIN32)
+    (void)bytes;
+    VirtualFree(block, 0, MEM_RELEASE);
+#else
+    munmap(block, bytes);
+#endif
+}
+
+// MEMORY_ALIGNMENT-aligned block of `size` bytes charged to `tag`, or NULL
+// when out of memory. Release with memory_free.
+void* memory_alloc(size_t size, uint32_t flags, MemoryTag tag) {
+    size_t bytes = MEMORY_ALIGNMENT + memory_round(size > 0 ? size : 1, MEMORY_ALIGNMENT);
+    void* base = NULL;
+    int kind = MEMORY_KIND_ALIGNED;
+    
+    if ((flags & MEMORY_HUGE_PAGES) && size >= MEMORY_HUGE_PAGE_SIZE / 2) {
+        bytes = memory_round(bytes, MEMORY_HUGE_PAGE_SIZE);
+        base = memory_map_huge(bytes);
+        kind = MEMORY_KIND_MAPPED;
+        
+#if defined(MADV_HUGEPAGE)
+        if (!base) {
+            base = memory_aligned_block(bytes, MEMORY_HUGE_PAGE_SIZE);
+            if (base && madvise(base, bytes, MADV_HUGEPAGE) == 0) {
+                kind = MEMORY_KIND_TRANSPARENT;
+            } else {
+                kind = MEMORY_KIND_ALIGNED;
+            }
+        }
+#endif
+    }
+    
+    if (!base) {
+        base = memory_aligned_block(bytes, MEMORY_ALIGNMENT);
+        kind = MEMORY_KIND_ALIGNED;
+    }
+    if (!base) return NULL;
+    
+    MemoryHeader* header = (MemoryHeader*)base;
+    header->base = base;
+    header->bytes = bytes;
+    header->kind = kind;
+    header->tag = tag;
+    memory_count(bytes, kind, tag, 1);
+    
+    void* block = (uint8_t*)base + MEMORY_ALIGNMENT;
+    if (flags & MEMORY_ZERO) memset(block, 0, size);
+    return block;
+}
+
+// Grows `ptr` (NULL allocates) to at least `size` bytes, keeping its
+// contents. On failure returns NULL and `ptr` stays valid. The grown block
+// is ordinary aligned memory whatever the flags of the original were.
+void* memory_realloc(void* ptr, size_t size, MemoryTag tag) {
+    if (!ptr) return memory_alloc(size, 0, tag);
+    
+    MemoryHeader* header = (MemoryHeader*)((uint8_t*)ptr - MEMORY_ALIGNMENT);
+    size_t capacity = header->bytes - MEMORY_ALIGNMENT;
+    if (size <= capacity && header->tag == (int)tag) return ptr;
+    
+    void* grown = memory_alloc(size, 0, tag);
+    if (!grown) return NULL;
+    memcpy(grown, ptr, size < capacity ? size : capacity);
+    memory_free(ptr);
+    return grown;
+}
+
+void memory_free(void* ptr) {
+    if (!ptr) return;
+    
+    MemoryHeader* header = (MemoryHeader*)((uint8_t*)ptr - MEMORY_ALIGNMENT);
+    void* base = header->base;
+    size_t bytes = header->bytes;
+    int kind = header->kind;
+    memory_count(bytes, kind, header->tag, -1);
+    
+    if (kind == MEMORY_KIND_MAPPED) {
+        memory_unmap_huge(base, bytes);
+    } else {
+        memory_aligned_block_free(base);
+    }
+}
+
+void memory_get_stats(MemoryStats* stats) {
+    stats->live_bytes = __atomic_load_n(&memory_stats.live_bytes, __ATOMIC_RELAXED);
+    stats->huge_page_bytes = __atomic_load_n(&memory_stats.huge_page_bytes, __ATOMIC_RELAXED);
+    stats->transparent_bytes = __atomic_load_n(&memory_stats.transparent_bytes, __ATOMIC_RELAXED);
+    stats->allocations = __atomic_load_n(&memory_stats.allocations, __ATOMIC_RELAXED);
+}
+
+const char* memory_tag_name(MemoryTag tag) {
+    return tag >= 0 && tag < MEMORY_TAG_COUNT ? memory_tag_names[tag] : "unknown";
+}
+
+void memory_get_report(MemoryReport* report) {
+    for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+        const MemoryTagStats* stats = &memory_tags[i];
+        MemoryTagStats* out = &report->tags[i];
+        out->live_bytes = __atomic_load_n(&stats->live_bytes, __ATOMIC_RELAXED);
+        out->peak_bytes = __atomic_load_n(&stats->peak_bytes, __ATOMIC_RELAXED);
+        out->blocks = __atomic_load_n(&stats->blocks, __ATOMIC_RELAXED);
+        out->allocations = __atomic_load_n(&stats->allocations, __ATOMIC_RELAXED);
+        out->allocated_bytes = __atomic_load_n(&stats->allocated_bytes, __ATOMIC_RELAXED);
+    }
+    report->taken_ms = sim_pipeline_now_ms();
+}
+
+// Per-tag table; allocation rates are over the time since `earlier`, when
+// given. Counts include the block headers and rounding, i.e. what the
+// allocations actually cost.
+void memory_print_report(const MemoryReport* report, const MemoryReport* earlier) {
+    double seconds = earlier ? (report->taken_ms - earlier->taken_ms) / 1000.0 : 0.0;
+    MemoryTagStats total = {0};
+    
+    printf("Memory: tag              live KB    peak KB    blocks     allocs   allocs/s     KB/s\n");
+    for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+        const MemoryTagStats* stats = &report->tags[i];
+        if (stats->allocations == 0) continue;
+        
+        printf("        %-14s %10.1f %10.1f %9lld %10lld", memory_tag_names[i],
+               stats->live_bytes / 1024.0, stats->peak_bytes / 1024.0,
+               (long long)stats->blocks, (long long)stats->allocations);
+        if (seconds > 0.0) {
+            const MemoryTagStats* before = &earlier->tags[i];
+            printf(" %10.1f %8.1f\n", (stats->allocations - before->allocations) / seconds,
+                   (stats->allocated_bytes - before->allocated_bytes) / 1024.0 / seconds);
+        } else {
+            printf(" %10s %8s\n", "-", "-");
+        }
+        
+        total.live_bytes += stats->live_bytes;
+        total.blocks += stats->blocks;
+        total.allocations += stats->allocations;
+    }
+    printf("        %-14s %10.1f %10s %9lld %10lld\n", "total", total.live_bytes / 1024.0, "",
+           (long long)total.blocks, (long long)total.allocations);
+    printf("        Engine struct: %.1f KB per engine in fixed arrays, not counted above\n",
+           sizeof(Engine) / 1024.0);
+}
+
+// Reports engine-owned tags that still hold blocks. Meant for when every
+// engine has been cleaned up; true when nothing is left.
+bool memory_check_leaks(void) {
+    bool clean = true;
+    for (int i = 0; i < MEMORY_TAG_COUNT; i++) {
+        if (!(MEMORY_ENGINE_TAGS & (1u << i))) continue;
+        
+        int64_t blocks = __atomic_load_n(&memory_tags[i].blocks, __ATOMIC_RELAXED);
+        if (blocks == 0) continue;
+        fprintf(stderr, "Memory leak: %s still holds %lld blocks, %.1f KB\n", memory_tag_names[i],
+                (long long)blocks, __atomic_load_n(&memory_tags[i].live_bytes, __ATOMIC_RELAXED) / 1024.0);
+        clean = false;
+    }
+    return clean;
+}
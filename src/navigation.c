@@ -0,0 +1,695 @@
+#include "../include/engine.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Navigation over WorldMap.tiles on an 8-connected grid. Diagonal steps may
+// not cut wall corners. Costs are integers (10 straight, 14 diagonal) so
+// flow fields and path searches agree and stay deterministic.
+#define NAV_CELLS (MAP_WIDTH * MAP_HEIGHT)
+#define NAV_COST_STRAIGHT 10
+#define NAV_COST_DIAGONAL 14
+#define NAV_DOOR_OPEN 0.9f
+
+static const int nav_dx[8] = {1, 0, -1, 0, 1, -1, -1, 1};
+static const int nav_dy[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+
+static inline int nav_mode(uint32_t flags) {
+    return (flags & NAV_THROUGH_DOORS) ? 1 : 0;
+}
+
+static inline bool nav_walk(const uint8_t* grid, int x, int y) {
+    if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) return false;
+    return grid[y * MAP_WIDTH + x] != 0;
+}
+
+static inline bool nav_can_step(const uint8_t* grid, int x, int y, int dx, int dy) {
+    if (!nav_walk(grid, x + dx, y + dy)) return false;
+    if (dx != 0 && dy != 0) {
+        return nav_walk(grid, x + dx, y) && nav_walk(grid, x, y + dy);
+    }
+    return true;
+}
+
+static inline uint32_t nav_octile(int ax, int ay, int bx, int by) {
+    int dx = abs(ax - bx);
+    int dy = abs(ay - by);
+    int lo = dx < dy ? dx : dy;
+    int hi = dx < dy ? dy : dx;
+    return (uint32_t)(NAV_COST_STRAIGHT * hi + (NAV_COST_DIAGONAL - NAV_COST_STRAIGHT) * lo);
+}
+
+static inline Vec2 nav_cell_center(int cell) {
+    return (Vec2){(cell % MAP_WIDTH) + 0.5f, (cell / MAP_WIDTH) + 0.5f};
+}
+
+// =============================================================================
+// Indexed binary heap keyed on a cost array, ties broken by cell index
+// =============================================================================
+
+typedef struct {
+    int* items;
+    int* index;
+    int size;
+    const uint32_t* key;
+} NavHeap;
+
+static inline bool nav_heap_less(const NavHeap* heap, int a, int b) {
+    uint32_t ka = heap->key[a];
+    uint32_t kb = heap->key[b];
+    return ka < kb || (ka == kb && a < b);
+}
+
+static void nav_heap_swap(NavHeap* heap, int i, int j) {
+    int a = heap->items[i];
+    int b = heap->items[j];
+    heap->items[i] = b;
+    heap->items[j] = a;
+    heap->index[b] = i;
+    heap->index[a] = j;
+}
+
+static void nav_heap_sift_up(NavHeap* heap, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!nav_heap_less(heap, heap->items[i], heap->items[parent])) break;
+        nav_heap_swap(heap, i, parent);
+        i = parent;
+    }
+}
+
+static void nav_heap_sift_down(NavHeap* heap, int i) {
+    for (;;) {
+        int left = 2 * i + 1;
+        int best = i;
+        if (left < heap->size && nav_heap_less(heap, heap->items[left], heap->items[best])) {
+            best = left;
+        }
+        if (left + 1 < heap->size && nav_heap_less(heap, heap->items[left + 1], heap->items[best])) {
+            best = left + 1;
+        }
+        if (best == i) break;
+        nav_heap_swap(heap, i, best);
+        i = best;
+    }
+}
+
+// Insert, or move up after the cell's key decreased
+static void nav_heap_push(NavHeap* heap, int cell) {
+    int i = heap->index[cell];
+    if (i < 0) {
+        i = heap->size++;
+        heap->items[i] = cell;
+        heap->index[cell] = i;
+    }
+    nav_heap_sift_up(heap, i);
+}
+
+static int nav_heap_pop(NavHeap* heap) {
+    int top = heap->items[0];
+    heap->index[top] = -1;
+    heap->size--;
+    if (heap->size > 0) {
+        heap->items[0] = heap->items[heap->size];
+        heap->index[heap->items[0]] = 0;
+        nav_heap_sift_down(heap, 0);
+    }
+    return top;
+}
+
+// =============================================================================
+// Walkability grid, kept in sync with the map change log and door states
+// =============================================================================
+
+void navigation_init(Engine* engine) {
+    Navigation* nav = &engine->navigation;
+    memset(nav, 0, sizeof(Navigation));
+    
+    nav->walkable[0] = (uint8_t*)memory_alloc(NAV_CELLS, MEMORY_ZERO, MEMORY_TAG_NAVIGATION);
+    nav->walkable[1] = (uint8_t*)memory_alloc(NAV_CELLS, MEMORY_ZERO, MEMORY_TAG_NAVIGATION);
+    nav->paths = (NavPathEntry*)memory_alloc(NAV_MAX_CACHED_PATHS * sizeof(NavPathEntry), MEMORY_ZERO,
+                                             MEMORY_TAG_NAVIGATION);
+    
+    nav->cost = (uint32_t*)memory_alloc(NAV_CELLS * sizeof(uint32_t), 0, MEMORY_TAG_NAVIGATION);
+    nav->score = (uint32_t*)memory_alloc(NAV_CELLS * sizeof(uint32_t), 0, MEMORY_TAG_NAVIGATION);
+    nav->parent = (int*)memory_alloc(NAV_CELLS * sizeof(int), 0, MEMORY_TAG_NAVIGATION);
+    nav->closed = (uint8_t*)memory_alloc(NAV_CELLS, 0, MEMORY_TAG_NAVIGATION);
+    nav->heap = (int*)memory_alloc(NAV_CELLS * sizeof(int), 0, MEMORY_TAG_NAVIGATION);
+    nav->heap_index = (int*)memory_alloc(NAV_CELLS * sizeof(int), 0, MEMORY_TAG_NAVIGATION);
+    
+    for (int i = 0; i < NAV_MAX_FLOW_FIELDS; i++) {
+        NavFlowField* field = &nav->fields[i];
+        field->distance = (uint32_t*)memory_alloc(NAV_CELLS * sizeof(uint32_t), 0, MEMORY_TAG_NAVIGATION);
+        field->direction = (int8_t*)memory_alloc(NAV_CELLS, 0, MEMORY_TAG_NAVIGATION);
+        field->heap = (int*)memory_alloc(NAV_CELLS * sizeof(int), 0, MEMORY_TAG_NAVIGATION);
+        field->heap_index = (int*)memory_alloc(NAV_CELLS * sizeof(int), 0, MEMORY_TAG_NAVIGATION);
+    }
+    
+    // Forces a full rebuild on the first update
+    nav->map_revision = engine->world.revision - MAP_CHANGE_LOG_SIZE - 1;
+}
+
+void navigation_cleanup(Engine* engine) {
+    Navigation* nav = &engine->navigation;
+    
+    memory_free(nav->walkable[0]);
+    memory_free(nav->walkable[1]);
+    memory_free(nav->paths);
+    memory_free(nav->cost);
+    memory_free(nav->score);
+    memory_free(nav->parent);
+    memory_free(nav->closed);
+    memory_free(nav->heap);
+    memory_free(nav->heap_index);
+    
+    for (int i = 0; i < NAV_MAX_FLOW_FIELDS; i++) {
+        memory_free(nav->fields[i].distance);
+        memory_free(nav->fields[i].direction);
+        memory_free(nav->fields[i].heap);
+        memory_free(nav->fields[i].heap_index);
+    }
+    
+    memset(nav, 0, sizeof(Navigation));
+}
+
+static bool nav_door_closed_at(Navigation* nav, WorldMap* world, int x, int y) {
+    for (int i = 0; i < world->door_count; i++) {
+        if (world->doors[i].x == x && world->doors[i].y == y && !nav->door_open[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void nav_rebuild_grid(Navigation* nav, WorldMap* world) {
+    for (int y = 0; y < MAP_HEIGHT; y++) {
+        for (int x = 0; x < MAP_WIDTH; x++) {
+            uint8_t open = world->tiles[y][x] == 0;
+            nav->walkable[0][y * MAP_WIDTH + x] = open;
+            nav->walkable[1][y * MAP_WIDTH + x] = open;
+        }
+    }
+    
+    nav->door_count = world->door_count;
+    for (int i = 0; i < world->door_count; i++) {
+        Door* door = &world->doors[i];
+        nav->door_open[i] = door->open_amount >= NAV_DOOR_OPEN;
+        if (!nav->door_open[i]) {
+            nav->walkable[0][door->y * MAP_WIDTH + door->x] = 0;
+        }
+    }
+}
+
+// True if the straight or diagonal run between two path points enters cell
+static bool nav_segment_crosses(Vec2 from, Vec2 to, int cell) {
+    int x = (int)from.x;
+    int y = (int)from.y;
+    int tx = (int)to.x;
+    int ty = (int)to.y;
+    int dx = (tx > x) - (tx < x);
+    int dy = (ty > y) - (ty < y);
+    
+    for (;;) {
+        if (y * MAP_WIDTH + x == cell) return true;
+        if (x == tx && y == ty) return false;
+        x += dx;
+        y += dy;
+    }
+}
+
+static bool nav_path_crosses(const NavPath* path, int cell) {
+    if (path->count == 1) return nav_segment_crosses(path->points[0], path->points[0], cell);
+    
+    for (int i = 0; i + 1 < path->count; i++) {
+        if (nav_segment_crosses(path->points[i], path->points[i + 1], cell)) return true;
+    }
+    return false;
+}
+
+// A cell changed walkability for one door mode; drop only what it affects
+static void nav_invalidate_cell(Navigation* nav, int mode, int x, int y, bool now_walkable) {
+    int cell = y * MAP_WIDTH + x;
+    
+    for (int i = 0; i < NAV_MAX_FLOW_FIELDS; i++) {
+        NavFlowField* field = &nav->fields[i];
+        if (!field->in_use || field->dirty || nav_mode(field->flags) != mode) continue;
+        
+        if (!now_walkable) {
+            // Blocking a cell matters only if routes went through it
+            field->dirty = field->distance[cell] != NAV_UNREACHABLE;
+        } else {
+            // Opening a cell matters only if it touches the reachable region
+            for (int d = 0; d < 8 && !field->dirty; d++) {
+                int nx = x + nav_dx[d];
+                int ny = y + nav_dy[d];
+                if (nx < 0 || nx >= MAP_WIDTH || ny < 0 || ny >= MAP_HEIGHT) continue;
+                field->dirty = field->distance[ny * MAP_WIDTH + nx] != NAV_UNREACHABLE;
+            }
+        }
+    }
+    
+    for (int i = 0; i < NAV_MAX_CACHED_PATHS; i++) {
+        NavPathEntry* entry = &nav->paths[i];
+        if (!entry->valid || nav_mode(entry->flags) != mode) continue;
+        
+        // A new opening may create a shortcut for any path
+        if (now_walkable || nav_path_crosses(&entry->path, cell)) {
+            entry->valid = false;
+        }
+    }
+}
+
+static void nav_refresh_cell(Navigation* nav, WorldMap* world, int x, int y) {
+    if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) return;
+    
+    int cell = y * MAP_WIDTH + x;
+    uint8_t open = world->tiles[y][x] == 0;
+    uint8_t walk[2] = {
+        (uint8_t)(open && !nav_door_closed_at(nav, world, x, y)),
+        open
+    };
+    
+    for (int mode = 0; mode < 2; mode++) {
+        if (nav->walkable[mode][cell] != walk[mode]) {
+            nav->walkable[mode][cell] = walk[mode];
+            nav_invalidate_cell(nav, mode, x, y, walk[mode] != 0);
+        }
+    }
+}
+
+// =============================================================================
+// Flow fields
+// =============================================================================
+
+static void nav_build_field(Navigation* nav, NavFlowField* field) {
+    const uint8_t* grid = nav->walkable[nav_mode(field->flags)];
+    uint32_t* distance = field->distance;
+    
+    for (int i = 0; i < NAV_CELLS; i++) {
+        distance[i] = NAV_UNREACHABLE;
+        field->heap_index[i] = -1;
+    }
+    memset(field->direction, -1, NAV_CELLS);
+    field->dirty = false;
+    
+    if (!nav_walk(grid, field->goal_x, field->goal_y)) return;
+    
+    // Dijkstra outward from the goal
+    NavHeap heap = {field->heap, field->heap_index, 0, distance};
+    int goal = field->goal_y * MAP_WIDTH + field->goal_x;
+    distance[goal] = 0;
+    nav_heap_push(&heap, goal);
+    
+    while (heap.size > 0) {
+        int cell = nav_heap_pop(&heap);
+        int x = cell % MAP_WIDTH;
+        int y = cell / MAP_WIDTH;
+        
+        for (int d = 0; d < 8; d++) {
+            if (!nav_can_step(grid, x, y, nav_dx[d], nav_dy[d])) continue;
+            
+            int next = (y + nav_dy[d]) * MAP_WIDTH + (x + nav_dx[d]);
+            uint32_t cost = distance[cell] + (d < 4 ? NAV_COST_STRAIGHT : NAV_COST_DIAGONAL);
+            if (cost < distance[next]) {
+                distance[next] = cost;
+                nav_heap_push(&heap, next);
+            }
+        }
+    }
+    
+    // Each cell points at its cheapest neighbour
+    for (int cell = 0; cell < NAV_CELLS; cell++) {
+        if (distance[cell] == NAV_UNREACHABLE || cell == goal) continue;
+        
+        int x = cell % MAP_WIDTH;
+        int y = cell / MAP_WIDTH;
+        uint32_t best = distance[cell];
+        
+        for (int d = 0; d < 8; d++) {
+            if (!nav_can_step(grid, x, y, nav_dx[d], nav_dy[d])) continue;
+            
+            uint32_t next = distance[(y + nav_dy[d]) * MAP_WIDTH + (x + nav_dx[d])];
+            if (next < best) {
+                best = next;
+                field->direction[cell] = (int8_t)d;
+            }
+        }
+    }
+}
+
+typedef struct {
+    Navigation* nav;
+    NavFlowField* fields[NAV_MAX_FLOW_FIELDS];
+} NavBuildBatch;
+
+static void nav_build_task(void* context, int begin, int end) {
+    NavBuildBatch* batch = (NavBuildBatch*)context;
+    for (int i = begin; i < end; i++) {
+        nav_build_field(batch->nav, batch->fields[i]);
+    }
+}
+
+// Returns a handle for the field toward a goal cell, reusing a cached one
+int nav_flow_field(Engine* engine, int goal_x, int goal_y, uint32_t flags) {
+    Navigation* nav = &engine->navigation;
+    int slot = -1;
+    
+    for (int i = 0; i < NAV_MAX_FLOW_FIELDS; i++) {
+        NavFlowField* field = &nav->fields[i];
+        if (field->in_use && field->goal_x == goal_x && field->goal_y == goal_y &&
+            nav_mode(field->flags) == nav_mode(flags)) {
+            field->last_used_tick = engine->tick_count;
+            return i;
+        }
+        
+        // Prefer a free slot, otherwise evict the least recently used
+        if (slot < 0 || (!field->in_use && nav->fields[slot].in_use) ||
+            (field->in_use == nav->fields[slot].in_use &&
+             field->last_used_tick < nav->fields[slot].last_used_tick)) {
+            slot = i;
+        }
+    }
+    
+    NavFlowField* field = &nav->fields[slot];
+    field->in_use = true;
+    field->dirty = true;
+    field->goal_x = goal_x;
+    field->goal_y = goal_y;
+    field->flags = flags;
+    field->last_used_tick = engine->tick_count;
+    return slot;
+}
+
+static NavFlowField* nav_sample_field(Engine* engine, int handle) {
+    if (handle < 0 || handle >= NAV_MAX_FLOW_FIELDS) return NULL;
+    
+    NavFlowField* field = &engine->navigation.fields[handle];
+    if (!field->in_use) return NULL;
+    
+    // Fields requested this tick are built on first use
+    if (field->dirty) {
+        nav_build_field(&engine->navigation, field);
+        engine->navigation.field_builds++;
+    }
+    field->last_used_tick = engine->tick_count;
+    return field;
+}
+
+// Unit vector toward the next cell on the way to the field's goal
+Vec2 nav_flow_direction(Engine* engine, int handle, Vec2 position) {
+    NavFlowField* field = nav_sample_field(engine, handle);
+    Vec2 none = {0.0f, 0.0f};
+    if (!field) return none;
+    
+    int x = (int)position.x;
+    int y = (int)position.y;
+    if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) return none;
+    
+    int cell = y * MAP_WIDTH + x;
+    Vec2 target;
+    if (x == field->goal_x && y == field->goal_y) {
+        target = nav_cell_center(cell);
+    } else if (field->direction[cell] >= 0) {
+        int d = field->direction[cell];
+        target = nav_cell_center((y + nav_dy[d]) * MAP_WIDTH + (x + nav_dx[d]));
+    } else {
+        return none;
+    }
+    
+    Vec2 delta = vec2_sub(target, position);
+    if (vec2_length(delta) < 0.05f) return none;
+    return vec2_normalize(delta);
+}
+
+// Path length to the goal in cells, or -1 if unreachable
+float nav_flow_distance(Engine* engine, int handle, Vec2 position) {
+    NavFlowField* field = nav_sample_field(engine, handle);
+    if (!field) return -1.0f;
+    
+    int x = (int)position.x;
+    int y = (int)position.y;
+    if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) return -1.0f;
+    
+    uint32_t distance = field->distance[y * MAP_WIDTH + x];
+    return distance == NAV_UNREACHABLE ? -1.0f : distance / (float)NAV_COST_STRAIGHT;
+}
+
+// =============================================================================
+// Jump point search
+// =============================================================================
+
+// Walk from (x, y) in direction (dx, dy) until a jump point, the goal, or a
+// dead end (-1). Variant without corner cutting: diagonal runs stop as soon
+// as a straight run from the current cell finds a jump point.
+static int jps_jump(const uint8_t* grid, int x, int y, int dx, int dy, int goal) {
+    for (;;) {
+        if (!nav_walk(grid, x, y)) return -1;
+        
+        int cell = y * MAP_WIDTH + x;
+        if (cell == goal) return cell;
+        
+        if (dx != 0 && dy != 0) {
+            if (jps_jump(grid, x + dx, y, dx, 0, goal) >= 0 ||
+                jps_jump(grid, x, y + dy, 0, dy, goal) >= 0) {
+                return cell;
+            }
+            if (!nav_walk(grid, x + dx, y) || !nav_walk(grid, x, y + dy)) return -1;
+        } else if (dx != 0) {
+            if ((nav_walk(grid, x, y - 1) && !nav_walk(grid, x - dx, y - 1)) ||
+                (nav_walk(grid, x, y + 1) && !nav_walk(grid, x - dx, y + 1))) {
+                return cell;
+            }
+        } else {
+            if ((nav_walk(grid, x - 1, y) && !nav_walk(grid, x - 1, y - dy)) ||
+                (nav_walk(grid, x + 1, y) && !nav_walk(grid, x + 1, y - dy))) {
+                return cell;
+            }
+        }
+        
+        x += dx;
+        y += dy;
+    }
+}
+
+// Pruned successor directions of a node reached from its parent
+static int jps_directions(const uint8_t* grid, int x, int y, int parent, int* dirs_x, int* dirs_y) {
+    int count = 0;
+    
+    if (parent < 0) {
+        for (int d = 0; d < 8; d++) {
+            if (nav_can_step(grid, x, y, nav_dx[d], nav_dy[d])) {
+                dirs_x[count] = nav_dx[d];
+                dirs_y[count++] = nav_dy[d];
+            }
+        }
+        return count;
+    }
+    
+    int px = parent % MAP_WIDTH;
+    int py = parent / MAP_WIDTH;
+    int dx = (x > px) - (x < px);
+    int dy = (y > py) - (y < py);
+    
+    #define JPS_ADD(ax, ay) do { dirs_x[count] = (ax); dirs_y[count++] = (ay); } while (0)
+    if (dx != 0 && dy != 0) {
+        bool walk_y = nav_walk(grid, x, y + dy);
+        bool walk_x = nav_walk(grid, x + dx, y);
+        if (walk_y) JPS_ADD(0, dy);
+        if (walk_x) JPS_ADD(dx, 0);
+        if (walk_x && walk_y) JPS_ADD(dx, dy);
+    } else if (dx != 0) {
+        bool next = nav_walk(grid, x + dx, y);
+        bool up = nav_walk(grid, x, y + 1);
+        bool down = nav_walk(grid, x, y - 1);
+        if (next) {
+            JPS_ADD(dx, 0);
+            if (up) JPS_ADD(dx, 1);
+            if (down) JPS_ADD(dx, -1);
+        }
+        if (up) JPS_ADD(0, 1);
+        if (down) JPS_ADD(0, -1);
+    } else {
+        bool next = nav_walk(grid, x, y + dy);
+        bool right = nav_walk(grid, x + 1, y);
+        bool left = nav_walk(grid, x - 1, y);
+        if (next) {
+            JPS_ADD(0, dy);
+            if (right) JPS_ADD(1, dy);
+            if (left) JPS_ADD(-1, dy);
+        }
+        if (right) JPS_ADD(1, 0);
+        if (left) JPS_ADD(-1, 0);
+    }
+    #undef JPS_ADD
+    
+    return count;
+}
+
+static bool jps_search(Navigation* nav, const uint8_t* grid, int start, int goal, NavPath* path) {
+    int gx = goal % MAP_WIDTH;
+    int gy = goal / MAP_WIDTH;
+    
+    for (int i = 0; i < NAV_CELLS; i++) {
+        nav->cost[i] = NAV_UNREACHABLE;
+        nav->parent[i] = -1;
+        nav->heap_index[i] = -1;
+    }
+    memset(nav->closed, 0, NAV_CELLS);
+    
+    NavHeap open = {nav->heap, nav->heap_index, 0, nav->score};
+    nav->cost[start] = 0;
+    nav->score[start] = nav_octile(start % MAP_WIDTH, start / MAP_WIDTH, gx, gy);
+    nav_heap_push(&open, start);
+    
+    bool found = false;
+    while (open.size > 0) {
+        int cell = nav_heap_pop(&open);
+        if (cell == goal) {
+            found = true;
+            break;
+        }
+        nav->closed[cell] = 1;
+        
+        int x = cell % MAP_WIDTH;
+        int y = cell / MAP_WIDTH;
+        int dirs_x[8], dirs_y[8];
+        int dir_count = jps_directions(grid, x, y, nav->parent[cell], dirs_x, dirs_y);
+        
+        for (int d = 0; d < dir_count; d++) {
+            int jump = jps_jump(grid, x + dirs_x[d], y + dirs_y[d], dirs_x[d], dirs_y[d], goal);
+            if (jump < 0 || nav->closed[jump]) continue;
+            
+            int jx = jump % MAP_WIDTH;
+            int jy = jump / MAP_WIDTH;
+            uint32_t cost = nav->cost[cell] + nav_octile(x, y, jx, jy);
+            if (cost < nav->cost[jump]) {
+                nav->cost[jump] = cost;
+                nav->score[jump] = cost + nav_octile(jx, jy, gx, gy);
+                nav->parent[jump] = cell;
+                nav_heap_push(&open, jump);
+            }
+        }
+    }
+    
+    if (!found) return false;
+    
+    // Walk back from the goal, then reverse into start-to-goal order
+    int count = 0;
+    for (int cell = goal; cell >= 0; cell = nav->parent[cell]) {
+        if (count == NAV_MAX_PATH_POINTS) return false;
+        path->points[count++] = nav_cell_center(cell);
+    }
+    for (int i = 0; i < count / 2; i++) {
+        Vec2 tmp = path->points[i];
+        path->points[i] = path->points[count - 1 - i];
+        path->points[count - 1 - i] = tmp;
+    }
+    
+    path->count = count;
+    path->length = nav->cost[goal] / (float)NAV_COST_STRAIGHT;
+    return true;
+}
+
+bool nav_is_walkable(Engine* engine, int x, int y, uint32_t flags) {
+    return nav_walk(engine->navigation.walkable[nav_mode(flags)], x, y);
+}
+
+// Path between two positions as jump points; consecutive points are joined by
+// straight or 45-degree runs. Results are cached until the map invalidates them.
+bool nav_find_path(Engine* engine, Vec2 start, Vec2 goal, uint32_t flags, NavPath* path) {
+    Navigation* nav = &engine->navigation;
+    const uint8_t* grid = nav->walkable[nav_mode(flags)];
+    
+    int sx = (int)start.x, sy = (int)start.y;
+    int gx = (int)goal.x, gy = (int)goal.y;
+    if (!nav_walk(grid, sx, sy) || !nav_walk(grid, gx, gy)) return false;
+    
+    int start_cell = sy * MAP_WIDTH + sx;
+    int goal_cell = gy * MAP_WIDTH + gx;
+    nav->path_queries++;
+    
+    NavPathEntry* slot = &nav->paths[0];
+    for (int i = 0; i < NAV_MAX_CACHED_PATHS; i++) {
+        NavPathEntry* entry = &nav->paths[i];
+        if (entry->valid && entry->start == start_cell && entry->goal == goal_cell &&
+            nav_mode(entry->flags) == nav_mode(flags)) {
+            entry->last_used_tick = engine->tick_count;
+            *path = entry->path;
+            nav->path_cache_hits++;
+            return true;
+        }
+        
+        if ((!entry->valid && slot->valid) ||
+            (entry->valid == slot->valid && entry->last_used_tick < slot->last_used_tick)) {
+            slot = entry;
+        }
+    }
+    
+    if (!jps_search(nav, grid, start_cell, goal_cell, path)) return false;
+    
+    slot->valid = true;
+    slot->start = start_cell;
+    slot->goal = goal_cell;
+    slot->flags = flags;
+    slot->last_used_tick = engine->tick_count;
+    slot->path = *path;
+    return true;
+}
+
+// =============================================================================
+// Per-tick maintenance
+// =============================================================================
+
+// Consume map edits and door transitions since the last sync. Cheap when
+// nothing changed, so world queries call it before reading the grid.
+void navigation_sync(Engine* engine) {
+    Navigation* nav = &engine->navigation;
+    WorldMap* world = &engine->world;
+    
+    if (map_changes_overflowed(world, nav->map_revision) || nav->door_count != world->door_count) {
+        nav_rebuild_grid(nav, world);
+        for (int i = 0; i < NAV_MAX_FLOW_FIELDS; i++) {
+            nav->fields[i].dirty = true;
+        }
+        for (int i = 0; i < NAV_MAX_CACHED_PATHS; i++) {
+            nav->paths[i].valid = false;
+        }
+    } else {
+        for (uint32_t r = nav->map_revision; r != world->revision; r++) {
+            MapChange* change = &world->change_log[r % MAP_CHANGE_LOG_SIZE];
+            nav_refresh_cell(nav, world, change->x, change->y);
+        }
+        
+        for (int i = 0; i < world->door_count; i++) {
+            Door* door = &world->doors[i];
+            bool open = door->open_amount >= NAV_DOOR_OPEN;
+            if (open != nav->door_open[i]) {
+                nav->door_open[i] = open;
+                nav_refresh_cell(nav, world, door->x, door->y);
+            }
+        }
+    }
+    nav->map_revision = world->revision;
+}
+
+// Sync, then rebuild stale flow fields on the worker pool
+void navigation_update(Engine* engine) {
+    Navigation* nav = &engine->navigation;
+    navigation_sync(engine);
+    
+    NavBuildBatch batch;
+    batch.nav = nav;
+    int count = 0;
+    
+    for (int i = 0; i < NAV_MAX_FLOW_FIELDS; i++) {
+        NavFlowField* field = &nav->fields[i];
+        if (field->in_use && engine->tick_count - field->last_used_tick > NAV_FIELD_LIFETIME) {
+            field->in_use = false;
+        }
+        if (field->in_use && field->dirty) {
+            batch.fields[count++] = field;
+        }
+    }
+    
+    threading_parallel_for(&engine->thread_pool, count, 1, nav_build_task, &batch);
+    nav->field_builds += count;
+}
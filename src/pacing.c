@@ -0,0 +1,158 @@
+#include "../include/engine.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Frame pacing and input-to-photon latency. Frames start on a fixed grid of
+// deadlines rather than "frame time after the last one", so an oversleep is
+// not carried into the next frame. The pacer sleeps on the monotonic clock
+// until shortly before the deadline and spins the remainder; the spun tail
+// follows the wake-up lateness the OS has actually shown.
+#define PACER_SPIN_MIN_MS 0.05
+#define PACER_SPIN_MAX_MS 2.0
+
+void frame_pacer_init(FramePacer* pacer, double frames_per_second) {
+    memset(pacer, 0, sizeof(FramePacer));
+    pacer->period_ms = frames_per_second > 0.0 ? 1000.0 / frames_per_second : 0.0;
+    pacer->spin_ms = 0.5;
+    pacer->deadline_ms = sim_pipeline_now_ms() + pacer->period_ms;
+}
+
+static void frame_pacer_sleep_until(double wake_ms) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(wake_ms / 1000.0);
+    ts.tv_nsec = (long)((wake_ms - ts.tv_sec * 1000.0) * 1000000.0);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    
+#if defined(TIMER_ABSTIME)
+    // Only an interruption is retried; the absolute deadline stays the same.
+    // Other errors (a bad deadline) return and leave the rest to the spin.
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+#else
+    double remaining = wake_ms - sim_pipeline_now_ms();
+    if (remaining <= 0.0) return;
+    ts.tv_sec = (time_t)(remaining / 1000.0);
+    ts.tv_nsec = (long)((remaining - ts.tv_sec * 1000.0) * 1000000.0);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// Block until the current frame's deadline and advance to the next one
+void frame_pacer_wait(FramePacer* pacer) {
+    if (pacer->period_ms <= 0.0) return;
+    
+    double deadline = pacer->deadline_ms;
+    double now = sim_pipeline_now_ms();
+    pacer->frames++;
+    
+    if (now >= deadline) {
+        // Overran: start the next frame now rather than rushing to catch up
+        pacer->missed++;
+        pacer->deadline_ms = now - deadline > pacer->period_ms ? now + pacer->period_ms
+                                                                : deadline + pacer->period_ms;
+        return;
+    }
+    
+    double wake = deadline - pacer->spin_ms;
+    if (wake > now) {
+        frame_pacer_sleep_until(wake);
+        
+        // Track how late sleeps return, with headroom, as the spin tail
+        double late = sim_pipeline_now_ms() - wake;
+        double target = late * 1.5;
+        pacer->spin_ms += (target - pacer->spin_ms) * (target > pacer->spin_ms ? 0.5 : 0.05);
+        if (pacer->spin_ms < PACER_SPIN_MIN_MS) pacer->spin_ms = PACER_SPIN_MIN_MS;
+        if (pacer->spin_ms > PACER_SPIN_MAX_MS) pacer->spin_ms = PACER_SPIN_MAX_MS;
+    }
+    
+    while ((now = sim_pipeline_now_ms()) < deadline) {
+#ifdef __SSE2__
+        _mm_pause();
+#endif
+    }
+    
+    double error = now - deadline;
+    pacer->error_ms += error;
+    if (error > pacer->max_error_ms) pacer->max_error_ms = error;
+    pacer->deadline_ms = deadline + pacer->period_ms;
+}
+
+void frame_pacer_print_stats(const FramePacer* pacer) {
+    if (pacer->period_ms <= 0.0 || pacer->frames == 0) return;
+    
+    uint64_t paced = pacer->frames - pacer->missed;
+    printf("Pacing: %.2f ms frames, %llu paced, %llu over budget\n", pacer->period_ms,
+           (unsigned long long)paced, (unsigned long long)pacer->missed);
+    printf("  Deadline error: %.4f ms average, %.4f ms worst (spin tail %.3f ms)\n",
+           paced ? pacer->error_ms / paced : 0.0, pacer->max_error_ms, pacer->spin_ms);
+}
+
+// An input event arrived at `input_ms` (sim_pipeline_now_ms clock)
+void latency_input(LatencyTracker* tracker, double input_ms) {
+    if (tracker->pending_count == LATENCY_PENDING) {
+        tracker->dropped++;
+        return;
+    }
+    tracker->pending[tracker->pending_count++] = input_ms;
+}
+
+// A frame whose rendering began at `frame_begin_ms` reached the screen. It
+// shows every input that arrived before that; the oldest one sets the
+// frame's latency. Later input waits for a later frame.
+void latency_present(LatencyTracker* tracker, double frame_begin_ms, double present_ms) {
+    int shown = 0;
+    while (shown < tracker->pending_count && tracker->pending[shown] <= frame_begin_ms) {
+        shown++;
+    }
+    if (shown == 0) return;
+    
+    tracker->samples[tracker->next_sample] = (float)(present_ms - tracker->pending[0]);
+    tracker->next_sample = (tracker->next_sample + 1) % LATENCY_SAMPLES;
+    if (tracker->sample_count < LATENCY_SAMPLES) tracker->sample_count++;
+    tracker->frames++;
+    
+    tracker->pending_count -= shown;
+    memmove(tracker->pending, tracker->pending + shown, tracker->pending_count * sizeof(double));
+}
+
+static int latency_compare(const void* a, const void* b) {
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+// Latency below which `percentile` (0-100) of the recent frames fell
+float latency_percentile(const LatencyTracker* tracker, float percentile) {
+    if (tracker->sample_count == 0) return 0.0f;
+    
+    float sorted[LATENCY_SAMPLES];
+    memcpy(sorted, tracker->samples, tracker->sample_count * sizeof(float));
+    qsort(sorted, tracker->sample_count, sizeof(float), latency_compare);
+    
+    int index = (int)(percentile / 100.0f * (tracker->sample_count - 1) + 0.5f);
+    if (index < 0) index = 0;
+    if (index >= tracker->sample_count) index = tracker->sample_count - 1;
+    return sorted[index];
+}
+
+void latency_print_stats(const LatencyTracker* tracker) {
+    if (tracker->sample_count == 0) return;
+    
+    printf("Input latency (input to present, last %d frames with input):\n", tracker->sample_count);
+    printf("  p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           latency_percentile(tracker, 50.0f), latency_percentile(tracker, 95.0f),
+           latency_percentile(tracker, 99.0f), latency_percentile(tracker, 100.0f));
+    if (tracker->dropped > 0) {
+        printf("  %llu input stamps dropped\n", (unsigned long long)tracker->dropped);
+    }
+}
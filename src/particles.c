@@ -5,56 +5,66 @@
 
 // Particle system implementation
 void particle_emit(Engine* engine, Vec3 position, Vec3 velocity, ColorF color, float lifetime) {
-    if (engine->particle_count >= MAX_PARTICLES) return;
+    ParticleStore* particles = &engine->particles;
+    if (!particle_store_reserve(particles, particles->count + 1)) return;
     
-    Particle* p = &engine->particles[engine->particle_count++];
-    p->position = position;
-    p->velocity = velocity;
-    p->color = color;
-    p->lifetime = lifetime;
-    p->size = 0.1f;
-    p->gravity_scale = 1.0f;
-    p->texture_id = -1;
+    int i = particles->count++;
+    particles->position[i] = position;
+    particles->prev_position[i] = position;
+    particles->velocity[i] = velocity;
+    particles->color[i] = color;
+    particles->lifetime[i] = lifetime;
+    particles->size[i] = 0.1f;
+    particles->gravity_scale[i] = 1.0f;
+    particles->texture_id[i] = -1;
 }
 
 void particle_update(Engine* engine, float delta_time) {
-    for (int i = 0; i < engine->particle_count; i++) {
-        Particle* p = &engine->particles[i];
-        
+    ParticleStore* particles = &engine->particles;
+    
+    for (int i = 0; i < particles->count; i++) {
         // Update lifetime
-        p->lifetime -= delta_time;
+        particles->lifetime[i] -= delta_time;
         
-        if (p->lifetime <= 0.0f) {
+        if (particles->lifetime[i] <= 0.0f) {
             // Remove dead particle by swapping with last
-            engine->particles[i] = engine->particles[engine->particle_count - 1];
-            engine->particle_count--;
+            particle_store_remove(particles, i);
             i--;
             continue;
         }
         
         // Apply velocity
-        p->position = vec3_add(p->position, vec3_mul(p->velocity, delta_time));
+        Vec3* velocity = &particles->velocity[i];
+        particles->position[i] = vec3_add(particles->position[i], vec3_mul(*velocity, delta_time));
         
         // Apply gravity
-        p->velocity.z += -9.81f * p->gravity_scale * delta_time;
+        velocity->z += -9.81f * particles->gravity_scale[i] * delta_time;
         
         // Apply air resistance
-        p->velocity = vec3_mul(p->velocity, 0.98f);
+        *velocity = vec3_mul(*velocity, 0.98f);
         
         // Fade alpha based on lifetime
-        if (p->lifetime < 1.0f) {
-            p->color.a = p->lifetime;
+        if (particles->lifetime[i] < 1.0f) {
+            particles->color[i].a = particles->lifetime[i];
         }
     }
 }
 
 void particle_render(Engine* engine) {
-    for (int i = 0; i < engine->particle_count; i++) {
-        Particle* p = &engine->particles[i];
+    ParticleStore* particles = &engine->particles;
+    uint16_t* overdraw = debug_view_counts(engine, DEBUG_VIEW_OVERDRAW);
+    
+    for (int i = 0; i < particles->count; i++) {
+        // Interpolate between the last two ticks
+        Vec3 position = vec3_add(particles->prev_position[i], 
+                                 vec3_mul(vec3_sub(particles->position[i], 
+                                                   particles->prev_position[i]),
+                                          engine->interpolation_alpha));
+        ColorF color = particles->color[i];
         
         // Transform to camera space
-        Vec2 sprite_pos = {p->position.x - engine->camera.position.x,
-                          p->position.y - engine->camera.position.y};
+        Vec2 sprite_pos = {position.x - engine->camera.position.x,
+                          position.y - engine->camera.position.y};
         
         float inv_det = 1.0f / (engine->camera.plane.x * engine->camera.direction.y - 
                                 engine->camera.direction.x * engine->camera.plane.y);
@@ -69,12 +79,18 @@ void particle_render(Engine* engine) {
         
         int screen_x = (int)((SCREEN_WIDTH / 2) * (1 + transform.x / transform.y));
         int screen_y = (int)(SCREEN_HEIGHT / 2 - (SCREEN_HEIGHT / transform.y) * 
-                            (p->position.z - engine->camera.z_position));
+                            (position.z - engine->camera.z_position));
+        
+        int size = (int)(particles->size[i] * SCREEN_HEIGHT / transform.y);
         
-        int size = (int)(p->size * SCREEN_HEIGHT / transform.y);
+        // Only the part of the disc that is on screen
+        int dy_begin = -size > -screen_y ? -size : -screen_y;
+        int dy_end = size < SCREEN_HEIGHT - 1 - screen_y ? size : SCREEN_HEIGHT - 1 - screen_y;
+        int dx_begin = -size > -screen_x ? -size : -screen_x;
+        int dx_end = size < SCREEN_WIDTH - 1 - screen_x ? size : SCREEN_WIDTH - 1 - screen_x;
         
-        for (int dy = -size; dy <= size; dy++) {
-            for (int dx = -size; dx <= size; dx++) {
+        for (int dy = dy_begin; dy <= dy_end; dy++) {
+            for (int dx = dx_begin; dx <= dx_end; dx++) {
                 if (dx * dx + dy * dy > size * size) continue;
                 
                 int px = screen_x + dx;
@@ -87,11 +103,11 @@ void particle_render(Engine* engine) {
                 if (transform.y < engine->buffers.z_buffer[px]) {
                     Color existing = uint32_to_color(engine->buffers.color_buffer[idx]);
                     
-                    float alpha = p->color.a;
+                    float alpha = color.a;
                     Color particle_color = {
-                        (uint8_t)(p->color.r * 255),
-                        (uint8_t)(p->color.g * 255),
-                        (uint8_t)(p->color.b * 255),
+                        (uint8_t)(color.r * 255),
+                        (uint8_t)(color.g * 255),
+                        (uint8_t)(color.b * 255),
                         (uint8_t)(alpha * 255)
                     };
                     
@@ -101,6 +117,7 @@ void particle_render(Engine* engine) {
                     existing.b = (uint8_t)(existing.b * (1.0f - alpha) + particle_color.b * alpha);
                     
                     engine->buffers.color_buffer[idx] = color_to_uint32(existing);
+                    if (overdraw) overdraw[idx]++;
                 }
             }
         }
@@ -206,7 +223,8 @@ bool texture_load(Texture* texture, const char* filename) {
     texture->height = TEXTURE_SIZE;
     texture->has_alpha = false;
     
-    texture->pixels = (uint32_t*)malloc(texture->width * texture->height * sizeof(uint32_t));
+    texture->pixels = (uint32_t*)memory_alloc(texture->width * texture->height * sizeof(uint32_t), 0,
+                                                  MEMORY_TAG_TEXTURES);
     
     // Generate checkerboard pattern
     for (int y = 0; y < texture->height; y++) {
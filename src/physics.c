@@ -1,5 +1,6 @@
 #include "../include/engine.h"
 #include <math.h>
+#include <string.h>
 
 #define GRAVITY -9.81f
 #define TERMINAL_VELOCITY -20.0f
@@ -146,6 +147,242 @@ void physics_update(Engine* engine, PhysicsBody* body, float delta_time) {
     }
 }
 
+// =============================================================================
+// Physics world: sleeping bodies and simulation islands
+// =============================================================================
+
+void physics_world_init(PhysicsWorld* world) {
+    memset(world, 0, sizeof(PhysicsWorld));
+    world->sleep_velocity = PHYSICS_SLEEP_VELOCITY;
+    world->sleep_time = PHYSICS_SLEEP_TIME;
+}
+
+int physics_world_add_body(PhysicsWorld* world, PhysicsBody body) {
+    if (world->body_count >= MAX_PHYSICS_BODIES) return -1;
+    
+    int index = world->body_count++;
+    body.sleeping = false;
+    body.sleep_timer = 0.0f;
+    body.contact_count = 0;
+    body.island = index;
+    world->bodies[index] = body;
+    return index;
+}
+
+// Waking one body wakes its whole island, since the island only went to
+// sleep because every member was at rest
+void physics_wake_body(PhysicsWorld* world, int index) {
+    if (index < 0 || index >= world->body_count) return;
+    
+    PhysicsBody* body = &world->bodies[index];
+    if (!body->sleeping) {
+        body->sleep_timer = 0.0f;
+        return;
+    }
+    
+    int island = body->island;
+    for (int i = 0; i < world->body_count; i++) {
+        PhysicsBody* other = &world->bodies[i];
+        if (other->sleeping && other->island == island) {
+            other->sleeping = false;
+            other->sleep_timer = 0.0f;
+        }
+    }
+}
+
+void physics_wake_area(PhysicsWorld* world, Vec2 center, float radius) {
+    for (int i = 0; i < world->body_count; i++) {
+        PhysicsBody* body = &world->bodies[i];
+        if (!body->sleeping) continue;
+        
+        float reach = radius + body->radius;
+        float dx = body->position.x - center.x;
+        float dy = body->position.y - center.y;
+        if (dx * dx + dy * dy < reach * reach) {
+            physics_wake_body(world, i);
+        }
+    }
+}
+
+void physics_apply_impulse(PhysicsWorld* world, int index, Vec2 impulse) {
+    if (index < 0 || index >= world->body_count) return;
+    
+    physics_wake_body(world, index);
+    world->bodies[index].velocity.x += impulse.x;
+    world->bodies[index].velocity.y += impulse.y;
+}
+
+// Number of solid tiles and closed doors touching the body (with a small skin)
+static int physics_count_contacts(Engine* engine, PhysicsBody* body) {
+    const float SKIN = 0.01f;
+    float reach = body->radius + SKIN;
+    int contacts = 0;
+    
+    int min_x = (int)(body->position.x - reach);
+    int max_x = (int)(body->position.x + reach);
+    int min_y = (int)(body->position.y - reach);
+    int max_y = (int)(body->position.y + reach);
+    
+    for (int y = min_y; y <= max_y; y++) {
+        for (int x = min_x; x <= max_x; x++) {
+            if (map_get_tile(&engine->world, x, y) <= 0) continue;
+            
+            float closest_x = fmaxf((float)x, fminf(body->position.x, (float)(x + 1)));
+            float closest_y = fmaxf((float)y, fminf(body->position.y, (float)(y + 1)));
+            float dx = body->position.x - closest_x;
+            float dy = body->position.y - closest_y;
+            
+            if (dx * dx + dy * dy < reach * reach) contacts++;
+        }
+    }
+    
+    for (int i = 0; i < engine->world.door_count; i++) {
+        if (door_check_collision(&engine->world.doors[i], body->position)) contacts++;
+    }
+    
+    return contacts;
+}
+
+static int island_find(int* parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void island_union(int* parent, int a, int b) {
+    int root_a = island_find(parent, a);
+    int root_b = island_find(parent, b);
+    if (root_a != root_b) {
+        parent[root_a < root_b ? root_b : root_a] = root_a < root_b ? root_a : root_b;
+    }
+}
+
+// Wake bodies touched by map edits, moving doors or the player
+static void physics_world_wake_from_engine(Engine* engine) {
+    PhysicsWorld* world = &engine->physics_world;
+    WorldMap* map = &engine->world;
+    
+    if (map_changes_overflowed(map, world->map_revision)) {
+        for (int i = 0; i < world->body_count; i++) {
+            world->bodies[i].sleeping = false;
+            world->bodies[i].sleep_timer = 0.0f;
+        }
+    } else {
+        for (uint32_t r = world->map_revision; r != map->revision; r++) {
+            MapChange* change = &map->change_log[r % MAP_CHANGE_LOG_SIZE];
+            physics_wake_area(world, (Vec2){change->x + 0.5f, change->y + 0.5f}, 0.75f);
+        }
+    }
+    world->map_revision = map->revision;
+    
+    for (int i = 0; i < map->active_door_count; i++) {
+        Door* door = &map->doors[map->active_doors[i]];
+        physics_wake_area(world, (Vec2){door->x + 0.5f, door->y + 0.5f}, 0.75f);
+    }
+    
+    physics_wake_area(world, engine->camera.physics.position, engine->camera.physics.radius);
+}
+
+void physics_world_step(Engine* engine, float delta_time) {
+    PhysicsWorld* world = &engine->physics_world;
+    int parent[MAX_PHYSICS_BODIES];
+    
+    physics_world_wake_from_engine(engine);
+    
+    // Integrate awake bodies against the tile grid
+    for (int i = 0; i < world->body_count; i++) {
+        PhysicsBody* body = &world->bodies[i];
+        parent[i] = i;
+        if (body->sleeping) continue;
+        
+        physics_apply_gravity(body, delta_time);
+        physics_update(engine, body, delta_time);
+        
+        int contacts = physics_count_contacts(engine, body);
+        float speed = vec2_length(body->velocity);
+        
+        if (speed < world->sleep_velocity && contacts == body->contact_count) {
+            body->sleep_timer += delta_time;
+        } else {
+            body->sleep_timer = 0.0f;
+        }
+        body->contact_count = contacts;
+    }
+    
+    // Body-body contacts: resolve overlaps and build the contact graph
+    for (int i = 0; i < world->body_count; i++) {
+        PhysicsBody* a = &world->bodies[i];
+        
+        for (int j = i + 1; j < world->body_count; j++) {
+            PhysicsBody* b = &world->bodies[j];
+            if (a->sleeping && b->sleeping) continue;
+            
+            Vec2 delta = vec2_sub(b->position, a->position);
+            float reach = a->radius + b->radius;
+            float dist_sq = vec2_dot(delta, delta);
+            if (dist_sq >= reach * reach) continue;
+            
+            // An awake body pushing on a sleeping island wakes it up
+            if (a->sleeping) physics_wake_body(world, i);
+            if (b->sleeping) physics_wake_body(world, j);
+            
+            island_union(parent, i, j);
+            
+            float dist = sqrtf(dist_sq);
+            if (dist < 0.0001f) continue;
+            
+            Vec2 normal = vec2_mul(delta, 1.0f / dist);
+            float penetration = (reach - dist) * 0.5f;
+            physics_resolve_collision(a, vec2_mul(normal, -1.0f), penetration);
+            physics_resolve_collision(b, normal, penetration);
+        }
+    }
+    
+    // An island sleeps only when every member has been at rest long enough
+    float island_rest[MAX_PHYSICS_BODIES];
+    for (int i = 0; i < world->body_count; i++) {
+        island_rest[i] = world->sleep_time;
+    }
+    for (int i = 0; i < world->body_count; i++) {
+        PhysicsBody* body = &world->bodies[i];
+        if (body->sleeping) continue;
+        
+        int root = island_find(parent, i);
+        if (body->sleep_timer < island_rest[root]) {
+            island_rest[root] = body->sleep_timer;
+        }
+    }
+    
+    world->active_count = 0;
+    world->sleeping_count = 0;
+    world->island_count = 0;
+    
+    for (int i = 0; i < world->body_count; i++) {
+        PhysicsBody* body = &world->bodies[i];
+        
+        if (!body->sleeping) {
+            int root = island_find(parent, i);
+            body->island = root;
+            
+            if (island_rest[root] >= world->sleep_time) {
+                body->sleeping = true;
+                body->velocity = (Vec2){0.0f, 0.0f};
+            }
+        }
+        
+        if (body->sleeping) {
+            world->sleeping_count++;
+        } else {
+            world->active_count++;
+        }
+        
+        // Islands are labelled by their lowest body index
+        if (body->island == i) world->island_count++;
+    }
+}
+
 // Camera-specific movement functions
 void camera_move_forward(Camera* cam, float distance) {
     cam->physics.velocity.x += cam->direction.x * distance;
@@ -213,18 +450,28 @@ void camera_update_headbob(Camera* cam, float delta_time, bool moving) {
     }
 }
 
-// Door system implementation
-void door_open(Door* door) {
+// Door system implementation. A door is on the map's active list exactly
+// while it is opening or closing.
+static void door_set_motion(WorldMap* map, int index, bool opening) {
+    Door* door = &map->doors[index];
+    if (!door->is_opening && !door->is_closing) {
+        map->active_doors[map->active_door_count++] = index;
+    }
+    door->is_opening = opening;
+    door->is_closing = !opening;
+}
+
+void door_open(WorldMap* map, int index) {
+    Door* door = &map->doors[index];
     if (!door->is_opening && door->open_amount < 1.0f) {
-        door->is_opening = true;
-        door->is_closing = false;
+        door_set_motion(map, index, true);
     }
 }
 
-void door_close(Door* door) {
+void door_close(WorldMap* map, int index) {
+    Door* door = &map->doors[index];
     if (!door->is_closing && door->open_amount > 0.0f) {
-        door->is_closing = true;
-        door->is_opening = false;
+        door_set_motion(map, index, false);
     }
 }
 
@@ -248,6 +495,20 @@ void door_update(Door* door, float delta_time) {
     }
 }
 
+// Advance moving doors; settled doors leave the active list
+void door_update_active(WorldMap* map, float delta_time) {
+    for (int i = 0; i < map->active_door_count; ) {
+        Door* door = &map->doors[map->active_doors[i]];
+        door_update(door, delta_time);
+        
+        if (door->is_opening || door->is_closing) {
+            i++;
+        } else {
+            map->active_doors[i] = map->active_doors[--map->active_door_count];
+        }
+    }
+}
+
 bool door_check_collision(Door* door, Vec2 position) {
     if (door->open_amount >= 0.9f) return false;
     
@@ -276,41 +537,62 @@ static int sprite_compare(const void* a, const void* b) {
     return (dist_b > dist_a) - (dist_b < dist_a);
 }
 
-void sprite_sort_by_distance(Sprite* sprites, int count, Vec2 camera_pos) {
-    // Bubble sort for stability and simplicity
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            float dist_a = (sprites[j].position.x - camera_pos.x) * 
-                          (sprites[j].position.x - camera_pos.x) +
-                          (sprites[j].position.y - camera_pos.y) * 
-                          (sprites[j].position.y - camera_pos.y);
-            
-            float dist_b = (sprites[j + 1].position.x - camera_pos.x) * 
-                          (sprites[j + 1].position.x - camera_pos.x) +
-                          (sprites[j + 1].position.y - camera_pos.y) * 
-                          (sprites[j + 1].position.y - camera_pos.y);
-            
-            if (dist_a < dist_b) {
-                Sprite temp = sprites[j];
-                sprites[j] = sprites[j + 1];
-                sprites[j + 1] = temp;
-            }
+static inline float sprite_distance_sq(const Vec2* positions, int row, Vec2 camera_pos) {
+    float dx = positions[row].x - camera_pos.x;
+    float dy = positions[row].y - camera_pos.y;
+    return dx * dx + dy * dy;
+}
+
+// Orders rows back to front without moving sprite data. Insertion sort over
+// last frame's order, which is nearly sorted when the camera moves smoothly.
+void sprite_sort_by_distance(SpriteStore* sprites, Vec2 camera_pos) {
+    int* order = sprites->order;
+    
+    for (int i = 1; i < sprites->count; i++) {
+        int row = order[i];
+        float dist = sprite_distance_sq(sprites->position, row, camera_pos);
+        
+        int j = i - 1;
+        while (j >= 0 && sprite_distance_sq(sprites->position, order[j], camera_pos) < dist) {
+            order[j + 1] = order[j];
+            j--;
         }
+        order[j + 1] = row;
     }
 }
 
-void sprite_animate(Sprite* sprite, float delta_time) {
-    if (sprite->animation_speed > 0.0f) {
-        sprite->animation_frame += (int)(sprite->animation_speed * delta_time * 10.0f);
+// Walks the animated list only; handles of destroyed or stopped sprites are
+// dropped as they are found
+void sprite_animate(SpriteStore* sprites, float delta_time) {
+    for (int i = 0; i < sprites->animated_count; ) {
+        int row = sprite_row(sprites, sprites->animated[i]);
+        if (row < 0 || sprites->animation[row].speed <= 0.0f) {
+            sprites->animated[i] = sprites->animated[--sprites->animated_count];
+            continue;
+        }
+        
+        SpriteAnimation* animation = &sprites->animation[row];
+        animation->frame += (int)(animation->speed * delta_time * 10.0f);
+        i++;
     }
 }
 
 void render_sprites(Engine* engine) {
-    for (int i = 0; i < engine->sprite_count; i++) {
-        Sprite* sprite = &engine->sprites[i];
+    SpriteStore* sprites = &engine->sprites;
+    uint16_t* overdraw = debug_view_counts(engine, DEBUG_VIEW_OVERDRAW);
+    
+    for (int i = 0; i < sprites->count; i++) {
+        int row = sprites->order[i];
+        Vec2 current = sprites->position[row];
+        Vec2 previous = sprites->prev_position[row];
         
-        // Transform sprite position to camera space
-        Vec2 sprite_pos = vec2_sub(sprite->position, engine->camera.position);
+        // Interpolate between the last two ticks, then transform to camera space
+        float t = engine->interpolation_alpha;
+        Vec2 position = {
+            previous.x + (current.x - previous.x) * t,
+            previous.y + (current.y - previous.y) * t
+        };
+        Vec2 sprite_pos = vec2_sub(position, engine->camera.position);
         
         float inv_det = 1.0f / (engine->camera.plane.x * engine->camera.direction.y - 
                                 engine->camera.direction.x * engine->camera.plane.y);
@@ -324,6 +606,7 @@ void render_sprites(Engine* engine) {
         // Skip if behind camera
         if (transform.y <= 0.0f) continue;
         
+        SpriteVisual* sprite = &sprites->visual[row];
         int sprite_screen_x = (int)((SCREEN_WIDTH / 2) * (1 + transform.x / transform.y));
         
         int sprite_height = abs((int)(SCREEN_HEIGHT / transform.y)) * sprite->scale.y;
@@ -352,6 +635,7 @@ void render_sprites(Engine* engine) {
                     color.b = (uint8_t)(color.b * sprite->tint.b);
                     
                     engine->buffers.color_buffer[idx] = color_to_uint32(color);
+                    if (overdraw) overdraw[idx]++;
                 }
             }
         }
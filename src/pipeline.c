@@ -0,0 +1,239 @@
+#include "../include/engine.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Pipelined simulation. A simulation thread runs fixed ticks and, after each
+// update that advanced the simulation, copies the render-relevant state into
+// a free slot of a triple buffer and publishes it. The render thread draws
+// the latest published slot into a separate view engine, so tick N+1 is
+// simulated while tick N is drawn and neither side waits for the other.
+// Other threads that touch the simulation engine (input, quick save) take
+// the pipeline lock, which the simulation thread holds while it updates.
+#define RENDER_STATE_FRESH 0x4
+#define RENDER_STATE_INDEX 0x3
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+} SimThread;
+
+double sim_pipeline_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Called on the simulation thread after a tick
+void render_state_capture(RenderState* state, Engine* engine) {
+    bool first = state->tick == 0;
+    state->tick = engine->tick_count;
+    state->sim_accumulator = engine->sim_accumulator;
+    state->script_ms = engine->script_ms;
+    state->fixed_dt = engine->fixed_dt;
+    state->time_accumulator = engine->time_accumulator;
+    state->camera = engine->camera;
+    state->prev_camera = engine->prev_camera;
+    state->fog = engine->fog;
+    state->post_fx = engine->post_fx;
+    
+    // The map itself only changes with its revision; doors move every tick
+    WorldMap* world = &engine->world;
+    if (first || state->world.revision != world->revision) {
+        state->world = *world;
+    } else {
+        memcpy(state->world.doors, world->doors, world->door_count * sizeof(Door));
+        state->world.door_count = world->door_count;
+    }
+    
+    memcpy(state->textures, engine->textures, engine->texture_count * sizeof(Texture));
+    state->texture_count = engine->texture_count;
+    
+    if (entity_reserve((void**)&state->lights, &state->light_capacity,
+                       engine->light_count, sizeof(Light))) {
+        memcpy(state->lights, engine->lights, engine->light_count * sizeof(Light));
+        state->light_count = engine->light_count;
+    }
+    
+    sprite_store_copy_rows(&state->sprites, &engine->sprites);
+    particle_store_copy(&state->particles, &engine->particles);
+    
+    state->use_gi = engine->use_gi;
+    if (state->probe_count != engine->probe_count) {
+        memcpy(state->gi_probes, engine->gi_probes, sizeof(state->gi_probes));
+        state->probe_count = engine->probe_count;
+    }
+}
+
+// Load a published tick into the view engine the renderer draws. Texture
+// pixels are shared with the simulation engine and never freed by the view.
+void render_state_apply(Engine* view, const RenderState* state, double now_ms) {
+    if (view->tick_count == 0 || view->world.revision != state->world.revision) {
+        view->world = state->world;
+    } else {
+        memcpy(view->world.doors, state->world.doors, state->world.door_count * sizeof(Door));
+        view->world.door_count = state->world.door_count;
+    }
+    
+    view->tick_count = state->tick;
+    view->script_ms = state->script_ms;
+    view->fixed_dt = state->fixed_dt;
+    view->time_accumulator = state->time_accumulator;
+    view->camera = state->camera;
+    view->prev_camera = state->prev_camera;
+    view->fog = state->fog;
+    view->post_fx = state->post_fx;
+    
+    memcpy(view->textures, state->textures, state->texture_count * sizeof(Texture));
+    view->texture_count = state->texture_count;
+    
+    if (entity_reserve((void**)&view->lights, &view->light_capacity,
+                       state->light_count, sizeof(Light))) {
+        memcpy(view->lights, state->lights, state->light_count * sizeof(Light));
+        view->light_count = state->light_count;
+    }
+    
+    sprite_store_copy_rows(&view->sprites, &state->sprites);
+    particle_store_copy(&view->particles, &state->particles);
+    
+    // Probe irradiance is the view's own cache; only the layout is copied
+    view->use_gi = state->use_gi;
+    if (view->probe_count != state->probe_count) {
+        memcpy(view->gi_probes, state->gi_probes, sizeof(view->gi_probes));
+        view->probe_count = state->probe_count;
+    }
+    
+    // Interpolate by the time that has passed since the tick was published
+    float elapsed = (float)(now_ms - state->publish_ms) / 1000.0f;
+    float alpha = (state->sim_accumulator + elapsed) / state->fixed_dt;
+    view->interpolation_alpha = alpha < 1.0f ? alpha : 1.0f;
+}
+
+void render_state_free(RenderState* state) {
+    memory_free(state->lights);
+    sprite_store_free(&state->sprites);
+    particle_store_free(&state->particles);
+    memset(state, 0, sizeof(RenderState));
+}
+
+static void sim_pipeline_sleep(double ms) {
+    if (ms <= 0.0) return;
+    
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ms / 1000.0);
+    ts.tv_nsec = (long)((ms - ts.tv_sec * 1000.0) * 1000000.0);
+    nanosleep(&ts, NULL);
+}
+
+static void* sim_pipeline_main(void* arg) {
+    SimPipeline* pipeline = (SimPipeline*)arg;
+    SimThread* sim = (SimThread*)pipeline->thread;
+    Engine* engine = pipeline->engine;
+    double last = sim_pipeline_now_ms();
+    
+    while (__atomic_load_n(&pipeline->running, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&sim->lock);
+        
+        double start = sim_pipeline_now_ms();
+        float delta_time = (float)(start - last) / 1000.0f;
+        if (delta_time > 0.1f) delta_time = 0.1f;
+        last = start;
+        
+        uint64_t tick = engine->tick_count;
+        engine_update(engine, delta_time);
+        
+        if (engine->tick_count != tick) {
+            RenderState* state = &pipeline->slots[pipeline->write_slot];
+            render_state_capture(state, engine);
+            state->publish_ms = sim_pipeline_now_ms();
+            
+            int previous = __atomic_exchange_n(&pipeline->ready_slot,
+                                               pipeline->write_slot | RENDER_STATE_FRESH,
+                                               __ATOMIC_ACQ_REL);
+            pipeline->write_slot = previous & RENDER_STATE_INDEX;
+            pipeline->stats.published++;
+        }
+        
+        double remaining = (engine->fixed_dt - engine->sim_accumulator) * 1000.0;
+        pipeline->stats.update_ms += sim_pipeline_now_ms() - start;
+        pthread_mutex_unlock(&sim->lock);
+        
+        // Sleep until the next tick is due
+        sim_pipeline_sleep(remaining);
+    }
+    
+    return NULL;
+}
+
+// Starts simulating `engine` on its own thread. The caller renders a second,
+// initialised engine without textures of its own, fed by render_state_apply.
+bool sim_pipeline_start(SimPipeline* pipeline, Engine* engine) {
+    memset(pipeline, 0, sizeof(SimPipeline));
+    pipeline->engine = engine;
+    pipeline->write_slot = 0;
+    pipeline->ready_slot = 1;
+    pipeline->read_slot = 2;
+    
+    SimThread* sim = (SimThread*)memory_alloc(sizeof(SimThread), MEMORY_ZERO, MEMORY_TAG_THREADS);
+    if (!sim) return false;
+    pthread_mutex_init(&sim->lock, NULL);
+    
+    pipeline->thread = sim;
+    pipeline->running = true;
+    if (pthread_create(&sim->thread, NULL, sim_pipeline_main, pipeline) != 0) {
+        fprintf(stderr, "Cannot start simulation thread\n");
+        pthread_mutex_destroy(&sim->lock);
+        memory_free(sim);
+        pipeline->thread = NULL;
+        pipeline->running = false;
+        return false;
+    }
+    
+    return true;
+}
+
+// Joins the simulation thread. The view stops referring to shared textures,
+// so both engines can then be cleaned up normally.
+void sim_pipeline_stop(SimPipeline* pipeline, Engine* view) {
+    SimThread* sim = (SimThread*)pipeline->thread;
+    if (!sim) return;
+    
+    __atomic_store_n(&pipeline->running, false, __ATOMIC_RELEASE);
+    pthread_join(sim->thread, NULL);
+    pthread_mutex_destroy(&sim->lock);
+    memory_free(sim);
+    pipeline->thread = NULL;
+    
+    for (int i = 0; i < RENDER_STATE_SLOTS; i++) {
+        render_state_free(&pipeline->slots[i]);
+    }
+    view->texture_count = 0;
+}
+
+void sim_pipeline_lock(SimPipeline* pipeline) {
+    SimThread* sim = (SimThread*)pipeline->thread;
+    if (sim) pthread_mutex_lock(&sim->lock);
+}
+
+void sim_pipeline_unlock(SimPipeline* pipeline) {
+    SimThread* sim = (SimThread*)pipeline->thread;
+    if (sim) pthread_mutex_unlock(&sim->lock);
+}
+
+// Latest published tick, or NULL before the first one. The slot stays valid
+// until the next acquire.
+const RenderState* sim_pipeline_acquire(SimPipeline* pipeline) {
+    if (__atomic_load_n(&pipeline->ready_slot, __ATOMIC_ACQUIRE) & RENDER_STATE_FRESH) {
+        int ready = __atomic_exchange_n(&pipeline->ready_slot, pipeline->read_slot, __ATOMIC_ACQ_REL);
+        pipeline->read_slot = ready & RENDER_STATE_INDEX;
+        pipeline->stats.rendered++;
+    } else if (pipeline->stats.rendered > 0) {
+        pipeline->stats.repeated++;
+    } else {
+        return NULL;
+    }
+    
+    return &pipeline->slots[pipeline->read_slot];
+}
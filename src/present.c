@@ -0,0 +1,185 @@
+#include "../include/engine.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Pipelined presentation. A render thread draws frame N+1 into one colour
+// target while the presenting thread uploads and presents frame N from
+// another. Targets cycle through a free list and a ready list; with k frames
+// in flight the renderer runs at most k - 1 frames ahead of the screen,
+// trading latency for throughput.
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t frame_free;
+    pthread_cond_t frame_ready;
+} PresentThread;
+
+static void* present_queue_main(void* arg) {
+    PresentQueue* queue = (PresentQueue*)arg;
+    PresentThread* present = (PresentThread*)queue->thread;
+    uint64_t number = 0;
+    
+    for (;;) {
+        double wait_start = sim_pipeline_now_ms();
+        pthread_mutex_lock(&present->mutex);
+        while (queue->running && queue->free_count == 0) {
+            pthread_cond_wait(&present->frame_free, &present->mutex);
+        }
+        if (!queue->running) {
+            pthread_mutex_unlock(&present->mutex);
+            break;
+        }
+        PresentFrame* frame = &queue->frames[queue->free[--queue->free_count]];
+        pthread_mutex_unlock(&present->mutex);
+        
+        frame->number = ++number;
+        frame->begin_ms = sim_pipeline_now_ms();
+        queue->stats.wait_ms += frame->begin_ms - wait_start;
+        queue->render(queue->context, frame);
+        frame->ready_ms = sim_pipeline_now_ms();
+        
+        pthread_mutex_lock(&present->mutex);
+        queue->ready[queue->ready_count++] = frame->index;
+        pthread_cond_signal(&present->frame_ready);
+        pthread_mutex_unlock(&present->mutex);
+    }
+    
+    return NULL;
+}
+
+// Starts the render thread, which calls `render` for every frame. Frames
+// draw into `targets` (e.g. locked texture memory), or into targets the
+// queue allocates when it is NULL. 2 to PRESENT_MAX_FRAMES frames in flight.
+bool present_queue_start(PresentQueue* queue, int frames_in_flight, const RenderTarget* targets,
+                         PresentRenderFunction render, void* context) {
+    memset(queue, 0, sizeof(PresentQueue));
+    if (frames_in_flight < 2) frames_in_flight = 2;
+    if (frames_in_flight > PRESENT_MAX_FRAMES) frames_in_flight = PRESENT_MAX_FRAMES;
+    
+    for (int i = 0; i < frames_in_flight; i++) {
+        PresentFrame* frame = &queue->frames[i];
+        frame->index = i;
+        
+        if (targets) {
+            frame->target = targets[i];
+        } else {
+            queue->storage[i] = (uint32_t*)memory_alloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t),
+                                                        MEMORY_HUGE_PAGES, MEMORY_TAG_RENDER);
+            if (!queue->storage[i]) {
+                fprintf(stderr, "Cannot allocate colour target %d\n", i);
+                present_queue_stop(queue);
+                return false;
+            }
+            frame->target = (RenderTarget){queue->storage[i], SCREEN_WIDTH * sizeof(uint32_t)};
+        }
+        queue->free[queue->free_count++] = i;
+    }
+    
+    PresentThread* present = (PresentThread*)memory_alloc(sizeof(PresentThread), MEMORY_ZERO,
+                                                           MEMORY_TAG_THREADS);
+    if (!present) {
+        present_queue_stop(queue);
+        return false;
+    }
+    pthread_mutex_init(&present->mutex, NULL);
+    pthread_cond_init(&present->frame_free, NULL);
+    pthread_cond_init(&present->frame_ready, NULL);
+    
+    queue->frames_in_flight = frames_in_flight;
+    queue->render = render;
+    queue->context = context;
+    queue->thread = present;
+    queue->running = true;
+    
+    if (pthread_create(&present->thread, NULL, present_queue_main, queue) != 0) {
+        fprintf(stderr, "Cannot start render thread\n");
+        queue->running = false;
+        present_queue_stop(queue);
+        return false;
+    }
+    
+    return true;
+}
+
+void present_queue_stop(PresentQueue* queue) {
+    PresentThread* present = (PresentThread*)queue->thread;
+    
+    if (present) {
+        pthread_mutex_lock(&present->mutex);
+        bool started = queue->running;
+        queue->running = false;
+        pthread_cond_broadcast(&present->frame_free);
+        pthread_mutex_unlock(&present->mutex);
+        
+        if (started) pthread_join(present->thread, NULL);
+        pthread_mutex_destroy(&present->mutex);
+        pthread_cond_destroy(&present->frame_free);
+        pthread_cond_destroy(&present->frame_ready);
+        memory_free(present);
+        queue->thread = NULL;
+    }
+    
+    for (int i = 0; i < PRESENT_MAX_FRAMES; i++) {
+        memory_free(queue->storage[i]);
+        queue->storage[i] = NULL;
+    }
+}
+
+// Oldest rendered frame, waiting up to `timeout_ms` for one; NULL on timeout.
+// Hand it back with present_queue_release once it has been presented.
+PresentFrame* present_queue_acquire(PresentQueue* queue, double timeout_ms) {
+    PresentThread* present = (PresentThread*)queue->thread;
+    PresentFrame* frame = NULL;
+    
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    long nanoseconds = deadline.tv_nsec + (long)(timeout_ms * 1000000.0);
+    deadline.tv_sec += nanoseconds / 1000000000L;
+    deadline.tv_nsec = nanoseconds % 1000000000L;
+    
+    pthread_mutex_lock(&present->mutex);
+    while (queue->ready_count == 0) {
+        if (pthread_cond_timedwait(&present->frame_ready, &present->mutex, &deadline) != 0) break;
+    }
+    if (queue->ready_count > 0) {
+        frame = &queue->frames[queue->ready[0]];
+        queue->ready_count--;
+        memmove(queue->ready, queue->ready + 1, queue->ready_count * sizeof(int));
+    }
+    pthread_mutex_unlock(&present->mutex);
+    
+    return frame;
+}
+
+void present_queue_release(PresentQueue* queue, PresentFrame* frame) {
+    PresentThread* present = (PresentThread*)queue->thread;
+    double now = sim_pipeline_now_ms();
+    double latency = now - frame->begin_ms;
+    
+    PresentStats* stats = &queue->stats;
+    if (stats->frames == 0) stats->first_ms = now;
+    stats->last_ms = now;
+    stats->frames++;
+    stats->latency_ms += latency;
+    if (latency > stats->max_latency_ms) stats->max_latency_ms = latency;
+    
+    pthread_mutex_lock(&present->mutex);
+    queue->free[queue->free_count++] = frame->index;
+    pthread_cond_signal(&present->frame_free);
+    pthread_mutex_unlock(&present->mutex);
+}
+
+void present_queue_print_stats(const PresentQueue* queue) {
+    const PresentStats* stats = &queue->stats;
+    double seconds = (stats->last_ms - stats->first_ms) / 1000.0;
+    
+    printf("Presentation: %d frames in flight, %llu frames, %.1f fps\n",
+           queue->frames_in_flight, (unsigned long long)stats->frames,
+           seconds > 0.0 ? (stats->frames - 1) / seconds : 0.0);
+    printf("  Latency: %.3f ms average, %.3f ms worst (render start to present)\n",
+           stats->frames ? stats->latency_ms / stats->frames : 0.0, stats->max_latency_ms);
+    printf("  Render thread waited %.3f ms for a free target\n", stats->wait_ms);
+}
@@ -0,0 +1,476 @@
+#include "../include/engine.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PROFILER_PERF_EVENTS 1
+#endif
+
+// Scoped profiler. Each thread that opens a scope gets its own ring of
+// completed events, registered once on a lock-free list; recording a scope
+// is two clock reads and a store into that ring, with no locks or shared
+// counters. profiler_frame_end folds the events recorded since the last
+// frame into a per-scope rolling summary, and profiler_write_trace dumps
+// whatever the rings still hold as Chrome trace events (chrome://tracing,
+// Perfetto). Scope names must be string literals or otherwise outlive the
+// profiler.
+//
+// On Linux, profiler_enable_counters adds hardware counters: every thread
+// that records scopes opens one perf_event group (cycles, instructions,
+// last-level cache misses, branch misses; user space only) and reads it at
+// each scope boundary. A read is a system call, so counters cost about a
+// microsecond per scope; leave them off for timing runs. Where perf events
+// are unavailable (other systems, containers, perf_event_paranoid > 2) the
+// profiler says so once and keeps recording times.
+#define PROFILER_RING_SIZE 32768    // Events kept per thread; a power of two
+#define PROFILER_RING_GUARD 1024    // Oldest slots skipped when tracing running threads
+#define PROFILER_MAX_DEPTH 32
+#define PROFILER_AVERAGE_WEIGHT 0.05
+
+typedef struct {
+    const char* name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    int depth;
+    uint64_t counters[PROFILER_COUNTER_COUNT];  // Deltas over the scope
+} ProfilerEvent;
+
+typedef struct ProfilerThread {
+    struct ProfilerThread* next;
+    int id;
+    bool in_use;                // Cleared when the thread exits; the ring is then reused
+    uint64_t written;           // Events ever recorded; published with release
+    uint64_t summarized;        // Read position of profiler_frame_end
+    uint64_t first_traced;      // Events before this were cleared by a reset
+    int depth;
+    const char* open_names[PROFILER_MAX_DEPTH];
+    uint64_t open_ns[PROFILER_MAX_DEPTH];
+    uint64_t open_counters[PROFILER_MAX_DEPTH][PROFILER_COUNTER_COUNT];
+    int counter_fds[PROFILER_COUNTER_COUNT];    // [0] leads the group; -1 when closed
+    bool counters_tried;
+    ProfilerEvent events[PROFILER_RING_SIZE];
+} ProfilerThread;
+
+static ProfilerThread* profiler_threads = NULL;
+static int profiler_thread_count = 0;
+static __thread ProfilerThread* profiler_current = NULL;
+static pthread_key_t profiler_thread_key;
+static pthread_once_t profiler_thread_once = PTHREAD_ONCE_INIT;
+static uint64_t profiler_epoch_ns = 0;
+
+static ProfilerScopeStats profiler_scopes[PROFILER_MAX_SCOPES];
+static double profiler_frame_ms[PROFILER_MAX_SCOPES];
+static double profiler_frame_counters[PROFILER_MAX_SCOPES][PROFILER_COUNTER_COUNT];
+static int profiler_scope_count = 0;
+static uint64_t profiler_dropped = 0;
+
+static bool profiler_counters_wanted = false;
+static int profiler_counter_threads = 0;    // Threads with an open group
+static bool profiler_counters_failed = false;
+
+static const char* profiler_counter_names[PROFILER_COUNTER_COUNT] = {
+    "cycles", "instructions", "llc_misses", "branch_misses"
+};
+
+uint64_t profiler_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// --- Hardware counters ---
+
+#ifdef PROFILER_PERF_EVENTS
+static void profiler_close_counters(int* fds) {
+    bool was_open = fds[0] >= 0;
+    for (int i = PROFILER_COUNTER_COUNT - 1; i >= 0; i--) {
+        if (fds[i] >= 0) close(fds[i]);
+        fds[i] = -1;
+    }
+    if (was_open) __atomic_fetch_sub(&profiler_counter_threads, 1, __ATOMIC_RELAXED);
+}
+
+// Opens one group on the calling thread into `fds`, which must all be -1
+static bool profiler_open_counters(int* fds) {
+    static const uint64_t configs[PROFILER_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    
+    for (int i = 0; i < PROFILER_COUNTER_COUNT; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        
+        int leader = i == 0 ? -1 : fds[0];
+        fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fds[i] < 0) {
+            profiler_close_counters(fds);
+            return false;
+        }
+        if (i == 0) __atomic_fetch_add(&profiler_counter_threads, 1, __ATOMIC_RELAXED);
+    }
+    
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+static void profiler_read_counters(ProfilerThread* thread, uint64_t* values) {
+    uint64_t group[1 + PROFILER_COUNTER_COUNT];
+    if (read(thread->counter_fds[0], group, sizeof(group)) != (ssize_t)sizeof(group)) {
+        memset(values, 0, PROFILER_COUNTER_COUNT * sizeof(uint64_t));
+        return;
+    }
+    memcpy(values, group + 1, PROFILER_COUNTER_COUNT * sizeof(uint64_t));
+}
+#endif
+
+// Start counting on threads that record scopes from now on. Returns false,
+// and keeps timing only, if this thread cannot open the counters.
+bool profiler_enable_counters(void) {
+#ifdef PROFILER_PERF_EVENTS
+    profiler_counters_wanted = true;
+    ProfilerThread* thread = profiler_current;
+    if (thread && thread->counters_tried) return thread->counter_fds[0] >= 0;
+    
+    // Probe with a throwaway group so this thread can still register
+    int probe[PROFILER_COUNTER_COUNT];
+    memset(probe, -1, sizeof(probe));
+    if (profiler_open_counters(probe)) {
+        profiler_close_counters(probe);
+        return true;
+    }
+#endif
+    profiler_counters_wanted = false;
+    profiler_counters_failed = true;
+    fprintf(stderr, "Hardware counters unavailable (perf_event_open); profiling times only\n");
+    return false;
+}
+
+bool profiler_counters_active(void) {
+    return __atomic_load_n(&profiler_counter_threads, __ATOMIC_RELAXED) > 0;
+}
+
+// Worker threads come and go with the pool size; release their counter
+// group and hand the ring to the next thread that registers
+static void profiler_thread_exit(void* arg) {
+    ProfilerThread* thread = (ProfilerThread*)arg;
+#ifdef PROFILER_PERF_EVENTS
+    profiler_close_counters(thread->counter_fds);
+#endif
+    thread->counters_tried = false;
+    thread->depth = 0;
+    __atomic_store_n(&thread->in_use, false, __ATOMIC_RELEASE);
+}
+
+static void profiler_create_thread_key(void) {
+    pthread_key_create(&profiler_thread_key, profiler_thread_exit);
+}
+
+static ProfilerThread* profiler_register_thread(void) {
+    pthread_once(&profiler_thread_once, profiler_create_thread_key);
+    
+    // Take over the ring of a thread that has exited; its events stay in the
+    // trace until the new owner overwrites them
+    ProfilerThread* thread = __atomic_load_n(&profiler_threads, __ATOMIC_ACQUIRE);
+    for (; thread; thread = thread->next) {
+        bool expected = false;
+        if (__atomic_compare_exchange_n(&thread->in_use, &expected, true,
+                                        false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    
+    if (!thread) {
+        thread = (ProfilerThread*)memory_alloc(sizeof(ProfilerThread), MEMORY_ZERO,
+                                               MEMORY_TAG_DIAGNOSTICS);
+        if (!thread) return NULL;
+        memset(thread->counter_fds, -1, sizeof(thread->counter_fds));
+        thread->in_use = true;
+        
+        uint64_t expected = 0;
+        __atomic_compare_exchange_n(&profiler_epoch_ns, &expected, profiler_now_ns(),
+                                    false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        thread->id = __atomic_fetch_add(&profiler_thread_count, 1, __ATOMIC_RELAXED);
+        
+        thread->next = __atomic_load_n(&profiler_threads, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&profiler_threads, &thread->next, thread,
+                                            true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    
+    pthread_setspecific(profiler_thread_key, thread);
+    profiler_current = thread;
+    return thread;
+}
+
+void profiler_begin(const char* name) {
+    ProfilerThread* thread = profiler_current ? profiler_current : profiler_register_thread();
+    if (!thread) return;
+    
+#ifdef PROFILER_PERF_EVENTS
+    if (profiler_counters_wanted && !thread->counters_tried) {
+        thread->counters_tried = true;
+        profiler_open_counters(thread->counter_fds);
+    }
+#endif
+    
+    // Too deep: still counted so the matching end balances
+    if (thread->depth < PROFILER_MAX_DEPTH) {
+        thread->open_names[thread->depth] = name;
+#ifdef PROFILER_PERF_EVENTS
+        if (thread->counter_fds[0] >= 0) profiler_read_counters(thread, thread->open_counters[thread->depth]);
+#endif
+        thread->open_ns[thread->depth] = profiler_now_ns();
+    }
+    thread->depth++;
+}
+
+void profiler_end(void) {
+    ProfilerThread* thread = profiler_current;
+    if (!thread || thread->depth == 0) return;
+    
+    int depth = --thread->depth;
+    if (depth >= PROFILER_MAX_DEPTH) return;
+    
+    uint64_t end_ns = profiler_now_ns();
+    ProfilerEvent* event = &thread->events[thread->written & (PROFILER_RING_SIZE - 1)];
+    event->name = thread->open_names[depth];
+    event->begin_ns = thread->open_ns[depth];
+    event->end_ns = end_ns;
+    event->depth = depth;
+    memset(event->counters, 0, sizeof(event->counters));
+#ifdef PROFILER_PERF_EVENTS
+    if (thread->counter_fds[0] >= 0) {
+        uint64_t now[PROFILER_COUNTER_COUNT];
+        profiler_read_counters(thread, now);
+        for (int i = 0; i < PROFILER_COUNTER_COUNT; i++) {
+            event->counters[i] = now[i] - thread->open_counters[depth][i];
+        }
+    }
+#endif
+    __atomic_store_n(&thread->written, thread->written + 1, __ATOMIC_RELEASE);
+}
+
+static int profiler_find_scope(const char* name) {
+    for (int i = 0; i < profiler_scope_count; i++) {
+        if (profiler_scopes[i].name == name || strcmp(profiler_scopes[i].name, name) == 0) return i;
+    }
+    if (profiler_scope_count == PROFILER_MAX_SCOPES) return -1;
+    
+    ProfilerScopeStats* scope = &profiler_scopes[profiler_scope_count];
+    memset(scope, 0, sizeof(ProfilerScopeStats));
+    scope->name = name;
+    profiler_frame_ms[profiler_scope_count] = 0.0;
+    memset(profiler_frame_counters[profiler_scope_count], 0, sizeof(profiler_frame_counters[0]));
+    return profiler_scope_count++;
+}
+
+// Close a frame: fold every thread's new events into the summary. Call from
+// one thread, once per rendered frame. Scopes are summed per frame, so a
+// pass split over several workers reports its total CPU time.
+void profiler_frame_end(void) {
+    ProfilerThread* thread = __atomic_load_n(&profiler_threads, __ATOMIC_ACQUIRE);
+    
+    for (; thread; thread = thread->next) {
+        uint64_t written = __atomic_load_n(&thread->written, __ATOMIC_ACQUIRE);
+        uint64_t first = thread->summarized;
+        if (written - first > PROFILER_RING_SIZE) {
+            profiler_dropped += written - first - PROFILER_RING_SIZE;
+            first = written - PROFILER_RING_SIZE;
+        }
+        
+        for (uint64_t i = first; i < written; i++) {
+            const ProfilerEvent* event = &thread->events[i & (PROFILER_RING_SIZE - 1)];
+            int scope = profiler_find_scope(event->name);
+            if (scope < 0) continue;
+            
+            profiler_frame_ms[scope] += (event->end_ns - event->begin_ns) / 1000000.0;
+            for (int c = 0; c < PROFILER_COUNTER_COUNT; c++) {
+                profiler_frame_counters[scope][c] += (double)event->counters[c];
+            }
+            profiler_scopes[scope].calls++;
+        }
+        thread->summarized = written;
+    }
+    
+    for (int i = 0; i < profiler_scope_count; i++) {
+        ProfilerScopeStats* scope = &profiler_scopes[i];
+        double ms = profiler_frame_ms[i];
+        profiler_frame_ms[i] = 0.0;
+        
+        scope->last_ms = ms;
+        if (ms == 0.0) continue;
+        
+        for (int c = 0; c < PROFILER_COUNTER_COUNT; c++) {
+            double value = profiler_frame_counters[i][c];
+            profiler_frame_counters[i][c] = 0.0;
+            scope->counters[c] = scope->frames == 0 ? value : scope->counters[c] +
+                                 (value - scope->counters[c]) * PROFILER_AVERAGE_WEIGHT;
+        }
+        scope->average_ms = scope->frames == 0 ? ms : scope->average_ms +
+                            (ms - scope->average_ms) * PROFILER_AVERAGE_WEIGHT;
+        if (ms > scope->max_ms) scope->max_ms = ms;
+        scope->total_ms += ms;
+        scope->frames++;
+    }
+}
+
+// Copies the per-scope summary; returns the number of scopes
+int profiler_get_summary(ProfilerScopeStats* stats, int max_stats) {
+    int count = profiler_scope_count < max_stats ? profiler_scope_count : max_stats;
+    memcpy(stats, profiler_scopes, count * sizeof(ProfilerScopeStats));
+    return count;
+}
+
+void profiler_print_summary(void) {
+    if (profiler_scope_count == 0) {
+        printf("Profiler: no scopes recorded (build with ENGINE_PROFILER)\n");
+        return;
+    }
+    
+    // Counter columns are per frame averages; misses per thousand instructions
+    bool counters = profiler_counters_active();
+    printf("Profiler: %-22s %10s %10s %10s %10s", "scope", "last ms", "avg ms", "max ms", "calls/f");
+    if (counters) printf(" %9s %6s %10s %10s", "Mcycles", "IPC", "LLC/kinst", "brm/kinst");
+    printf("\n");
+    
+    for (int i = 0; i < profiler_scope_count; i++) {
+        const ProfilerScopeStats* scope = &profiler_scopes[i];
+        printf("          %-22s %10.3f %10.3f %10.3f %10.1f", scope->name, scope->last_ms,
+               scope->average_ms, scope->max_ms,
+               scope->frames ? (double)scope->calls / scope->frames : 0.0);
+        
+        double cycles = scope->counters[PROFILER_CYCLES];
+        double instructions = scope->counters[PROFILER_INSTRUCTIONS];
+        if (counters && instructions > 0.0) {
+            printf(" %9.2f %6.2f %10.3f %10.3f", cycles / 1.0e6, cycles > 0.0 ? instructions / cycles : 0.0,
+                   scope->counters[PROFILER_LLC_MISSES] * 1000.0 / instructions,
+                   scope->counters[PROFILER_BRANCH_MISSES] * 1000.0 / instructions);
+        }
+        printf("\n");
+    }
+    if (profiler_counters_failed) printf("          (hardware counters unavailable)\n");
+    if (profiler_dropped > 0) {
+        printf("          %llu events overwritten before they were summarised\n",
+               (unsigned long long)profiler_dropped);
+    }
+}
+
+static void profiler_write_name(FILE* file, const char* name) {
+    fputc('"', file);
+    for (const char* c = name; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static int profiler_write_events(FILE* file, uint64_t since_ns, uint64_t base_ns, uint64_t guard) {
+    int count = 0;
+    ProfilerThread* thread = __atomic_load_n(&profiler_threads, __ATOMIC_ACQUIRE);
+    
+    for (; thread; thread = thread->next) {
+        uint64_t written = __atomic_load_n(&thread->written, __ATOMIC_ACQUIRE);
+        uint64_t kept = thread == profiler_current ? PROFILER_RING_SIZE : PROFILER_RING_SIZE - guard;
+        uint64_t begin = written > kept ? written - kept : 0;
+        if (begin < thread->first_traced) begin = thread->first_traced;
+        
+        fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                      "\"args\": {\"name\": \"thread %d\"}}", thread->id, thread->id);
+        
+        for (uint64_t i = begin; i < written; i++) {
+            const ProfilerEvent* event = &thread->events[i & (PROFILER_RING_SIZE - 1)];
+            if (event->end_ns < since_ns) continue;
+            
+            fprintf(file, ",\n{\"name\": ");
+            profiler_write_name(file, event->name);
+            fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                    thread->id, (int64_t)(event->begin_ns - base_ns) / 1000.0,
+                    (event->end_ns - event->begin_ns) / 1000.0);
+            if (event->counters[PROFILER_CYCLES] > 0) {
+                fprintf(file, ", \"args\": {");
+                for (int c = 0; c < PROFILER_COUNTER_COUNT; c++) {
+                    fprintf(file, "%s\"%s\": %llu", c ? ", " : "", profiler_counter_names[c],
+                            (unsigned long long)event->counters[c]);
+                }
+                fprintf(file, "}");
+            }
+            fprintf(file, "}");
+            count++;
+        }
+    }
+    return count;
+}
+
+// Appends the events that ended at or after `since_ns` as trace events,
+// each preceded by a comma, with timestamps in microseconds from `base_ns`.
+// Other threads may keep recording meanwhile; the ring slots they reuse
+// next are skipped rather than read half-written. Returns the events written.
+int profiler_append_trace_events(void* file, uint64_t since_ns, uint64_t base_ns) {
+    return profiler_write_events((FILE*)file, since_ns, base_ns, PROFILER_RING_GUARD);
+}
+
+// Chrome trace-event JSON of the events still held by the thread rings.
+// Call while no scopes are being recorded, e.g. after the last frame.
+bool profiler_write_trace(const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write trace %s\n", filename);
+        return false;
+    }
+    
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+                  "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"engine\"}}");
+    profiler_write_events(file, 0, profiler_epoch_ns, 0);
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
+
+// Clears the summary and the recorded events. Thread rings stay registered.
+void profiler_reset(void) {
+    ProfilerThread* thread = __atomic_load_n(&profiler_threads, __ATOMIC_ACQUIRE);
+    for (; thread; thread = thread->next) {
+        thread->summarized = __atomic_load_n(&thread->written, __ATOMIC_ACQUIRE);
+        thread->first_traced = thread->summarized;
+    }
+    profiler_scope_count = 0;
+    profiler_dropped = 0;
+}
+
+// Manual sections, timed in microseconds
+void profile_begin(ProfileSection* section) {
+    section->start_time = profiler_now_ns();
+    section->call_count++;
+}
+
+void profile_end(ProfileSection* section) {
+    section->total_time += (profiler_now_ns() - section->start_time) / 1000;
+}
+
+void profile_reset(ProfileSection* section) {
+    section->total_time = 0;
+    section->call_count = 0;
+}
+
+float profile_get_ms(ProfileSection* section) {
+    if (section->call_count == 0) return 0.0f;
+    return (float)section->total_time / section->call_count / 1000.0f;
+}
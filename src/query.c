@@ -0,0 +1,247 @@
+#include "../include/engine.h"
+#include <math.h>
+
+// Line-of-sight and hitscan queries against the occupancy grid kept by
+// navigation.c. Segments are traversed cell by cell (Amanatides-Woo) in
+// parametric form, t in [0, 1] from origin to target, so no normalisation
+// is needed. With SSE2 four segments advance together as one packet;
+// otherwise segments are walked one at a time.
+#define QUERY_FAR 1e30f
+#define QUERY_PARALLEL_MIN 512
+#define QUERY_GRAIN 128
+
+static inline bool query_solid(const uint8_t* grid, int x, int y) {
+    if (x < 0 || x >= MAP_WIDTH || y < 0 || y >= MAP_HEIGHT) return true;
+    return grid[y * MAP_WIDTH + x] == 0;
+}
+
+static inline void query_set_hit(QueryHit* out, int x, int y, float distance) {
+    out->hit = true;
+    out->cell_x = x;
+    out->cell_y = y;
+    out->distance = distance;
+}
+
+static inline void query_set_clear(QueryHit* out, float length) {
+    out->hit = false;
+    out->cell_x = -1;
+    out->cell_y = -1;
+    out->distance = length;
+}
+
+#ifndef __SSE2__
+static void query_segment_scalar(const uint8_t* grid, const QuerySegment* segment, QueryHit* out) {
+    float ox = segment->origin.x;
+    float oy = segment->origin.y;
+    float dx = segment->target.x - ox;
+    float dy = segment->target.y - oy;
+    float length = sqrtf(dx * dx + dy * dy);
+    
+    int mx = (int)floorf(ox);
+    int my = (int)floorf(oy);
+    if (query_solid(grid, mx, my)) {
+        query_set_hit(out, mx, my, 0.0f);
+        return;
+    }
+    
+    int step_x = dx < 0.0f ? -1 : 1;
+    int step_y = dy < 0.0f ? -1 : 1;
+    float delta_x = dx != 0.0f ? 1.0f / fabsf(dx) : QUERY_FAR;
+    float delta_y = dy != 0.0f ? 1.0f / fabsf(dy) : QUERY_FAR;
+    float side_x = (dx < 0.0f ? ox - mx : mx + 1.0f - ox) * delta_x;
+    float side_y = (dy < 0.0f ? oy - my : my + 1.0f - oy) * delta_y;
+    
+    for (;;) {
+        float t;
+        if (side_x < side_y) {
+            t = side_x;
+            side_x += delta_x;
+            mx += step_x;
+        } else {
+            t = side_y;
+            side_y += delta_y;
+            my += step_y;
+        }
+        
+        if (t > 1.0f) {
+            query_set_clear(out, length);
+            return;
+        }
+        if (query_solid(grid, mx, my)) {
+            query_set_hit(out, mx, my, t * length);
+            return;
+        }
+    }
+}
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+// Four segments at once. Lanes that finish early keep stepping harmlessly
+// until the whole packet is done; the grid lookup is a scalar gather.
+static void query_packet_sse2(const uint8_t* grid, const QuerySegment* segments,
+                              QueryHit* results, int lanes) {
+    float ox_s[4], oy_s[4], tx_s[4], ty_s[4];
+    for (int i = 0; i < 4; i++) {
+        const QuerySegment* segment = &segments[i < lanes ? i : 0];
+        ox_s[i] = segment->origin.x;
+        oy_s[i] = segment->origin.y;
+        tx_s[i] = segment->target.x;
+        ty_s[i] = segment->target.y;
+    }
+    
+    __m128 ox = _mm_loadu_ps(ox_s);
+    __m128 oy = _mm_loadu_ps(oy_s);
+    __m128 dx = _mm_sub_ps(_mm_loadu_ps(tx_s), ox);
+    __m128 dy = _mm_sub_ps(_mm_loadu_ps(ty_s), oy);
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 far = _mm_set1_ps(QUERY_FAR);
+    __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+    
+    // floor() via truncation, corrected for negative values
+    __m128i mx = _mm_cvttps_epi32(ox);
+    __m128i my = _mm_cvttps_epi32(oy);
+    mx = _mm_add_epi32(mx, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(mx), ox)));
+    my = _mm_add_epi32(my, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(my), oy)));
+    __m128 mxf = _mm_cvtepi32_ps(mx);
+    __m128 myf = _mm_cvtepi32_ps(my);
+    
+    __m128 neg_x = _mm_cmplt_ps(dx, zero);
+    __m128 neg_y = _mm_cmplt_ps(dy, zero);
+    __m128i one_i = _mm_set1_epi32(1);
+    __m128i step_x = _mm_or_si128(_mm_castps_si128(neg_x), _mm_andnot_si128(_mm_castps_si128(neg_x), one_i));
+    __m128i step_y = _mm_or_si128(_mm_castps_si128(neg_y), _mm_andnot_si128(_mm_castps_si128(neg_y), one_i));
+    
+    __m128 abs_dx = _mm_and_ps(dx, abs_mask);
+    __m128 abs_dy = _mm_and_ps(dy, abs_mask);
+    __m128 moving_x = _mm_cmpneq_ps(abs_dx, zero);
+    __m128 moving_y = _mm_cmpneq_ps(abs_dy, zero);
+    __m128 delta_x = _mm_or_ps(_mm_and_ps(moving_x, _mm_div_ps(one, abs_dx)), _mm_andnot_ps(moving_x, far));
+    __m128 delta_y = _mm_or_ps(_mm_and_ps(moving_y, _mm_div_ps(one, abs_dy)), _mm_andnot_ps(moving_y, far));
+    
+    __m128 frac_x = _mm_or_ps(_mm_and_ps(neg_x, _mm_sub_ps(ox, mxf)),
+                              _mm_andnot_ps(neg_x, _mm_sub_ps(_mm_add_ps(mxf, one), ox)));
+    __m128 frac_y = _mm_or_ps(_mm_and_ps(neg_y, _mm_sub_ps(oy, myf)),
+                              _mm_andnot_ps(neg_y, _mm_sub_ps(_mm_add_ps(myf, one), oy)));
+    __m128 side_x = _mm_mul_ps(frac_x, delta_x);
+    __m128 side_y = _mm_mul_ps(frac_y, delta_y);
+    
+    int32_t cell_x[4], cell_y[4];
+    float t_s[4], length_s[4];
+    _mm_storeu_si128((__m128i*)cell_x, mx);
+    _mm_storeu_si128((__m128i*)cell_y, my);
+    _mm_storeu_ps(length_s, length);
+    
+    int active = 0;
+    for (int i = 0; i < lanes; i++) {
+        if (query_solid(grid, cell_x[i], cell_y[i])) {
+            query_set_hit(&results[i], cell_x[i], cell_y[i], 0.0f);
+        } else {
+            active |= 1 << i;
+        }
+    }
+    
+    while (active) {
+        __m128 take_x = _mm_cmplt_ps(side_x, side_y);
+        __m128i take_x_i = _mm_castps_si128(take_x);
+        __m128 t = _mm_min_ps(side_x, side_y);
+        
+        side_x = _mm_add_ps(side_x, _mm_and_ps(take_x, delta_x));
+        side_y = _mm_add_ps(side_y, _mm_andnot_ps(take_x, delta_y));
+        mx = _mm_add_epi32(mx, _mm_and_si128(take_x_i, step_x));
+        my = _mm_add_epi32(my, _mm_andnot_si128(take_x_i, step_y));
+        
+        int past_end = _mm_movemask_ps(_mm_cmpgt_ps(t, one)) & active;
+        for (int i = 0; i < 4; i++) {
+            if (past_end & (1 << i)) query_set_clear(&results[i], length_s[i]);
+        }
+        active &= ~past_end;
+        if (!active) break;
+        
+        _mm_storeu_si128((__m128i*)cell_x, mx);
+        _mm_storeu_si128((__m128i*)cell_y, my);
+        _mm_storeu_ps(t_s, t);
+        
+        for (int i = 0; i < 4; i++) {
+            if ((active & (1 << i)) && query_solid(grid, cell_x[i], cell_y[i])) {
+                query_set_hit(&results[i], cell_x[i], cell_y[i], t_s[i] * length_s[i]);
+                active &= ~(1 << i);
+            }
+        }
+    }
+}
+#endif
+
+// Single segments take the same path as batches so results always agree,
+// including segments that end exactly on a cell boundary
+static void query_segment(const uint8_t* grid, const QuerySegment* segment, QueryHit* out) {
+#ifdef __SSE2__
+    query_packet_sse2(grid, segment, out, 1);
+#else
+    query_segment_scalar(grid, segment, out);
+#endif
+}
+
+typedef struct {
+    const uint8_t* grid;
+    const QuerySegment* segments;
+    QueryHit* results;
+} QueryBatch;
+
+static void query_batch_task(void* context, int begin, int end) {
+    QueryBatch* batch = (QueryBatch*)context;
+    
+#ifdef __SSE2__
+    for (int i = begin; i < end; i += 4) {
+        int lanes = end - i < 4 ? end - i : 4;
+        query_packet_sse2(batch->grid, &batch->segments[i], &batch->results[i], lanes);
+    }
+#else
+    for (int i = begin; i < end; i++) {
+        query_segment_scalar(batch->grid, &batch->segments[i], &batch->results[i]);
+    }
+#endif
+}
+
+// Test every segment against the tile grid (and closed doors with
+// QUERY_DOORS). Large batches are split across the worker pool. Call from
+// the simulation thread; the grid is synced with pending map edits first.
+void world_query_segments(Engine* engine, const QuerySegment* segments, QueryHit* results,
+                          int count, uint32_t flags) {
+    if (count <= 0) return;
+    
+    navigation_sync(engine);
+    
+    QueryBatch batch;
+    batch.grid = engine->navigation.walkable[(flags & QUERY_DOORS) ? 0 : 1];
+    batch.segments = segments;
+    batch.results = results;
+    
+    if (count >= QUERY_PARALLEL_MIN) {
+        threading_parallel_for(&engine->thread_pool, count, QUERY_GRAIN, query_batch_task, &batch);
+    } else {
+        query_batch_task(&batch, 0, count);
+    }
+}
+
+bool world_query_line_of_sight(Engine* engine, Vec2 from, Vec2 to, uint32_t flags) {
+    navigation_sync(engine);
+    
+    QuerySegment segment = {from, to};
+    QueryHit hit;
+    query_segment(engine->navigation.walkable[(flags & QUERY_DOORS) ? 0 : 1], &segment, &hit);
+    return !hit.hit;
+}
+
+bool world_query_hitscan(Engine* engine, Vec2 origin, Vec2 direction, float range,
+                         uint32_t flags, QueryHit* hit) {
+    navigation_sync(engine);
+    
+    QuerySegment segment = {origin, vec2_add(origin, vec2_mul(vec2_normalize(direction), range))};
+    query_segment(engine->navigation.walkable[(flags & QUERY_DOORS) ? 0 : 1], &segment, hit);
+    return hit->hit;
+}
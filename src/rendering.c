@@ -7,6 +7,8 @@
 static const float GAUSSIAN_KERNEL[5] = {0.227027f, 0.1945946f, 0.1216216f, 0.054054f, 0.016216f};
 
 void apply_lighting(Engine* engine) {
+    uint16_t* cost = debug_view_counts(engine, DEBUG_VIEW_LIGHT_COST);
+    uint64_t lit_pixels = 0;
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
         for (int x = 0; x < SCREEN_WIDTH; x++) {
             int idx = y * SCREEN_WIDTH + x;
@@ -17,6 +19,8 @@ void apply_lighting(Engine* engine) {
             // Calculate world position for this pixel
             float depth = engine->buffers.z_buffer[x % SCREEN_WIDTH];
             if (depth >= MAX_RENDER_DISTANCE) continue;
+            lit_pixels++;
+            if (cost) cost[idx] += engine->light_count;
             
             // Apply each point light
             for (int i = 0; i < engine->light_count; i++) {
@@ -50,9 +54,11 @@ void apply_lighting(Engine* engine) {
             engine->buffers.color_buffer[idx] = color_to_uint32(pixel);
         }
     }
+    telemetry_add(TELEMETRY_LIGHTS_EVALUATED, lit_pixels * engine->light_count);
 }
 
 void apply_shadows(Engine* engine) {
+    uint16_t* cost = debug_view_counts(engine, DEBUG_VIEW_LIGHT_COST);
     for (int i = 0; i < engine->light_count; i++) {
         if (!engine->lights[i].cast_shadows) continue;
         
@@ -88,8 +94,10 @@ void apply_shadows(Engine* engine) {
                 bool in_shadow = false;
                 float march_step = 0.1f;
                 Vec2 march_pos = world_pos;
+                int march_steps = 0;
                 
                 for (float d = march_step; d < light_dist; d += march_step) {
+                    march_steps++;
                     march_pos.x = world_pos.x + to_light.x * d;
                     march_pos.y = world_pos.y + to_light.y * d;
                     
@@ -104,6 +112,8 @@ void apply_shadows(Engine* engine) {
                     }
                 }
                 
+                if (cost) cost[idx] += march_steps;
+                
                 if (in_shadow) {
                     Color pixel = uint32_to_color(engine->buffers.color_buffer[idx]);
                     pixel.r = (uint8_t)(pixel.r * 0.3f);
@@ -144,6 +154,12 @@ void apply_fog(Engine* engine) {
 }
 
 void post_process_bloom(Engine* engine) {
+    uint32_t* bright = (uint32_t*)frame_arena_alloc(&engine->frame_arena, 
+                                                    SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    uint32_t* temp = (uint32_t*)frame_arena_alloc(&engine->frame_arena, 
+                                                  SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    if (!bright || !temp) return;
+    
     // Extract bright pixels
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
         for (int x = 0; x < SCREEN_WIDTH; x++) {
@@ -153,16 +169,14 @@ void post_process_bloom(Engine* engine) {
             float brightness = (pixel.r + pixel.g + pixel.b) / (3.0f * 255.0f);
             
             if (brightness > engine->post_fx.bloom_threshold) {
-                engine->buffers.post_process_buffer[idx] = engine->buffers.color_buffer[idx];
+                bright[idx] = engine->buffers.color_buffer[idx];
             } else {
-                engine->buffers.post_process_buffer[idx] = 0;
+                bright[idx] = 0;
             }
         }
     }
     
     // Horizontal blur
-    uint32_t* temp = (uint32_t*)malloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
-    
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
         for (int x = 0; x < SCREEN_WIDTH; x++) {
             ColorF sum = {0, 0, 0, 0};
@@ -171,7 +185,7 @@ void post_process_bloom(Engine* engine) {
                 int sx = x + i;
                 if (sx < 0 || sx >= SCREEN_WIDTH) continue;
                 
-                Color c = uint32_to_color(engine->buffers.post_process_buffer[y * SCREEN_WIDTH + sx]);
+                Color c = uint32_to_color(bright[y * SCREEN_WIDTH + sx]);
                 float weight = GAUSSIAN_KERNEL[abs(i)];
                 
                 sum.r += c.r * weight;
@@ -216,17 +230,18 @@ void post_process_bloom(Engine* engine) {
             engine->buffers.color_buffer[idx] = color_to_uint32(original);
         }
     }
-    
-    free(temp);
 }
 
 void post_process_chromatic_aberration(Engine* engine) {
-    memcpy(engine->buffers.post_process_buffer, engine->buffers.color_buffer,
-           SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    // Samples stay on the same row, so one saved row is enough
+    uint32_t* row = (uint32_t*)frame_arena_alloc(&engine->frame_arena, SCREEN_WIDTH * sizeof(uint32_t));
+    if (!row) return;
     
     int offset = (int)(engine->post_fx.aberration_strength * 3.0f);
     
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        memcpy(row, &engine->buffers.color_buffer[y * SCREEN_WIDTH], SCREEN_WIDTH * sizeof(uint32_t));
+        
         for (int x = 0; x < SCREEN_WIDTH; x++) {
             int idx = y * SCREEN_WIDTH + x;
             
@@ -234,17 +249,17 @@ void post_process_chromatic_aberration(Engine* engine) {
             int rx = x - offset;
             uint8_t r = 0;
             if (rx >= 0 && rx < SCREEN_WIDTH) {
-                r = uint32_to_color(engine->buffers.post_process_buffer[y * SCREEN_WIDTH + rx]).r;
+                r = uint32_to_color(row[rx]).r;
             }
             
             // Green channel - no offset
-            uint8_t g = uint32_to_color(engine->buffers.post_process_buffer[idx]).g;
+            uint8_t g = uint32_to_color(row[x]).g;
             
             // Sample blue channel with offset
             int bx = x + offset;
             uint8_t b = 0;
             if (bx >= 0 && bx < SCREEN_WIDTH) {
-                b = uint32_to_color(engine->buffers.post_process_buffer[y * SCREEN_WIDTH + bx]).b;
+                b = uint32_to_color(row[bx]).b;
             }
             
             Color result = {r, g, b, 255};
@@ -253,39 +268,52 @@ void post_process_chromatic_aberration(Engine* engine) {
     }
 }
 
-void post_process_tone_mapping(Engine* engine) {
-    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
-        Color pixel = uint32_to_color(engine->buffers.color_buffer[i]);
-        
-        // Apply exposure
-        float r = pixel.r / 255.0f * engine->post_fx.exposure;
-        float g = pixel.g / 255.0f * engine->post_fx.exposure;
-        float b = pixel.b / 255.0f * engine->post_fx.exposure;
-        
-        // Reinhard tone mapping
-        r = r / (1.0f + r);
-        g = g / (1.0f + g);
-        b = b / (1.0f + b);
-        
-        // Gamma correction
-        r = powf(r, 1.0f / engine->post_fx.gamma);
-        g = powf(g, 1.0f / engine->post_fx.gamma);
-        b = powf(b, 1.0f / engine->post_fx.gamma);
-        
-        pixel.r = (uint8_t)(r * 255.0f);
-        pixel.g = (uint8_t)(g * 255.0f);
-        pixel.b = (uint8_t)(b * 255.0f);
+// The last three post passes read the colour buffer and write `target`,
+// which is the colour buffer itself unless the pass finishes the frame
+static inline uint32_t* render_target_row(RenderTarget target, int y) {
+    return (uint32_t*)((uint8_t*)target.pixels + (size_t)y * target.pitch);
+}
+
+void post_process_tone_mapping(Engine* engine, RenderTarget target) {
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        uint32_t* out = render_target_row(target, y);
         
-        engine->buffers.color_buffer[i] = color_to_uint32(pixel);
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            int i = y * SCREEN_WIDTH + x;
+            Color pixel = uint32_to_color(engine->buffers.color_buffer[i]);
+            
+            // Apply exposure
+            float r = pixel.r / 255.0f * engine->post_fx.exposure;
+            float g = pixel.g / 255.0f * engine->post_fx.exposure;
+            float b = pixel.b / 255.0f * engine->post_fx.exposure;
+            
+            // Reinhard tone mapping
+            r = r / (1.0f + r);
+            g = g / (1.0f + g);
+            b = b / (1.0f + b);
+            
+            // Gamma correction
+            r = powf(r, 1.0f / engine->post_fx.gamma);
+            g = powf(g, 1.0f / engine->post_fx.gamma);
+            b = powf(b, 1.0f / engine->post_fx.gamma);
+            
+            pixel.r = (uint8_t)(r * 255.0f);
+            pixel.g = (uint8_t)(g * 255.0f);
+            pixel.b = (uint8_t)(b * 255.0f);
+            
+            out[x] = color_to_uint32(pixel);
+        }
     }
 }
 
-void post_process_vignette(Engine* engine) {
+void post_process_vignette(Engine* engine, RenderTarget target) {
     float center_x = SCREEN_WIDTH * 0.5f;
     float center_y = SCREEN_HEIGHT * 0.5f;
     float max_dist = sqrtf(center_x * center_x + center_y * center_y);
     
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        uint32_t* out = render_target_row(target, y);
+        
         for (int x = 0; x < SCREEN_WIDTH; x++) {
             float dx = x - center_x;
             float dy = y - center_y;
@@ -301,27 +329,48 @@ void post_process_vignette(Engine* engine) {
             pixel.g = (uint8_t)(pixel.g * vignette);
             pixel.b = (uint8_t)(pixel.b * vignette);
             
-            engine->buffers.color_buffer[idx] = color_to_uint32(pixel);
+            out[x] = color_to_uint32(pixel);
         }
     }
 }
 
-void post_process_fxaa(Engine* engine) {
-    memcpy(engine->buffers.post_process_buffer, engine->buffers.color_buffer,
-           SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+void post_process_fxaa(Engine* engine, RenderTarget target) {
+    // Unfiltered copies of the rows above, at and below the current one
+    size_t row_bytes = SCREEN_WIDTH * sizeof(uint32_t);
+    uint32_t* above = (uint32_t*)frame_arena_alloc(&engine->frame_arena, row_bytes);
+    uint32_t* row = (uint32_t*)frame_arena_alloc(&engine->frame_arena, row_bytes);
+    uint32_t* below = (uint32_t*)frame_arena_alloc(&engine->frame_arena, row_bytes);
+    if (!above || !row || !below) return;
     
     const float EDGE_THRESHOLD = 0.125f;
     const float SUBPIX_QUALITY = 0.75f;
     
+    memcpy(above, &engine->buffers.color_buffer[0], row_bytes);
+    memcpy(row, &engine->buffers.color_buffer[SCREEN_WIDTH], row_bytes);
+    
+    // Border pixels are not filtered; an external target still needs them
+    bool in_place = target.pixels == engine->buffers.color_buffer;
+    if (!in_place) {
+        memcpy(render_target_row(target, 0), above, row_bytes);
+        memcpy(render_target_row(target, SCREEN_HEIGHT - 1),
+               &engine->buffers.color_buffer[(SCREEN_HEIGHT - 1) * SCREEN_WIDTH], row_bytes);
+    }
+    
     for (int y = 1; y < SCREEN_HEIGHT - 1; y++) {
+        memcpy(below, &engine->buffers.color_buffer[(y + 1) * SCREEN_WIDTH], row_bytes);
+        uint32_t* out = render_target_row(target, y);
+        
+        if (!in_place) {
+            out[0] = row[0];
+            out[SCREEN_WIDTH - 1] = row[SCREEN_WIDTH - 1];
+        }
+        
         for (int x = 1; x < SCREEN_WIDTH - 1; x++) {
-            int idx = y * SCREEN_WIDTH + x;
-            
-            Color center = uint32_to_color(engine->buffers.post_process_buffer[idx]);
-            Color top = uint32_to_color(engine->buffers.post_process_buffer[(y-1) * SCREEN_WIDTH + x]);
-            Color bottom = uint32_to_color(engine->buffers.post_process_buffer[(y+1) * SCREEN_WIDTH + x]);
-            Color left = uint32_to_color(engine->buffers.post_process_buffer[y * SCREEN_WIDTH + (x-1)]);
-            Color right = uint32_to_color(engine->buffers.post_process_buffer[y * SCREEN_WIDTH + (x+1)]);
+            Color center = uint32_to_color(row[x]);
+            Color top = uint32_to_color(above[x]);
+            Color bottom = uint32_to_color(below[x]);
+            Color left = uint32_to_color(row[x - 1]);
+            Color right = uint32_to_color(row[x + 1]);
             
             float luma_center = (center.r + center.g + center.b) / (3.0f * 255.0f);
             float luma_top = (top.r + top.g + top.b) / (3.0f * 255.0f);
@@ -340,9 +389,16 @@ void post_process_fxaa(Engine* engine) {
                     255
                 };
                 
-                engine->buffers.color_buffer[idx] = color_to_uint32(blend);
+                out[x] = color_to_uint32(blend);
+            } else if (!in_place) {
+                out[x] = row[x];
             }
         }
+        
+        uint32_t* recycled = above;
+        above = row;
+        row = below;
+        below = recycled;
     }
 }
 
@@ -356,8 +412,11 @@ void post_process_motion_blur(Engine* engine) {
     if (samples < 2) return;
     if (samples > 16) samples = 16;
     
-    memcpy(engine->buffers.post_process_buffer, engine->buffers.color_buffer,
-           SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    // Samples reach rows above and below, so blur from a full copy
+    uint32_t* source = (uint32_t*)frame_arena_alloc(&engine->frame_arena, 
+                                                    SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    if (!source) return;
+    memcpy(source, engine->buffers.color_buffer, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
     
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
         for (int x = 0; x < SCREEN_WIDTH; x++) {
@@ -369,7 +428,7 @@ void post_process_motion_blur(Engine* engine) {
                 int sy = y + (int)(blur_dir.y * offset);
                 
                 if (sx >= 0 && sx < SCREEN_WIDTH && sy >= 0 && sy < SCREEN_HEIGHT) {
-                    Color c = uint32_to_color(engine->buffers.post_process_buffer[sy * SCREEN_WIDTH + sx]);
+                    Color c = uint32_to_color(source[sy * SCREEN_WIDTH + sx]);
                     sum.r += c.r;
                     sum.g += c.g;
                     sum.b += c.b;
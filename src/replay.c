@@ -0,0 +1,300 @@
+#include "../include/engine.h"
+#include <stdio.h>
+#include <string.h>
+
+// Replay log layout (little endian):
+//   header: "RCRP", u16 version, u16 reserved, u32 seed, f32 tick rate,
+//           u32 initial post-processing toggle state
+//   stream: one record per tick, each starting with a tag byte
+//     0x80 | n      - n idle ticks (same buttons, no mouse motion or toggles)
+//     field mask    - one tick; fields follow as varints in mask order
+//     0x40          - end of stream
+#define REPLAY_MAGIC "RCRP"
+#define REPLAY_VERSION 1
+
+#define REPLAY_FIELD_BUTTONS  0x01
+#define REPLAY_FIELD_MOUSE_X  0x02
+#define REPLAY_FIELD_MOUSE_Y  0x04
+#define REPLAY_FIELD_TOGGLES  0x08
+#define REPLAY_TAG_END        0x40
+#define REPLAY_TAG_REPEAT     0x80
+#define REPLAY_MAX_REPEAT     0x7F
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t seed;
+    float tick_rate;
+    uint32_t toggles;
+} ReplayHeader;
+
+static void write_varint(FILE* file, uint32_t value) {
+    while (value >= 0x80) {
+        fputc((int)(value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static bool read_varint(FILE* file, uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF) return false;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t zigzag_encode(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint32_t replay_toggle_state(Engine* engine) {
+    uint32_t state = 0;
+    if (engine->post_fx.bloom_enabled) state |= TOGGLE_BLOOM;
+    if (engine->post_fx.motion_blur_enabled) state |= TOGGLE_MOTION_BLUR;
+    if (engine->post_fx.vignette) state |= TOGGLE_VIGNETTE;
+    if (engine->post_fx.fxaa_enabled) state |= TOGGLE_FXAA;
+    return state;
+}
+
+static void replay_flush_repeats(Replay* replay) {
+    if (replay->repeat_count > 0) {
+        fputc(REPLAY_TAG_REPEAT | (int)replay->repeat_count, (FILE*)replay->file);
+        replay->repeat_count = 0;
+    }
+}
+
+bool replay_begin_record(Engine* engine, const char* filename) {
+    replay_close(engine);
+    
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot open replay log %s for writing\n", filename);
+        return false;
+    }
+    
+    ReplayHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REPLAY_MAGIC, 4);
+    header.version = REPLAY_VERSION;
+    header.seed = engine->seed;
+    header.tick_rate = 1.0f / engine->fixed_dt;
+    header.toggles = replay_toggle_state(engine);
+    fwrite(&header, sizeof(header), 1, file);
+    
+    memset(&engine->replay, 0, sizeof(Replay));
+    engine->replay.mode = REPLAY_RECORDING;
+    engine->replay.file = file;
+    return true;
+}
+
+static bool replay_read_header(FILE* file, ReplayHeader* header) {
+    if (fread(header, sizeof(*header), 1, file) != 1) return false;
+    return memcmp(header->magic, REPLAY_MAGIC, 4) == 0 &&
+           header->version == REPLAY_VERSION;
+}
+
+bool replay_read_seed(const char* filename, uint32_t* seed) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return false;
+    
+    ReplayHeader header;
+    bool ok = replay_read_header(file, &header);
+    fclose(file);
+    
+    if (ok) *seed = header.seed;
+    return ok;
+}
+
+// The engine must already be initialised with the log's seed
+bool replay_begin_playback(Engine* engine, const char* filename) {
+    replay_close(engine);
+    
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open replay log %s\n", filename);
+        return false;
+    }
+    
+    ReplayHeader header;
+    if (!replay_read_header(file, &header)) {
+        fprintf(stderr, "%s is not a replay log\n", filename);
+        fclose(file);
+        return false;
+    }
+    
+    if (header.seed != engine->seed) {
+        fprintf(stderr, "Replay seed %u does not match engine seed %u\n",
+                header.seed, engine->seed);
+        fclose(file);
+        return false;
+    }
+    
+    engine_set_tick_rate(engine, header.tick_rate);
+    engine->post_fx.bloom_enabled = (header.toggles & TOGGLE_BLOOM) != 0;
+    engine->post_fx.motion_blur_enabled = (header.toggles & TOGGLE_MOTION_BLUR) != 0;
+    engine->post_fx.vignette = (header.toggles & TOGGLE_VIGNETTE) != 0;
+    engine->post_fx.fxaa_enabled = (header.toggles & TOGGLE_FXAA) != 0;
+    
+    memset(&engine->replay, 0, sizeof(Replay));
+    engine->replay.mode = REPLAY_PLAYING;
+    engine->replay.file = file;
+    return true;
+}
+
+static void replay_record_tick(Replay* replay, InputFrame* input) {
+    FILE* file = (FILE*)replay->file;
+    
+    uint8_t mask = 0;
+    if (input->buttons != replay->last.buttons) mask |= REPLAY_FIELD_BUTTONS;
+    if (input->mouse_dx != 0) mask |= REPLAY_FIELD_MOUSE_X;
+    if (input->mouse_dy != 0) mask |= REPLAY_FIELD_MOUSE_Y;
+    if (input->toggles != 0) mask |= REPLAY_FIELD_TOGGLES;
+    
+    // Idle ticks collapse into run-length records
+    if (mask == 0) {
+        if (++replay->repeat_count == REPLAY_MAX_REPEAT) {
+            replay_flush_repeats(replay);
+        }
+        return;
+    }
+    
+    replay_flush_repeats(replay);
+    fputc(mask, file);
+    if (mask & REPLAY_FIELD_BUTTONS) write_varint(file, input->buttons);
+    if (mask & REPLAY_FIELD_MOUSE_X) write_varint(file, zigzag_encode(input->mouse_dx));
+    if (mask & REPLAY_FIELD_MOUSE_Y) write_varint(file, zigzag_encode(input->mouse_dy));
+    if (mask & REPLAY_FIELD_TOGGLES) write_varint(file, input->toggles);
+    
+    replay->last.buttons = input->buttons;
+}
+
+static void replay_play_tick(Replay* replay, InputFrame* input) {
+    FILE* file = (FILE*)replay->file;
+    
+    input->buttons = replay->last.buttons;
+    input->mouse_dx = 0;
+    input->mouse_dy = 0;
+    input->toggles = 0;
+    
+    if (replay->finished) return;
+    
+    if (replay->repeat_count > 0) {
+        replay->repeat_count--;
+        return;
+    }
+    
+    int tag = fgetc(file);
+    if (tag == EOF || tag == REPLAY_TAG_END) {
+        replay->finished = true;
+        replay->last.buttons = 0;
+        input->buttons = 0;
+        return;
+    }
+    
+    if (tag & REPLAY_TAG_REPEAT) {
+        // This tick is the first of the run
+        replay->repeat_count = (uint32_t)(tag & REPLAY_MAX_REPEAT) - 1;
+        return;
+    }
+    
+    uint32_t value = 0;
+    bool ok = true;
+    if (tag & REPLAY_FIELD_BUTTONS) {
+        ok = ok && read_varint(file, &value);
+        input->buttons = value;
+    }
+    if (tag & REPLAY_FIELD_MOUSE_X) {
+        ok = ok && read_varint(file, &value);
+        input->mouse_dx = zigzag_decode(value);
+    }
+    if (tag & REPLAY_FIELD_MOUSE_Y) {
+        ok = ok && read_varint(file, &value);
+        input->mouse_dy = zigzag_decode(value);
+    }
+    if (tag & REPLAY_FIELD_TOGGLES) {
+        ok = ok && read_varint(file, &value);
+        input->toggles = value;
+    }
+    
+    if (!ok) {
+        fprintf(stderr, "Replay log truncated at tick %llu\n",
+                (unsigned long long)replay->tick);
+        replay->finished = true;
+        replay->last.buttons = 0;
+        *input = (InputFrame){0};
+        return;
+    }
+    
+    replay->last.buttons = input->buttons;
+}
+
+// Called by engine_step before input is applied
+void replay_tick(Engine* engine) {
+    Replay* replay = &engine->replay;
+    
+    if (replay->mode == REPLAY_RECORDING) {
+        replay_record_tick(replay, &engine->input);
+    } else if (replay->mode == REPLAY_PLAYING) {
+        replay_play_tick(replay, &engine->input);
+    } else {
+        return;
+    }
+    
+    replay->tick++;
+}
+
+void replay_close(Engine* engine) {
+    Replay* replay = &engine->replay;
+    if (!replay->file) return;
+    
+    if (replay->mode == REPLAY_RECORDING) {
+        replay_flush_repeats(replay);
+        fputc(REPLAY_TAG_END, (FILE*)replay->file);
+    }
+    
+    fclose((FILE*)replay->file);
+    replay->file = NULL;
+    replay->mode = REPLAY_OFF;
+}
+
+// FNV-1a over the simulation state, for comparing runs across commits
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t replay_state_checksum(Engine* engine) {
+    uint32_t hash = 2166136261u;
+    
+    hash = fnv1a(hash, &engine->camera.position, sizeof(Vec2));
+    hash = fnv1a(hash, &engine->camera.direction, sizeof(Vec2));
+    hash = fnv1a(hash, &engine->camera.physics.velocity, sizeof(Vec2));
+    hash = fnv1a(hash, &engine->rng_state, sizeof(uint32_t));
+    
+    for (int i = 0; i < engine->world.door_count; i++) {
+        hash = fnv1a(hash, &engine->world.doors[i].open_amount, sizeof(float));
+    }
+    hash = fnv1a(hash, engine->particles.position, engine->particles.count * sizeof(Vec3));
+    hash = fnv1a(hash, engine->sprites.position, engine->sprites.count * sizeof(Vec2));
+    for (int i = 0; i < engine->physics_world.body_count; i++) {
+        hash = fnv1a(hash, &engine->physics_world.bodies[i].position, sizeof(Vec2));
+    }
+    
+    return hash;
+}
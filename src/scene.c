@@ -0,0 +1,56 @@
+#include "../include/engine.h"
+
+// Procedural textures and the torch light. Interactive runs, replays and
+// the headless runner all load this scene, so their checksums agree.
+void scene_load_demo(Engine* engine) {
+    // Generate some procedural textures
+    for (int i = 0; i < 4 && engine->texture_count < MAX_TEXTURES; i++) {
+        Texture* tex = &engine->textures[engine->texture_count];
+        tex->width = TEXTURE_SIZE;
+        tex->height = TEXTURE_SIZE;
+        tex->pixels = (uint32_t*)memory_alloc(TEXTURE_SIZE * TEXTURE_SIZE * sizeof(uint32_t), 0,
+                                              MEMORY_TAG_TEXTURES);
+        
+        // Generate different patterns
+        for (int y = 0; y < TEXTURE_SIZE; y++) {
+            for (int x = 0; x < TEXTURE_SIZE; x++) {
+                uint8_t r, g, b;
+                
+                switch (i) {
+                    case 0: // Brick pattern
+                        r = 150 + (x % 8 < 1 || y % 8 < 1 ? 50 : 0);
+                        g = 80 + (x % 8 < 1 || y % 8 < 1 ? 30 : 0);
+                        b = 70 + (x % 8 < 1 || y % 8 < 1 ? 20 : 0);
+                        break;
+                    case 1: // Stone pattern
+                        r = g = b = 100 + ((x * y) % 50);
+                        break;
+                    case 2: // Wood grain
+                        r = 139 + (int)(20 * perlin_noise_2d(x * 0.1f, y * 0.5f));
+                        g = 90 + (int)(15 * perlin_noise_2d(x * 0.1f, y * 0.5f));
+                        b = 60 + (int)(10 * perlin_noise_2d(x * 0.1f, y * 0.5f));
+                        break;
+                    case 3: // Metal
+                        r = g = b = 180 + (int)(30 * perlin_noise_2d(x * 0.2f, y * 0.2f));
+                        break;
+                }
+                
+                Color c = {r, g, b, 255};
+                tex->pixels[y * TEXTURE_SIZE + x] = color_to_uint32(c);
+            }
+        }
+        
+        engine->texture_count++;
+    }
+    
+    // Add some dynamic lights
+    Light torch = {
+        {10.0f, 10.0f, 2.0f},
+        {1.0f, 0.3f, 0.1f, 1.0f},
+        8.0f,
+        12.0f,
+        true,
+        0.2f
+    };
+    light_add(engine, &torch);
+}
@@ -80,12 +80,12 @@ static ScriptValue builtin_play_sound(Engine* engine, ScriptValue* args, int arg
         return error;
     }
     
-    if (engine->audio_source_count >= MAX_AUDIO_SOURCES) {
+    AudioSource* source = audio_source_add(engine);
+    if (!source) {
         ScriptValue error = {SCRIPT_TYPE_NULL};
         return error;
     }
     
-    AudioSource* source = &engine->audio_sources[engine->audio_source_count++];
     source->position = args[0].data.vector;
     source->volume = 1.0f;
     source->pitch = 1.0f;
@@ -103,6 +103,22 @@ static ScriptValue builtin_play_sound(Engine* engine, ScriptValue* args, int arg
     return result;
 }
 
+static ScriptValue builtin_apply_impulse(Engine* engine, ScriptValue* args, int arg_count) {
+    if (arg_count < 2 || args[0].type != SCRIPT_TYPE_NUMBER || 
+        args[1].type != SCRIPT_TYPE_VECTOR3) {
+        ScriptValue error = {SCRIPT_TYPE_NULL};
+        return error;
+    }
+    
+    int body = (int)args[0].data.number;
+    Vec2 impulse = {args[1].data.vector.x, args[1].data.vector.y};
+    physics_apply_impulse(&engine->physics_world, body, impulse);
+    
+    ScriptValue result = {.type = SCRIPT_TYPE_BOOL};
+    result.data.boolean = body >= 0 && body < engine->physics_world.body_count;
+    return result;
+}
+
 void script_init(Engine* engine) {
     engine->script_count = 0;
     registry_count = 0;
@@ -112,6 +128,7 @@ void script_init(Engine* engine) {
     script_register_function("spawn_particle", builtin_spawn_particle);
     script_register_function("get_player_pos", builtin_get_player_pos);
     script_register_function("play_sound", builtin_play_sound);
+    script_register_function("apply_impulse", builtin_apply_impulse);
 }
 
 void script_cleanup(Engine* engine) {
@@ -119,7 +136,7 @@ void script_cleanup(Engine* engine) {
     for (int i = 0; i < engine->script_count; i++) {
         for (int j = 0; j < engine->scripts[i].property_count; j++) {
             if (engine->scripts[i].properties[j].type == SCRIPT_TYPE_STRING) {
-                free(engine->scripts[i].properties[j].data.string);
+                memory_free(engine->scripts[i].properties[j].data.string);
             }
         }
     }
@@ -128,9 +145,9 @@ void script_cleanup(Engine* engine) {
 
 void script_load(Engine* engine, const char* filename) {
     // Simplified script loading - in real implementation would parse a script file
-    if (engine->script_count >= MAX_SCRIPTS) return;
+    Script* script = script_add(engine);
+    if (!script) return;
     
-    Script* script = &engine->scripts[engine->script_count++];
     strncpy(script->name, filename, 63);
     script->name[63] = '\0';
     script->active = true;
@@ -187,6 +204,21 @@ void script_register_function(const char* name, ScriptFunction func) {
     registry_count++;
 }
 
+// Registry index of a function, used to serialise script callbacks
+int script_function_id(ScriptFunction func) {
+    if (!func) return -1;
+    
+    for (int i = 0; i < registry_count; i++) {
+        if (function_registry[i].function == func) return i;
+    }
+    return -1;
+}
+
+ScriptFunction script_function_from_id(int id) {
+    if (id < 0 || id >= registry_count) return NULL;
+    return function_registry[id].function;
+}
+
 ScriptValue script_create_value_number(float value) {
     ScriptValue result;
     result.type = SCRIPT_TYPE_NUMBER;
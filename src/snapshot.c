@@ -0,0 +1,729 @@
+#include "../include/engine.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Snapshot layout: a header, a table of sections, then the section payloads.
+// Every payload is a flat array of pointer-free structs, so saving and
+// restoring is one memcpy per section. The sprite and particle stores are
+// saved column by column, matching their in-memory layout. Render buffers, textures, threads and
+// compute buffers are not simulation state and are left untouched; restore
+// into an engine that has already been through engine_init.
+#define SNAPSHOT_MAGIC "RCSS"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_MAX_SECTIONS 32
+#define SNAPSHOT_ALIGNMENT 16
+#define SNAPSHOT_MAX_ROWS ((1 << ENTITY_INDEX_BITS) - 1)
+
+enum {
+    SNAPSHOT_SECTION_CORE = 1,
+    SNAPSHOT_SECTION_WORLD,
+    SNAPSHOT_SECTION_LIGHTS,
+    SNAPSHOT_SECTION_BODIES,
+    SNAPSHOT_SECTION_PROBES,
+    SNAPSHOT_SECTION_AUDIO,
+    SNAPSHOT_SECTION_SCRIPTS,
+    // Sprite rows, then the handle slot table
+    SNAPSHOT_SECTION_SPRITE_POSITION,
+    SNAPSHOT_SECTION_SPRITE_PREV_POSITION,
+    SNAPSHOT_SECTION_SPRITE_Z_HEIGHT,
+    SNAPSHOT_SECTION_SPRITE_VISUAL,
+    SNAPSHOT_SECTION_SPRITE_ANIMATION,
+    SNAPSHOT_SECTION_SPRITE_ROW_SLOT,
+    SNAPSHOT_SECTION_SPRITE_SLOT_GENERATION,
+    SNAPSHOT_SECTION_SPRITE_SLOT_ROW,
+    // Particle rows
+    SNAPSHOT_SECTION_PARTICLE_POSITION,
+    SNAPSHOT_SECTION_PARTICLE_PREV_POSITION,
+    SNAPSHOT_SECTION_PARTICLE_VELOCITY,
+    SNAPSHOT_SECTION_PARTICLE_COLOR,
+    SNAPSHOT_SECTION_PARTICLE_LIFETIME,
+    SNAPSHOT_SECTION_PARTICLE_SIZE,
+    SNAPSHOT_SECTION_PARTICLE_GRAVITY_SCALE,
+    SNAPSHOT_SECTION_PARTICLE_TEXTURE,
+    SNAPSHOT_SECTION_LIMIT
+};
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t size;
+    uint64_t tick;
+    uint32_t section_count;
+    uint32_t reserved;
+} SnapshotHeader;
+
+typedef struct {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t offset;
+    uint64_t count;
+} SnapshotSection;
+
+// Scalar simulation state gathered into one block
+typedef struct {
+    uint32_t seed;
+    uint32_t rng_state;
+    uint64_t tick_count;
+    uint64_t frame_count;
+    float delta_time;
+    float time_accumulator;
+    float sim_accumulator;
+    float fixed_dt;
+    float interpolation_alpha;
+    InputFrame input;
+    Camera camera;
+    Camera prev_camera;
+    Fog fog;
+    PostProcessing post_fx;
+    bool use_gi;
+    float sleep_velocity;
+    float sleep_time;
+    int active_bodies;
+    int sleeping_bodies;
+    int island_count;
+} SnapshotCore;
+
+// Scripts with callbacks as registry ids and strings stored inline
+typedef struct {
+    char name[64];
+    ScriptValueType type;
+    union {
+        float number;
+        bool boolean;
+        Vec3 vector;
+    } data;
+    char string[64];
+} SnapshotProperty;
+
+typedef struct {
+    char name[64];
+    bool active;
+    int32_t update_id;
+    int32_t on_collision_id;
+    int32_t on_trigger_id;
+    int32_t property_count;
+    SnapshotProperty properties[32];
+} SnapshotScript;
+
+typedef struct {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t count;
+    const void* data;
+} SnapshotSource;
+
+// A component column of one of the entity stores
+typedef struct {
+    uint32_t id;
+    uint32_t element_size;
+    void** data;
+} SnapshotColumn;
+
+#define SNAPSHOT_SPRITE_COLUMNS 6
+#define SNAPSHOT_SLOT_COLUMNS 2
+#define SNAPSHOT_PARTICLE_COLUMNS 8
+
+static double snapshot_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static size_t snapshot_align(size_t offset) {
+    return (offset + SNAPSHOT_ALIGNMENT - 1) & ~(size_t)(SNAPSHOT_ALIGNMENT - 1);
+}
+
+static void snapshot_fill_core(Engine* engine, SnapshotCore* core) {
+    memset(core, 0, sizeof(SnapshotCore));
+    core->seed = engine->seed;
+    core->rng_state = engine->rng_state;
+    core->tick_count = engine->tick_count;
+    core->frame_count = engine->frame_count;
+    core->delta_time = engine->delta_time;
+    core->time_accumulator = engine->time_accumulator;
+    core->sim_accumulator = engine->sim_accumulator;
+    core->fixed_dt = engine->fixed_dt;
+    core->interpolation_alpha = engine->interpolation_alpha;
+    core->input = engine->input;
+    core->camera = engine->camera;
+    core->prev_camera = engine->prev_camera;
+    core->fog = engine->fog;
+    core->post_fx = engine->post_fx;
+    core->use_gi = engine->use_gi;
+    core->sleep_velocity = engine->physics_world.sleep_velocity;
+    core->sleep_time = engine->physics_world.sleep_time;
+    core->active_bodies = engine->physics_world.active_count;
+    core->sleeping_bodies = engine->physics_world.sleeping_count;
+    core->island_count = engine->physics_world.island_count;
+}
+
+static void snapshot_apply_core(Engine* engine, const SnapshotCore* core) {
+    engine->seed = core->seed;
+    engine->rng_state = core->rng_state;
+    engine->tick_count = core->tick_count;
+    engine->frame_count = core->frame_count;
+    engine->delta_time = core->delta_time;
+    engine->time_accumulator = core->time_accumulator;
+    engine->sim_accumulator = core->sim_accumulator;
+    engine->fixed_dt = core->fixed_dt;
+    engine->interpolation_alpha = core->interpolation_alpha;
+    engine->input = core->input;
+    engine->camera = core->camera;
+    engine->prev_camera = core->prev_camera;
+    engine->fog = core->fog;
+    engine->post_fx = core->post_fx;
+    engine->use_gi = core->use_gi;
+    engine->physics_world.sleep_velocity = core->sleep_velocity;
+    engine->physics_world.sleep_time = core->sleep_time;
+    engine->physics_world.active_count = core->active_bodies;
+    engine->physics_world.sleeping_count = core->sleeping_bodies;
+    engine->physics_world.island_count = core->island_count;
+}
+
+static void snapshot_fill_script(const Script* script, SnapshotScript* out) {
+    memset(out, 0, sizeof(SnapshotScript));
+    memcpy(out->name, script->name, sizeof(out->name));
+    out->active = script->active;
+    out->update_id = script_function_id(script->update);
+    out->on_collision_id = script_function_id(script->on_collision);
+    out->on_trigger_id = script_function_id(script->on_trigger);
+    out->property_count = script->property_count;
+    
+    for (int i = 0; i < script->property_count; i++) {
+        const ScriptProperty* prop = &script->properties[i];
+        SnapshotProperty* dst = &out->properties[i];
+        
+        memcpy(dst->name, prop->name, sizeof(dst->name));
+        dst->type = prop->type;
+        switch (prop->type) {
+            case SCRIPT_TYPE_NUMBER:
+                dst->data.number = prop->data.number;
+                break;
+            case SCRIPT_TYPE_BOOL:
+                dst->data.boolean = prop->data.boolean;
+                break;
+            case SCRIPT_TYPE_VECTOR3:
+                dst->data.vector = prop->data.vector;
+                break;
+            case SCRIPT_TYPE_STRING:
+                if (prop->data.string) {
+                    strncpy(dst->string, prop->data.string, sizeof(dst->string) - 1);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static void snapshot_apply_script(Script* script, const SnapshotScript* in) {
+    // Release strings owned by the script being overwritten
+    for (int i = 0; i < script->property_count; i++) {
+        if (script->properties[i].type == SCRIPT_TYPE_STRING) {
+            memory_free(script->properties[i].data.string);
+        }
+    }
+    
+    memset(script, 0, sizeof(Script));
+    memcpy(script->name, in->name, sizeof(script->name) - 1);
+    script->active = in->active;
+    script->update = script_function_from_id(in->update_id);
+    script->on_collision = script_function_from_id(in->on_collision_id);
+    script->on_trigger = script_function_from_id(in->on_trigger_id);
+    script->property_count = in->property_count;
+    
+    for (int i = 0; i < in->property_count; i++) {
+        const SnapshotProperty* src = &in->properties[i];
+        ScriptProperty* prop = &script->properties[i];
+        
+        memcpy(prop->name, src->name, sizeof(prop->name) - 1);
+        prop->type = src->type;
+        switch (src->type) {
+            case SCRIPT_TYPE_NUMBER:
+                prop->data.number = src->data.number;
+                break;
+            case SCRIPT_TYPE_BOOL:
+                prop->data.boolean = src->data.boolean;
+                break;
+            case SCRIPT_TYPE_VECTOR3:
+                prop->data.vector = src->data.vector;
+                break;
+            case SCRIPT_TYPE_STRING: {
+                // A failed copy leaves the property empty rather than dangling
+                size_t length = strnlen(src->string, sizeof(src->string) - 1);
+                prop->data.string = (char*)memory_alloc(length + 1, 0, MEMORY_TAG_SCRIPTS);
+                if (!prop->data.string) {
+                    fprintf(stderr, "Out of memory restoring script property %s\n", prop->name);
+                    prop->type = SCRIPT_TYPE_NUMBER;
+                    prop->data.number = 0.0f;
+                    break;
+                }
+                memcpy(prop->data.string, src->string, length);
+                prop->data.string[length] = '\0';
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+static void snapshot_sprite_columns(SpriteStore* sprites, SnapshotColumn* rows,
+                                    SnapshotColumn* slots) {
+    rows[0] = (SnapshotColumn){SNAPSHOT_SECTION_SPRITE_POSITION, sizeof(Vec2), (void**)&sprites->position};
+    rows[1] = (SnapshotColumn){SNAPSHOT_SECTION_SPRITE_PREV_POSITION, sizeof(Vec2), (void**)&sprites->prev_position};
+    rows[2] = (SnapshotColumn){SNAPSHOT_SECTION_SPRITE_Z_HEIGHT, sizeof(float), (void**)&sprites->z_height};
+    rows[3] = (SnapshotColumn){SNAPSHOT_SECTION_SPRITE_VISUAL, sizeof(SpriteVisual), (void**)&sprites->visual};
+    rows[4] = (SnapshotColumn){SNAPSHOT_SECTION_SPRITE_ANIMATION, sizeof(SpriteAnimation), (void**)&sprites->animation};
+    rows[5] = (SnapshotColumn){SNAPSHOT_SECTION_SPRITE_ROW_SLOT, sizeof(int), (void**)&sprites->index.slot};
+    slots[0] = (SnapshotColumn){SNAPSHOT_SECTION_SPRITE_SLOT_GENERATION, sizeof(uint32_t), (void**)&sprites->index.generation};
+    slots[1] = (SnapshotColumn){SNAPSHOT_SECTION_SPRITE_SLOT_ROW, sizeof(int), (void**)&sprites->index.row};
+}
+
+static void snapshot_particle_columns(ParticleStore* particles, SnapshotColumn* rows) {
+    rows[0] = (SnapshotColumn){SNAPSHOT_SECTION_PARTICLE_POSITION, sizeof(Vec3), (void**)&particles->position};
+    rows[1] = (SnapshotColumn){SNAPSHOT_SECTION_PARTICLE_PREV_POSITION, sizeof(Vec3), (void**)&particles->prev_position};
+    rows[2] = (SnapshotColumn){SNAPSHOT_SECTION_PARTICLE_VELOCITY, sizeof(Vec3), (void**)&particles->velocity};
+    rows[3] = (SnapshotColumn){SNAPSHOT_SECTION_PARTICLE_COLOR, sizeof(ColorF), (void**)&particles->color};
+    rows[4] = (SnapshotColumn){SNAPSHOT_SECTION_PARTICLE_LIFETIME, sizeof(float), (void**)&particles->lifetime};
+    rows[5] = (SnapshotColumn){SNAPSHOT_SECTION_PARTICLE_SIZE, sizeof(float), (void**)&particles->size};
+    rows[6] = (SnapshotColumn){SNAPSHOT_SECTION_PARTICLE_GRAVITY_SCALE, sizeof(float), (void**)&particles->gravity_scale};
+    rows[7] = (SnapshotColumn){SNAPSHOT_SECTION_PARTICLE_TEXTURE, sizeof(int), (void**)&particles->texture_id};
+}
+
+static int snapshot_gather_columns(SnapshotSource* sources, const SnapshotColumn* columns,
+                                   int column_count, int rows) {
+    for (int i = 0; i < column_count; i++) {
+        sources[i] = (SnapshotSource){columns[i].id, columns[i].element_size,
+                                      (uint64_t)rows, *columns[i].data};
+    }
+    return column_count;
+}
+
+// Sections in file order; scripts are converted while writing
+static int snapshot_gather(Engine* engine, SnapshotSource* sources, const SnapshotCore* core) {
+    SnapshotColumn sprite_rows[SNAPSHOT_SPRITE_COLUMNS];
+    SnapshotColumn sprite_slots[SNAPSHOT_SLOT_COLUMNS];
+    SnapshotColumn particle_rows[SNAPSHOT_PARTICLE_COLUMNS];
+    snapshot_sprite_columns(&engine->sprites, sprite_rows, sprite_slots);
+    snapshot_particle_columns(&engine->particles, particle_rows);
+    
+    int n = 0;
+    sources[n++] = (SnapshotSource){SNAPSHOT_SECTION_CORE, sizeof(SnapshotCore), 1, core};
+    sources[n++] = (SnapshotSource){SNAPSHOT_SECTION_WORLD, sizeof(WorldMap), 1, &engine->world};
+    sources[n++] = (SnapshotSource){SNAPSHOT_SECTION_LIGHTS, sizeof(Light),
+                                    (uint64_t)engine->light_count, engine->lights};
+    sources[n++] = (SnapshotSource){SNAPSHOT_SECTION_BODIES, sizeof(PhysicsBody),
+                                    (uint64_t)engine->physics_world.body_count,
+                                    engine->physics_world.bodies};
+    sources[n++] = (SnapshotSource){SNAPSHOT_SECTION_PROBES, sizeof(IrradianceProbe),
+                                    (uint64_t)engine->probe_count, engine->gi_probes};
+    sources[n++] = (SnapshotSource){SNAPSHOT_SECTION_AUDIO, sizeof(AudioSource),
+                                    (uint64_t)engine->audio_source_count, engine->audio_sources};
+    sources[n++] = (SnapshotSource){SNAPSHOT_SECTION_SCRIPTS, sizeof(SnapshotScript),
+                                    (uint64_t)engine->script_count, engine->scripts};
+    n += snapshot_gather_columns(&sources[n], sprite_rows, SNAPSHOT_SPRITE_COLUMNS,
+                                 engine->sprites.count);
+    n += snapshot_gather_columns(&sources[n], sprite_slots, SNAPSHOT_SLOT_COLUMNS,
+                                 engine->sprites.index.slot_count);
+    n += snapshot_gather_columns(&sources[n], particle_rows, SNAPSHOT_PARTICLE_COLUMNS,
+                                 engine->particles.count);
+    return n;
+}
+
+static size_t snapshot_layout_size(const SnapshotSource* sources, int count) {
+    size_t size = snapshot_align(sizeof(SnapshotHeader) + count * sizeof(SnapshotSection));
+    for (int i = 0; i < count; i++) {
+        size = snapshot_align(size + sources[i].element_size * sources[i].count);
+    }
+    return size;
+}
+
+size_t engine_snapshot_size(Engine* engine) {
+    SnapshotSource sources[SNAPSHOT_MAX_SECTIONS];
+    int count = snapshot_gather(engine, sources, NULL);
+    return snapshot_layout_size(sources, count);
+}
+
+// Returns the number of bytes written, or 0 if the buffer is too small
+size_t engine_snapshot_save(Engine* engine, void* buffer, size_t capacity) {
+    double start = snapshot_now_ms();
+    
+    SnapshotCore core;
+    snapshot_fill_core(engine, &core);
+    
+    SnapshotSource sources[SNAPSHOT_MAX_SECTIONS];
+    int count = snapshot_gather(engine, sources, &core);
+    size_t size = snapshot_layout_size(sources, count);
+    if (size > capacity) return 0;
+    
+    uint8_t* out = (uint8_t*)buffer;
+    SnapshotHeader* header = (SnapshotHeader*)out;
+    SnapshotSection* table = (SnapshotSection*)(out + sizeof(SnapshotHeader));
+    
+    memset(header, 0, sizeof(SnapshotHeader));
+    memcpy(header->magic, SNAPSHOT_MAGIC, 4);
+    header->version = SNAPSHOT_VERSION;
+    header->size = size;
+    header->tick = engine->tick_count;
+    header->section_count = (uint32_t)count;
+    
+    size_t offset = snapshot_align(sizeof(SnapshotHeader) + count * sizeof(SnapshotSection));
+    
+    audio_lock();
+    for (int i = 0; i < count; i++) {
+        size_t bytes = sources[i].element_size * sources[i].count;
+        
+        table[i].id = sources[i].id;
+        table[i].element_size = sources[i].element_size;
+        table[i].offset = offset;
+        table[i].count = sources[i].count;
+        
+        if (sources[i].id == SNAPSHOT_SECTION_SCRIPTS) {
+            SnapshotScript* scripts = (SnapshotScript*)(out + offset);
+            for (int s = 0; s < engine->script_count; s++) {
+                snapshot_fill_script(&engine->scripts[s], &scripts[s]);
+            }
+        } else if (bytes > 0) {
+            memcpy(out + offset, sources[i].data, bytes);
+        }
+        offset = snapshot_align(offset + bytes);
+    }
+    audio_unlock();
+    
+    engine->snapshot_stats.bytes = size;
+    engine->snapshot_stats.capture_ms = snapshot_now_ms() - start;
+    return size;
+}
+
+// Section with the given id if present and of the expected element size
+static const SnapshotSection* snapshot_find(const SnapshotSection* const* found, uint32_t id,
+                                            size_t element_size) {
+    const SnapshotSection* section = found[id];
+    return section && section->element_size == element_size ? section : NULL;
+}
+
+// Copy a section into a fixed array, clamping to its capacity
+static int snapshot_copy_array(const uint8_t* in, const SnapshotSection* section,
+                               size_t element_size, int capacity, void* dst) {
+    if (!section || section->element_size != element_size) return -1;
+    
+    int count = section->count > (uint64_t)capacity ? capacity : (int)section->count;
+    memcpy(dst, in + section->offset, element_size * count);
+    return count;
+}
+
+// Row count shared by every column of a store: -1 if the store is absent,
+// -2 if only some of its columns are present or their counts disagree
+static int64_t snapshot_column_rows(const SnapshotSection* const* found,
+                                    const SnapshotColumn* columns, int column_count) {
+    int present = 0;
+    int64_t rows = -1;
+    for (int i = 0; i < column_count; i++) {
+        const SnapshotSection* section = snapshot_find(found, columns[i].id, columns[i].element_size);
+        if (!section) continue;
+        if (present++ > 0 && (int64_t)section->count != rows) return -2;
+        rows = (int64_t)section->count;
+    }
+    
+    if (present == 0) return -1;
+    if (present != column_count || rows > (int64_t)SNAPSHOT_MAX_ROWS) return -2;
+    return rows;
+}
+
+static void snapshot_apply_columns(const uint8_t* in, const SnapshotSection* const* found,
+                                   const SnapshotColumn* columns, int column_count, int rows) {
+    for (int i = 0; i < column_count; i++) {
+        const SnapshotSection* section = found[columns[i].id];
+        memcpy(*columns[i].data, in + section->offset, (size_t)columns[i].element_size * rows);
+    }
+}
+
+// Slot and row references must point inside the restored store
+static bool snapshot_sprite_links_valid(const uint8_t* in, const SnapshotSection* const* found,
+                                        int64_t rows, int64_t slots) {
+    const int* row_slot = (const int*)(in + found[SNAPSHOT_SECTION_SPRITE_ROW_SLOT]->offset);
+    const int* slot_row = (const int*)(in + found[SNAPSHOT_SECTION_SPRITE_SLOT_ROW]->offset);
+    
+    for (int64_t i = 0; i < rows; i++) {
+        if (row_slot[i] < 0 || row_slot[i] >= slots || slot_row[row_slot[i]] != i) return false;
+    }
+    for (int64_t i = 0; i < slots; i++) {
+        if (slot_row[i] < -1 || slot_row[i] >= rows) return false;
+    }
+    return true;
+}
+
+// Texture ids index fixed arrays; -1 draws untextured
+static bool snapshot_texture_valid(int texture_id) {
+    return texture_id >= -1 && texture_id < MAX_TEXTURES;
+}
+
+// The saved map is indexed straight by the renderer, physics and navigation
+static bool snapshot_world_valid(const WorldMap* world) {
+    int max_doors = (int)(sizeof(world->doors) / sizeof(world->doors[0]));
+    if (world->door_count < 0 || world->door_count > max_doors ||
+        world->active_door_count < 0 || world->active_door_count > world->door_count) {
+        return false;
+    }
+    for (int i = 0; i < world->door_count; i++) {
+        const Door* door = &world->doors[i];
+        if (door->x < 0 || door->x >= MAP_WIDTH || door->y < 0 || door->y >= MAP_HEIGHT ||
+            !snapshot_texture_valid(door->texture_id)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < world->active_door_count; i++) {
+        if (world->active_doors[i] < 0 || world->active_doors[i] >= world->door_count) return false;
+    }
+    for (int y = 0; y < MAP_HEIGHT; y++) {
+        for (int x = 0; x < MAP_WIDTH; x++) {
+            if (!snapshot_texture_valid(world->wall_textures[y][x]) ||
+                !snapshot_texture_valid(world->floor_textures[y][x]) ||
+                !snapshot_texture_valid(world->ceiling_textures[y][x])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool snapshot_audio_valid(const AudioSource* sources, uint64_t count) {
+    for (uint64_t i = 0; i < count; i++) {
+        if (sources[i].audio_buffer_id >= MAX_AUDIO_BUFFERS) return false;
+    }
+    return true;
+}
+
+static bool snapshot_textures_valid(const uint8_t* in, const SnapshotSection* section,
+                                    size_t stride, size_t offset, int64_t rows) {
+    for (int64_t i = 0; i < rows; i++) {
+        int texture_id;
+        memcpy(&texture_id, in + section->offset + i * stride + offset, sizeof(int));
+        if (!snapshot_texture_valid(texture_id)) return false;
+    }
+    return true;
+}
+
+// Saved scripts come straight off disk: counts must fit the fixed arrays
+// and every name and string must be terminated inside its field
+static bool snapshot_scripts_valid(const SnapshotScript* saved, uint64_t count) {
+    const int32_t max_properties = (int32_t)(sizeof(saved->properties) / sizeof(saved->properties[0]));
+    for (uint64_t s = 0; s < count; s++) {
+        const SnapshotScript* script = &saved[s];
+        if (script->property_count < 0 || script->property_count > max_properties ||
+            strnlen(script->name, sizeof(script->name)) == sizeof(script->name)) {
+            return false;
+        }
+        for (int32_t i = 0; i < script->property_count; i++) {
+            const SnapshotProperty* prop = &script->properties[i];
+            if (strnlen(prop->name, sizeof(prop->name)) == sizeof(prop->name)) return false;
+            if (prop->type == SCRIPT_TYPE_STRING &&
+                strnlen(prop->string, sizeof(prop->string)) == sizeof(prop->string)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool snapshot_reserve_rows(const SnapshotSection* section, void** array, int* capacity,
+                                  size_t element_size) {
+    if (!section) return true;
+    if (section->count > (uint64_t)SNAPSHOT_MAX_ROWS) return false;
+    return entity_reserve(array, capacity, (int)section->count, element_size);
+}
+
+bool engine_snapshot_load(Engine* engine, const void* buffer, size_t size) {
+    double start = snapshot_now_ms();
+    const uint8_t* in = (const uint8_t*)buffer;
+    const SnapshotHeader* header = (const SnapshotHeader*)in;
+    
+    if (size < sizeof(SnapshotHeader) ||
+        memcmp(header->magic, SNAPSHOT_MAGIC, 4) != 0 ||
+        header->version != SNAPSHOT_VERSION ||
+        header->size > size ||
+        header->section_count > SNAPSHOT_MAX_SECTIONS ||
+        sizeof(SnapshotHeader) + header->section_count * sizeof(SnapshotSection) > size) {
+        return false;
+    }
+    
+    const SnapshotSection* table = (const SnapshotSection*)(in + sizeof(SnapshotHeader));
+    const SnapshotSection* found[SNAPSHOT_SECTION_LIMIT] = {0};
+    
+    // Validate every section before touching the engine; sections from
+    // newer versions are skipped. Bounds are checked by division so a
+    // crafted count cannot wrap the size.
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        const SnapshotSection* section = &table[i];
+        if (section->offset > header->size || section->count > (uint64_t)INT_MAX ||
+            (section->element_size > 0 &&
+             section->count > (header->size - section->offset) / section->element_size)) {
+            return false;
+        }
+        if (section->id < SNAPSHOT_SECTION_LIMIT) found[section->id] = section;
+    }
+    
+    SnapshotColumn sprite_rows[SNAPSHOT_SPRITE_COLUMNS];
+    SnapshotColumn sprite_slots[SNAPSHOT_SLOT_COLUMNS];
+    SnapshotColumn particle_rows[SNAPSHOT_PARTICLE_COLUMNS];
+    snapshot_sprite_columns(&engine->sprites, sprite_rows, sprite_slots);
+    snapshot_particle_columns(&engine->particles, particle_rows);
+    
+    int64_t sprite_count = snapshot_column_rows(found, sprite_rows, SNAPSHOT_SPRITE_COLUMNS);
+    int64_t slot_count = snapshot_column_rows(found, sprite_slots, SNAPSHOT_SLOT_COLUMNS);
+    int64_t particle_count = snapshot_column_rows(found, particle_rows, SNAPSHOT_PARTICLE_COLUMNS);
+    if (sprite_count == -2 || slot_count == -2 || particle_count == -2 ||
+        (sprite_count < 0) != (slot_count < 0)) {
+        return false;
+    }
+    if (sprite_count >= 0 &&
+        (!snapshot_sprite_links_valid(in, found, sprite_count, slot_count) ||
+         !snapshot_textures_valid(in, found[SNAPSHOT_SECTION_SPRITE_VISUAL], sizeof(SpriteVisual),
+                                  offsetof(SpriteVisual, texture_id), sprite_count))) {
+        return false;
+    }
+    if (particle_count >= 0 &&
+        !snapshot_textures_valid(in, found[SNAPSHOT_SECTION_PARTICLE_TEXTURE], sizeof(int), 0,
+                                 particle_count)) {
+        return false;
+    }
+    
+    const SnapshotSection* world = snapshot_find(found, SNAPSHOT_SECTION_WORLD, sizeof(WorldMap));
+    if (world && world->count > 0 && !snapshot_world_valid((const WorldMap*)(in + world->offset))) {
+        return false;
+    }
+    
+    const SnapshotSection* lights = snapshot_find(found, SNAPSHOT_SECTION_LIGHTS, sizeof(Light));
+    const SnapshotSection* audio = snapshot_find(found, SNAPSHOT_SECTION_AUDIO, sizeof(AudioSource));
+    const SnapshotSection* scripts = snapshot_find(found, SNAPSHOT_SECTION_SCRIPTS, sizeof(SnapshotScript));
+    if ((scripts && !snapshot_scripts_valid((const SnapshotScript*)(in + scripts->offset),
+                                            scripts->count)) ||
+        (audio && !snapshot_audio_valid((const AudioSource*)(in + audio->offset), audio->count))) {
+        return false;
+    }
+    
+    // Grow every store up front so a failed allocation leaves the engine as it was
+    audio_lock();
+    bool reserved =
+        snapshot_reserve_rows(lights, (void**)&engine->lights, &engine->light_capacity, sizeof(Light)) &&
+        snapshot_reserve_rows(audio, (void**)&engine->audio_sources,
+                              &engine->audio_source_capacity, sizeof(AudioSource)) &&
+        snapshot_reserve_rows(scripts, (void**)&engine->scripts, &engine->script_capacity,
+                              sizeof(Script)) &&
+        (sprite_count < 0 || (sprite_store_reserve(&engine->sprites, (int)sprite_count) &&
+                              entity_index_reserve(&engine->sprites.index, (int)slot_count))) &&
+        (particle_count < 0 || particle_store_reserve(&engine->particles, (int)particle_count));
+    if (!reserved) {
+        audio_unlock();
+        return false;
+    }
+    
+    const SnapshotSection* core = snapshot_find(found, SNAPSHOT_SECTION_CORE, sizeof(SnapshotCore));
+    if (core && core->count == 1) {
+        snapshot_apply_core(engine, (const SnapshotCore*)(in + core->offset));
+    }
+    
+    int count;
+    snapshot_copy_array(in, world, sizeof(WorldMap), 1, &engine->world);
+    count = snapshot_copy_array(in, found[SNAPSHOT_SECTION_BODIES], sizeof(PhysicsBody),
+                                MAX_PHYSICS_BODIES, engine->physics_world.bodies);
+    if (count >= 0) engine->physics_world.body_count = count;
+    count = snapshot_copy_array(in, found[SNAPSHOT_SECTION_PROBES], sizeof(IrradianceProbe),
+                                IRRADIANCE_PROBES, engine->gi_probes);
+    if (count >= 0) engine->probe_count = count;
+    
+    if (lights) {
+        memcpy(engine->lights, in + lights->offset, sizeof(Light) * lights->count);
+        engine->light_count = (int)lights->count;
+    }
+    if (audio) {
+        memcpy(engine->audio_sources, in + audio->offset, sizeof(AudioSource) * audio->count);
+        engine->audio_source_count = (int)audio->count;
+    }
+    
+    if (scripts) {
+        const SnapshotScript* saved = (const SnapshotScript*)(in + scripts->offset);
+        int saved_count = (int)scripts->count;
+        
+        // Rows past the old count are fresh memory with no strings to release
+        for (int s = engine->script_count; s < saved_count; s++) {
+            memset(&engine->scripts[s], 0, sizeof(Script));
+        }
+        for (int s = 0; s < saved_count; s++) {
+            snapshot_apply_script(&engine->scripts[s], &saved[s]);
+        }
+        for (int s = saved_count; s < engine->script_count; s++) {
+            snapshot_apply_script(&engine->scripts[s], &(SnapshotScript){0});
+        }
+        engine->script_count = saved_count;
+    }
+    
+    if (sprite_count >= 0) {
+        SpriteStore* sprites = &engine->sprites;
+        snapshot_apply_columns(in, found, sprite_rows, SNAPSHOT_SPRITE_COLUMNS, (int)sprite_count);
+        snapshot_apply_columns(in, found, sprite_slots, SNAPSHOT_SLOT_COLUMNS, (int)slot_count);
+        sprites->count = (int)sprite_count;
+        sprites->index.slot_count = (int)slot_count;
+        entity_index_rebuild_free_list(&sprites->index);
+        for (int i = 0; i < sprites->count; i++) sprites->order[i] = i;
+    }
+    
+    if (particle_count >= 0) {
+        snapshot_apply_columns(in, found, particle_rows, SNAPSHOT_PARTICLE_COLUMNS,
+                               (int)particle_count);
+        engine->particles.count = (int)particle_count;
+    }
+    audio_unlock();
+    
+    entity_rebuild_active_lists(engine);
+    
+    // Caches outside the snapshot must rebuild against the restored map; the
+    // physics world was saved together with the map and is already in sync
+    map_invalidate_all(&engine->world);
+    engine->physics_world.map_revision = engine->world.revision;
+    
+    engine->snapshot_stats.bytes = header->size;
+    engine->snapshot_stats.restore_ms = snapshot_now_ms() - start;
+    return true;
+}
+
+bool engine_snapshot_write_file(Engine* engine, const char* filename) {
+    size_t size = engine_snapshot_size(engine);
+    void* buffer = memory_alloc(size, 0, MEMORY_TAG_SNAPSHOTS);
+    if (!buffer) return false;
+    
+    size_t written = engine_snapshot_save(engine, buffer, size);
+    bool ok = false;
+    
+    FILE* file = fopen(filename, "wb");
+    if (file) {
+        ok = written > 0 && fwrite(buffer, 1, written, file) == written;
+        fclose(file);
+    }
+    
+    memory_free(buffer);
+    return ok;
+}
+
+bool engine_snapshot_read_file(Engine* engine, const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return false;
+    
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    bool ok = false;
+    void* buffer = size > 0 ? memory_alloc((size_t)size, 0, MEMORY_TAG_SNAPSHOTS) : NULL;
+    if (buffer && fread(buffer, 1, (size_t)size, file) == (size_t)size) {
+        ok = engine_snapshot_load(engine, buffer, (size_t)size);
+    }
+    
+    memory_free(buffer);
+    fclose(file);
+    return ok;
+}
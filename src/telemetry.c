@@ -0,0 +1,538 @@
+#include "../include/engine.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define TELEMETRY_UNIX_SOCKETS 1
+#endif
+
+// Metrics registry. Writers never lock: every thread adds into a shard of
+// its own, found through a thread-local pointer, with relaxed atomic stores
+// a snapshot can read while the owner keeps writing. Shards of exited
+// threads are handed to the next thread that records, keeping their totals.
+//
+// Histograms are log-linear in the style of HdrHistogram: values below 32
+// get a bucket each, above that every power of two is split into 32 equal
+// buckets, so a bucket is never wider than about 3% of the values in it.
+
+typedef struct TelemetryThread {
+    struct TelemetryThread* next;
+    bool in_use;
+    uint64_t totals[TELEMETRY_MAX_METRICS];
+    uint64_t maxima[TELEMETRY_MAX_METRICS];
+    uint64_t* buckets[TELEMETRY_MAX_METRICS];   // Allocated on the first sample
+} TelemetryThread;
+
+#define TELEMETRY_SECONDS 1.0e-9    // Scale of times recorded in nanoseconds
+
+static TelemetryMetric telemetry_metrics[TELEMETRY_MAX_METRICS] = {
+    [TELEMETRY_FRAMES] = {"raycast_frames_total", "Frames presented",
+                          TELEMETRY_COUNTER, 1.0},
+    [TELEMETRY_FRAME_TIME] = {"raycast_frame_seconds", "Time between presented frames",
+                              TELEMETRY_HISTOGRAM, TELEMETRY_SECONDS},
+    [TELEMETRY_RENDER_TIME] = {"raycast_render_seconds", "Time to render a frame",
+                               TELEMETRY_HISTOGRAM, TELEMETRY_SECONDS},
+    [TELEMETRY_TICKS] = {"raycast_ticks_total", "Simulation ticks run",
+                         TELEMETRY_COUNTER, 1.0},
+    [TELEMETRY_SCRIPT_TIME] = {"raycast_script_seconds", "Time in scripts per simulation tick",
+                               TELEMETRY_HISTOGRAM, TELEMETRY_SECONDS},
+    [TELEMETRY_RAYS] = {"raycast_rays_total", "Wall rays cast",
+                        TELEMETRY_COUNTER, 1.0},
+    [TELEMETRY_DDA_STEPS] = {"raycast_dda_steps_total", "Map cells visited by wall rays",
+                             TELEMETRY_COUNTER, 1.0},
+    [TELEMETRY_LIGHTS_EVALUATED] = {"raycast_lights_evaluated_total",
+                                    "Light contributions evaluated by the lighting pass",
+                                    TELEMETRY_COUNTER, 1.0},
+    [TELEMETRY_PARTICLES] = {"raycast_particles", "Live particles",
+                             TELEMETRY_GAUGE, 1.0},
+    [TELEMETRY_SPRITES] = {"raycast_sprites", "Live sprites",
+                           TELEMETRY_GAUGE, 1.0},
+    [TELEMETRY_AUDIO_VOICES] = {"raycast_audio_voices", "Sources mixed by the last audio callback",
+                                TELEMETRY_GAUGE, 1.0},
+};
+
+static int telemetry_metric_count = TELEMETRY_BUILTIN_COUNT;
+static pthread_mutex_t telemetry_register_lock = PTHREAD_MUTEX_INITIALIZER;
+static double telemetry_gauges[TELEMETRY_MAX_METRICS];
+
+static TelemetryThread* telemetry_threads = NULL;
+static __thread TelemetryThread* telemetry_current = NULL;
+static pthread_key_t telemetry_thread_key;
+static pthread_once_t telemetry_thread_once = PTHREAD_ONCE_INIT;
+
+// Periodic export
+static const char* telemetry_target = NULL;
+static double telemetry_interval_ms = 0.0;
+static double telemetry_next_export_ms = 0.0;
+static bool telemetry_export_failing = false;
+
+// Registers a metric, or returns the one already registered under `name`.
+// `help` must outlive the registry; returns -1 when the registry is full.
+int telemetry_register(const char* name, const char* help, TelemetryKind kind, double scale) {
+    pthread_mutex_lock(&telemetry_register_lock);
+    
+    int count = telemetry_metric_count;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(telemetry_metrics[i].name, name) == 0) {
+            pthread_mutex_unlock(&telemetry_register_lock);
+            return i;
+        }
+    }
+    
+    if (count == TELEMETRY_MAX_METRICS || strlen(name) >= TELEMETRY_NAME_LENGTH) {
+        pthread_mutex_unlock(&telemetry_register_lock);
+        fprintf(stderr, "Cannot register telemetry metric %s\n", name);
+        return -1;
+    }
+    
+    TelemetryMetric* metric = &telemetry_metrics[count];
+    strcpy(metric->name, name);
+    metric->help = help;
+    metric->kind = kind;
+    metric->scale = scale;
+    __atomic_store_n(&telemetry_metric_count, count + 1, __ATOMIC_RELEASE);
+    
+    pthread_mutex_unlock(&telemetry_register_lock);
+    return count;
+}
+
+// --- Per-thread shards ---
+
+static void telemetry_thread_exit(void* arg) {
+    TelemetryThread* thread = (TelemetryThread*)arg;
+    __atomic_store_n(&thread->in_use, false, __ATOMIC_RELEASE);
+}
+
+static void telemetry_create_thread_key(void) {
+    pthread_key_create(&telemetry_thread_key, telemetry_thread_exit);
+}
+
+static TelemetryThread* telemetry_register_thread(void) {
+    pthread_once(&telemetry_thread_once, telemetry_create_thread_key);
+    
+    // Take over the shard of a thread that has exited
+    TelemetryThread* thread = __atomic_load_n(&telemetry_threads, __ATOMIC_ACQUIRE);
+    for (; thread; thread = thread->next) {
+        bool expected = false;
+        if (__atomic_compare_exchange_n(&thread->in_use, &expected, true,
+                                        false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    
+    if (!thread) {
+        thread = (TelemetryThread*)memory_alloc(sizeof(TelemetryThread), MEMORY_ZERO, MEMORY_TAG_DIAGNOSTICS);
+        if (!thread) return NULL;
+        thread->in_use = true;
+        
+        thread->next = __atomic_load_n(&telemetry_threads, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&telemetry_threads, &thread->next, thread,
+                                            true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+    
+    pthread_setspecific(telemetry_thread_key, thread);
+    telemetry_current = thread;
+    return thread;
+}
+
+static inline TelemetryThread* telemetry_thread(int metric) {
+    if (metric < 0 || metric >= TELEMETRY_MAX_METRICS) return NULL;
+    return telemetry_current ? telemetry_current : telemetry_register_thread();
+}
+
+static int telemetry_bucket(uint64_t value) {
+    const int sub_buckets = 1 << TELEMETRY_SUB_BUCKET_BITS;
+    if (value < (uint64_t)sub_buckets) return (int)value;
+    
+    int shift = 63 - __builtin_clzll(value) - TELEMETRY_SUB_BUCKET_BITS;
+    int index = (shift + 1) * sub_buckets + (int)((value >> shift) - sub_buckets);
+    return index < TELEMETRY_HISTOGRAM_BUCKETS ? index : TELEMETRY_HISTOGRAM_BUCKETS - 1;
+}
+
+// Smallest value that lands in bucket `index`
+static uint64_t telemetry_bucket_low(int index) {
+    const int sub_buckets = 1 << TELEMETRY_SUB_BUCKET_BITS;
+    if (index < sub_buckets) return (uint64_t)index;
+    
+    int shift = index / sub_buckets - 1;
+    return (uint64_t)(sub_buckets + index % sub_buckets) << shift;
+}
+
+void telemetry_add(int metric, uint64_t amount) {
+    TelemetryThread* thread = telemetry_thread(metric);
+    if (!thread) return;
+    __atomic_store_n(&thread->totals[metric], thread->totals[metric] + amount, __ATOMIC_RELAXED);
+}
+
+// Gauges hold the last value set, from whichever thread set it
+void telemetry_set(int metric, double value) {
+    if (metric < 0 || metric >= TELEMETRY_MAX_METRICS) return;
+    __atomic_store(&telemetry_gauges[metric], &value, __ATOMIC_RELAXED);
+}
+
+void telemetry_record(int metric, uint64_t value) {
+    TelemetryThread* thread = telemetry_thread(metric);
+    if (!thread) return;
+    
+    uint64_t* buckets = thread->buckets[metric];
+    if (!buckets) {
+        buckets = (uint64_t*)memory_alloc(TELEMETRY_HISTOGRAM_BUCKETS * sizeof(uint64_t), MEMORY_ZERO,
+                                         MEMORY_TAG_DIAGNOSTICS);
+        if (!buckets) return;
+        __atomic_store_n(&thread->buckets[metric], buckets, __ATOMIC_RELEASE);
+    }
+    
+    int bucket = telemetry_bucket(value);
+    __atomic_store_n(&buckets[bucket], buckets[bucket] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&thread->totals[metric], thread->totals[metric] + value, __ATOMIC_RELAXED);
+    if (value > thread->maxima[metric]) {
+        __atomic_store_n(&thread->maxima[metric], value, __ATOMIC_RELAXED);
+    }
+}
+
+// Render time and the time of every enabled pass. Called by the thread that
+// executed the graph; pass metrics are looked up once per pass name.
+void telemetry_record_frame_graph(const FrameGraph* graph) {
+    static const char* pass_names[FRAME_MAX_PASSES];
+    static int pass_metrics[FRAME_MAX_PASSES];
+    
+    telemetry_record(TELEMETRY_RENDER_TIME, (uint64_t)(graph->total_ms * 1.0e6));
+    
+    for (int i = 0; i < graph->pass_count; i++) {
+        const FramePass* pass = &graph->passes[i];
+        if (!pass->enabled) continue;
+        
+        if (pass_names[i] != pass->name) {
+            char name[TELEMETRY_NAME_LENGTH];
+            snprintf(name, sizeof(name), "raycast_pass_seconds{pass=\"%s\"}", pass->name);
+            pass_metrics[i] = telemetry_register(name, "Time to run a frame graph pass",
+                                                 TELEMETRY_HISTOGRAM, TELEMETRY_SECONDS);
+            pass_names[i] = pass->name;
+        }
+        telemetry_record(pass_metrics[i], (uint64_t)((pass->end_ms - pass->start_ms) * 1.0e6));
+    }
+}
+
+// --- Snapshots ---
+
+// Sums every shard into `snapshot`; free it with telemetry_snapshot_free
+bool telemetry_snapshot(TelemetrySnapshot* snapshot) {
+    int count = __atomic_load_n(&telemetry_metric_count, __ATOMIC_ACQUIRE);
+    
+    int histograms = 0;
+    for (int i = 0; i < count; i++) {
+        if (telemetry_metrics[i].kind == TELEMETRY_HISTOGRAM) histograms++;
+    }
+    
+    snapshot->storage = (uint64_t*)memory_alloc((size_t)histograms * TELEMETRY_HISTOGRAM_BUCKETS * sizeof(uint64_t),
+                                                MEMORY_ZERO, MEMORY_TAG_DIAGNOSTICS);
+    if (histograms > 0 && !snapshot->storage) {
+        fprintf(stderr, "Out of memory taking a telemetry snapshot\n");
+        snapshot->metric_count = 0;
+        return false;
+    }
+    
+    uint64_t* storage = snapshot->storage;
+    for (int i = 0; i < count; i++) {
+        TelemetryMetric* metric = &snapshot->metrics[i];
+        *metric = telemetry_metrics[i];
+        metric->total = 0;
+        metric->count = 0;
+        metric->max = 0;
+        metric->buckets = NULL;
+        __atomic_load(&telemetry_gauges[i], &metric->gauge, __ATOMIC_RELAXED);
+        if (metric->kind == TELEMETRY_HISTOGRAM) {
+            metric->buckets = storage;
+            storage += TELEMETRY_HISTOGRAM_BUCKETS;
+        }
+    }
+    snapshot->metric_count = count;
+    
+    TelemetryThread* thread = __atomic_load_n(&telemetry_threads, __ATOMIC_ACQUIRE);
+    for (; thread; thread = thread->next) {
+        for (int i = 0; i < count; i++) {
+            TelemetryMetric* metric = &snapshot->metrics[i];
+            metric->total += __atomic_load_n(&thread->totals[i], __ATOMIC_RELAXED);
+            
+            uint64_t max = __atomic_load_n(&thread->maxima[i], __ATOMIC_RELAXED);
+            if (max > metric->max) metric->max = max;
+            
+            const uint64_t* buckets = __atomic_load_n(&thread->buckets[i], __ATOMIC_ACQUIRE);
+            if (!buckets || !metric->buckets) continue;
+            for (int b = 0; b < TELEMETRY_HISTOGRAM_BUCKETS; b++) {
+                metric->buckets[b] += __atomic_load_n(&buckets[b], __ATOMIC_RELAXED);
+            }
+        }
+    }
+    
+    // Counted from the buckets, so percentiles always add up
+    for (int i = 0; i < count; i++) {
+        TelemetryMetric* metric = &snapshot->metrics[i];
+        if (!metric->buckets) continue;
+        for (int b = 0; b < TELEMETRY_HISTOGRAM_BUCKETS; b++) {
+            metric->count += metric->buckets[b];
+        }
+    }
+    
+    snapshot->taken_ms = profiler_now_ns() / 1.0e6;
+    return true;
+}
+
+// Turns `snapshot` into the activity since `earlier`, and taken_ms into the
+// interval between them. Gauges keep their later value; histogram maxima
+// become the bound of the highest bucket hit.
+void telemetry_snapshot_subtract(TelemetrySnapshot* snapshot, const TelemetrySnapshot* earlier) {
+    for (int i = 0; i < snapshot->metric_count && i < earlier->metric_count; i++) {
+        TelemetryMetric* metric = &snapshot->metrics[i];
+        const TelemetryMetric* before = &earlier->metrics[i];
+        if (metric->kind == TELEMETRY_GAUGE) continue;
+        
+        metric->total -= before->total;
+        if (!metric->buckets || !before->buckets) continue;
+        
+        metric->count -= before->count;
+        int highest = -1;
+        for (int b = 0; b < TELEMETRY_HISTOGRAM_BUCKETS; b++) {
+            metric->buckets[b] -= before->buckets[b];
+            if (metric->buckets[b] > 0) highest = b;
+        }
+        
+        if (highest < 0) {
+            metric->max = 0;
+        } else if (highest < TELEMETRY_HISTOGRAM_BUCKETS - 1) {
+            uint64_t bound = telemetry_bucket_low(highest + 1) - 1;
+            if (bound < metric->max) metric->max = bound;
+        }
+    }
+    snapshot->taken_ms -= earlier->taken_ms;
+}
+
+void telemetry_snapshot_free(TelemetrySnapshot* snapshot) {
+    memory_free(snapshot->storage);
+    snapshot->storage = NULL;
+    snapshot->metric_count = 0;
+}
+
+// Value below which `percentile` (0-100) of the samples fell, in export
+// units: the middle of its bucket, or the largest sample for the top rank
+double telemetry_percentile(const TelemetryMetric* metric, double percentile) {
+    if (!metric->buckets || metric->count == 0) return 0.0;
+    
+    uint64_t rank = (uint64_t)(percentile / 100.0 * metric->count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank >= metric->count) return metric->max * metric->scale;
+    
+    uint64_t seen = 0;
+    for (int b = 0; b < TELEMETRY_HISTOGRAM_BUCKETS; b++) {
+        seen += metric->buckets[b];
+        if (seen < rank) continue;
+        
+        uint64_t low = telemetry_bucket_low(b);
+        uint64_t value = low + (telemetry_bucket_low(b + 1) - low) / 2;
+        if (value > metric->max) value = metric->max;
+        return value * metric->scale;
+    }
+    return metric->max * metric->scale;
+}
+
+double telemetry_mean(const TelemetryMetric* metric) {
+    return metric->count ? (double)metric->total / metric->count * metric->scale : 0.0;
+}
+
+// --- Prometheus text format ---
+
+typedef struct {
+    char* buffer;
+    size_t capacity;
+    size_t length;
+} TelemetryText;
+
+static void telemetry_append(TelemetryText* text, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t room = text->length < text->capacity ? text->capacity - text->length : 0;
+    int written = vsnprintf(room ? text->buffer + text->length : NULL, room, format, args);
+    va_end(args);
+    if (written > 0) text->length += (size_t)written;
+}
+
+// Length of the metric name before any {labels}
+static int telemetry_base_length(const char* name) {
+    const char* labels = strchr(name, '{');
+    return labels ? (int)(labels - name) : (int)strlen(name);
+}
+
+// The label list without braces, or "" when the series has none
+static void telemetry_labels(const char* name, char* labels, size_t size) {
+    const char* open = strchr(name, '{');
+    labels[0] = '\0';
+    if (!open) return;
+    snprintf(labels, size, "%.*s", (int)strcspn(open + 1, "}"), open + 1);
+}
+
+static void telemetry_append_series(TelemetryText* text, const TelemetryMetric* metric) {
+    int base = telemetry_base_length(metric->name);
+    char labels[TELEMETRY_NAME_LENGTH];
+    telemetry_labels(metric->name, labels, sizeof(labels));
+    
+    if (metric->kind == TELEMETRY_COUNTER) {
+        telemetry_append(text, "%s %.9g\n", metric->name, metric->total * metric->scale);
+    } else if (metric->kind == TELEMETRY_GAUGE) {
+        telemetry_append(text, "%s %.9g\n", metric->name, metric->gauge * metric->scale);
+    } else {
+        // Histograms go out as summaries: the buckets stay in process
+        static const double quantiles[] = {50.0, 90.0, 99.0, 99.9, 100.0};
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+            telemetry_append(text, "%.*s{%s%squantile=\"%g\"} %.9g\n", base, metric->name,
+                             labels, labels[0] ? "," : "", quantiles[q] / 100.0,
+                             telemetry_percentile(metric, quantiles[q]));
+        }
+        const char* open = labels[0] ? "{" : "";
+        const char* close = labels[0] ? "}" : "";
+        telemetry_append(text, "%.*s_sum%s%s%s %.9g\n", base, metric->name, open, labels, close,
+                         metric->total * metric->scale);
+        telemetry_append(text, "%.*s_count%s%s%s %llu\n", base, metric->name, open, labels, close,
+                         (unsigned long long)metric->count);
+    }
+}
+
+// Writes the snapshot as Prometheus exposition text, series sharing a name
+// grouped under one HELP/TYPE. Returns the length the full text needs,
+// like snprintf; the output is cut at `capacity` bytes.
+size_t telemetry_format_prometheus(const TelemetrySnapshot* snapshot, char* buffer, size_t capacity) {
+    static const char* types[] = {"counter", "gauge", "summary"};
+    TelemetryText text = {buffer, capacity, 0};
+    if (capacity > 0) buffer[0] = '\0';
+    
+    bool written[TELEMETRY_MAX_METRICS] = {false};
+    for (int i = 0; i < snapshot->metric_count; i++) {
+        if (written[i]) continue;
+        const TelemetryMetric* metric = &snapshot->metrics[i];
+        int base = telemetry_base_length(metric->name);
+        
+        telemetry_append(&text, "# HELP %.*s %s\n", base, metric->name, metric->help);
+        telemetry_append(&text, "# TYPE %.*s %s\n", base, metric->name, types[metric->kind]);
+        for (int j = i; j < snapshot->metric_count; j++) {
+            const TelemetryMetric* other = &snapshot->metrics[j];
+            if (written[j] || telemetry_base_length(other->name) != base ||
+                strncmp(other->name, metric->name, base) != 0) {
+                continue;
+            }
+            telemetry_append_series(&text, other);
+            written[j] = true;
+        }
+    }
+    return text.length;
+}
+
+// --- Export ---
+
+#ifdef TELEMETRY_UNIX_SOCKETS
+// One connection per export; a reader that is not keeping up loses the
+// export instead of stalling the frame
+static bool telemetry_send_socket(const char* path, const char* text, size_t length) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) return false;
+    strcpy(address.sun_path, path);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    
+    bool sent = connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0;
+    while (sent && length > 0) {
+        int flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+        flags |= MSG_NOSIGNAL;
+#endif
+        ssize_t written = send(fd, text, length, flags);
+        if (written < 0 && errno == EINTR) continue;
+        sent = written > 0;
+        if (sent) {
+            text += written;
+            length -= (size_t)written;
+        }
+    }
+    close(fd);
+    return sent;
+}
+#endif
+
+// Written to a temporary file and renamed, so readers never see half
+static bool telemetry_write_file(const char* path, const char* text, size_t length) {
+    char temporary[1024];
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int)sizeof(temporary)) return false;
+    
+    FILE* file = fopen(temporary, "wb");
+    if (!file) return false;
+    bool written = fwrite(text, 1, length, file) == length;
+    written = fclose(file) == 0 && written;
+    
+    if (written) {
+        remove(path);   // rename does not replace on Windows
+        written = rename(temporary, path) == 0;
+    }
+    if (!written) remove(temporary);
+    return written;
+}
+
+// Exports a snapshot to `target`: a file path, or "unix:PATH" for a
+// listening Unix stream socket
+bool telemetry_export(const char* target) {
+    TelemetrySnapshot* snapshot = (TelemetrySnapshot*)memory_alloc(sizeof(TelemetrySnapshot), 0,
+                                                                    MEMORY_TAG_DIAGNOSTICS);
+    if (!snapshot || !telemetry_snapshot(snapshot)) {
+        memory_free(snapshot);
+        return false;
+    }
+    
+    size_t length = telemetry_format_prometheus(snapshot, NULL, 0);
+    char* text = (char*)memory_alloc(length + 1, 0, MEMORY_TAG_DIAGNOSTICS);
+    bool exported = false;
+    if (text) {
+        telemetry_format_prometheus(snapshot, text, length + 1);
+        if (strncmp(target, "unix:", 5) == 0) {
+#ifdef TELEMETRY_UNIX_SOCKETS
+            exported = telemetry_send_socket(target + 5, text, length);
+#endif
+        } else {
+            exported = telemetry_write_file(target, text, length);
+        }
+    }
+    
+    memory_free(text);
+    telemetry_snapshot_free(snapshot);
+    memory_free(snapshot);
+    return exported;
+}
+
+// Exports to `target` from telemetry_poll at most every `interval_ms`;
+// NULL stops exporting. The target string must stay valid.
+void telemetry_export_every(const char* target, double interval_ms) {
+    telemetry_target = target;
+    telemetry_interval_ms = interval_ms;
+    telemetry_next_export_ms = 0.0;
+    telemetry_export_failing = false;
+}
+
+// Called once per frame by the front end
+void telemetry_poll(double now_ms) {
+    if (!telemetry_target || now_ms < telemetry_next_export_ms) return;
+    telemetry_next_export_ms = now_ms + telemetry_interval_ms;
+    
+    // Report a failing target once, not every interval
+    bool exported = telemetry_export(telemetry_target);
+    if (!exported && !telemetry_export_failing) {
+        fprintf(stderr, "Cannot export telemetry to %s\n", telemetry_target);
+    }
+    telemetry_export_failing = !exported;
+}
@@ -3,6 +3,164 @@
 #include <stdlib.h>
 #include <string.h>
 
+// Persistent worker threads. A batch is published under the mutex by bumping
+// the generation; workers and the calling thread then claim chunks of items
+// with an atomic counter until the batch is exhausted.
+typedef struct {
+    pthread_t* threads;
+    int thread_count;
+    
+    pthread_mutex_t dispatch;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    uint64_t generation;
+    int busy_workers;
+    bool shutdown;
+    
+    ParallelTask task;
+    void* context;
+    int count;
+    int grain;
+    int next;
+} WorkerPool;
+
+// Set on pool threads and on a thread while it dispatches; nested
+// parallel_for calls from those threads run inline
+static __thread bool in_parallel_region = false;
+
+static void worker_pool_run_chunks(WorkerPool* workers) {
+    for (;;) {
+        int begin = __atomic_fetch_add(&workers->next, workers->grain, __ATOMIC_RELAXED);
+        if (begin >= workers->count) break;
+        
+        int end = begin + workers->grain;
+        if (end > workers->count) end = workers->count;
+        workers->task(workers->context, begin, end);
+    }
+}
+
+static void* worker_pool_main(void* arg) {
+    WorkerPool* workers = (WorkerPool*)arg;
+    uint64_t seen = 0;
+    in_parallel_region = true;
+    
+    for (;;) {
+        pthread_mutex_lock(&workers->mutex);
+        while (!workers->shutdown && workers->generation == seen) {
+            pthread_cond_wait(&workers->work_ready, &workers->mutex);
+        }
+        if (workers->shutdown) {
+            pthread_mutex_unlock(&workers->mutex);
+            break;
+        }
+        seen = workers->generation;
+        pthread_mutex_unlock(&workers->mutex);
+        
+        worker_pool_run_chunks(workers);
+        
+        pthread_mutex_lock(&workers->mutex);
+        if (--workers->busy_workers == 0) {
+            pthread_cond_signal(&workers->work_done);
+        }
+        pthread_mutex_unlock(&workers->mutex);
+    }
+    
+    return NULL;
+}
+
+// `thread_count` includes the dispatching thread, which works too
+static void worker_pool_start(ThreadPool* pool, int thread_count) {
+    WorkerPool* workers = (WorkerPool*)memory_alloc(sizeof(WorkerPool), MEMORY_ZERO, MEMORY_TAG_THREADS);
+    if (!workers) return;
+    
+    workers->threads = (pthread_t*)memory_alloc(thread_count * sizeof(pthread_t), MEMORY_ZERO,
+                                                 MEMORY_TAG_THREADS);
+    if (!workers->threads) {
+        memory_free(workers);
+        return;
+    }
+    
+    pthread_mutex_init(&workers->dispatch, NULL);
+    pthread_mutex_init(&workers->mutex, NULL);
+    pthread_cond_init(&workers->work_ready, NULL);
+    pthread_cond_init(&workers->work_done, NULL);
+    
+    for (int i = 0; i < thread_count - 1; i++) {
+        if (pthread_create(&workers->threads[i], NULL, worker_pool_main, workers) != 0) {
+            break;
+        }
+        workers->thread_count++;
+    }
+    
+    pool->workers = workers;
+    pool->worker_count = workers->thread_count;
+}
+
+static void worker_pool_stop(ThreadPool* pool) {
+    WorkerPool* workers = (WorkerPool*)pool->workers;
+    if (!workers) return;
+    
+    pthread_mutex_lock(&workers->mutex);
+    workers->shutdown = true;
+    pthread_cond_broadcast(&workers->work_ready);
+    pthread_mutex_unlock(&workers->mutex);
+    
+    for (int i = 0; i < workers->thread_count; i++) {
+        pthread_join(workers->threads[i], NULL);
+    }
+    
+    pthread_cond_destroy(&workers->work_done);
+    pthread_cond_destroy(&workers->work_ready);
+    pthread_mutex_destroy(&workers->mutex);
+    pthread_mutex_destroy(&workers->dispatch);
+    memory_free(workers->threads);
+    memory_free(workers);
+    
+    pool->workers = NULL;
+    pool->worker_count = 0;
+}
+
+// Split [0, count) into chunks of `grain` items and run them across the pool.
+// Returns when every item has been processed.
+void threading_parallel_for(ThreadPool* pool, int count, int grain, 
+                            ParallelTask task, void* context) {
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+    
+    WorkerPool* workers = (WorkerPool*)pool->workers;
+    if (!workers || !pool->use_threading || workers->thread_count == 0 ||
+        in_parallel_region || count <= grain) {
+        task(context, 0, count);
+        return;
+    }
+    
+    pthread_mutex_lock(&workers->dispatch);
+    in_parallel_region = true;
+    
+    pthread_mutex_lock(&workers->mutex);
+    workers->task = task;
+    workers->context = context;
+    workers->count = count;
+    workers->grain = grain;
+    workers->next = 0;
+    workers->busy_workers = workers->thread_count;
+    workers->generation++;
+    pthread_cond_broadcast(&workers->work_ready);
+    pthread_mutex_unlock(&workers->mutex);
+    
+    worker_pool_run_chunks(workers);
+    
+    pthread_mutex_lock(&workers->mutex);
+    while (workers->busy_workers > 0) {
+        pthread_cond_wait(&workers->work_done, &workers->mutex);
+    }
+    pthread_mutex_unlock(&workers->mutex);
+    
+    in_parallel_region = false;
+    pthread_mutex_unlock(&workers->dispatch);
+}
+
 void threading_init(ThreadPool* pool) {
     memset(pool, 0, sizeof(ThreadPool));
     pool->use_threading = true;
@@ -16,6 +174,24 @@ void threading_init(ThreadPool* pool) {
         pool->jobs[i].completed = false;
         pool->thread_handles[i] = NULL;
     }
+    
+    worker_pool_start(pool, MAX_THREADS);
+}
+
+// Restart the workers so that `thread_count` threads, the caller included,
+// share parallel work. Call between batches, never from inside one.
+void threading_set_thread_count(ThreadPool* pool, int thread_count) {
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > THREADING_MAX_THREADS) thread_count = THREADING_MAX_THREADS;
+    
+    worker_pool_stop(pool);
+    worker_pool_start(pool, thread_count);
+}
+
+// Grain giving each thread about four chunks of `count` items
+int threading_grain(const ThreadPool* pool, int count) {
+    int grain = count / ((pool->worker_count + 1) * 4);
+    return grain > 0 ? grain : 1;
 }
 
 void threading_cleanup(ThreadPool* pool) {
@@ -27,6 +203,8 @@ void threading_cleanup(ThreadPool* pool) {
             pool->thread_handles[i] = NULL;
         }
     }
+    
+    worker_pool_stop(pool);
 }
 
 void* threading_render_job(void* arg) {
@@ -47,6 +225,18 @@ void* threading_render_job(void* arg) {
     return NULL;
 }
 
+static void threading_render_columns(void* context, int begin, int end) {
+    Engine* engine = (Engine*)context;
+    
+    for (int x = begin; x < end; x++) {
+        Ray ray = {0};
+        raycast_dda(engine, x, &ray);
+        if (ray.distance < MAX_RENDER_DISTANCE) {
+            render_textured_wall(engine, x, &ray);
+        }
+    }
+}
+
 void threading_render_parallel(Engine* engine) {
     if (!engine->use_multithreading || !engine->thread_pool.use_threading) {
         // Fallback to single-threaded
@@ -60,28 +250,8 @@ void threading_render_parallel(Engine* engine) {
         return;
     }
     
-    ThreadPool* pool = &engine->thread_pool;
-    int columns_per_thread = SCREEN_WIDTH / pool->job_count;
-    
-    // Create jobs
-    for (int i = 0; i < pool->job_count; i++) {
-        pool->jobs[i].start_column = i * columns_per_thread;
-        pool->jobs[i].end_column = (i == pool->job_count - 1) ? 
-                                    SCREEN_WIDTH : 
-                                    (i + 1) * columns_per_thread;
-        pool->jobs[i].engine = engine;
-        pool->jobs[i].completed = false;
-        
-        // Create thread
-        pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
-        pthread_create(thread, NULL, threading_render_job, &pool->jobs[i]);
-        pool->thread_handles[i] = thread;
-    }
-    
-    // Wait for all threads
-    for (int i = 0; i < pool->job_count; i++) {
-        pthread_join(*(pthread_t*)pool->thread_handles[i], NULL);
-        free(pool->thread_handles[i]);
-        pool->thread_handles[i] = NULL;
-    }
+    // Columns are independent; hand them to the persistent workers in strips
+    threading_parallel_for(&engine->thread_pool, SCREEN_WIDTH,
+                           threading_grain(&engine->thread_pool, SCREEN_WIDTH),
+                           threading_render_columns, engine);
 }
@@ -0,0 +1,502 @@
+#if defined(__linux__)
+#define _GNU_SOURCE     // sched_setaffinity
+#endif
+
+#include "../include/engine.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+// Kernel microbenchmarks. Each hot path runs in isolation on one pinned
+// thread against a fixed-seed fixture: the demo scene, a camera placed in
+// the most open part of the map and one rendered frame for the post passes
+// to chew on. Every benchmark is warmed up and then timed over several
+// repetitions; results are reported per pixel, column or item with the
+// spread between repetitions, so a regression in one kernel stands out
+// from run-to-run noise. Build with `make bench`.
+#define BENCH_SEED 1
+#define BENCH_SAMPLES (1 << 18)
+#define BENCH_PARTICLES 4096
+#define BENCH_AUDIO_SAMPLES 4096
+#define BENCH_NOISE_CALLS (1 << 16)
+
+typedef struct {
+    Engine* engine;
+    uint32_t* frame;            // Colour buffer of the fixture frame
+    Ray* rays;                  // Wall hits of every column
+    float* uv;                  // Texture coordinates for the samplers
+    uint32_t* page_test;        // Framebuffer-sized blocks for the TLB test
+    uint32_t* huge_page_test;
+    volatile float sink;        // Keeps results alive
+} BenchFixture;
+
+typedef struct {
+    const char* name;
+    const char* unit;
+    int items;                  // Units of work per run
+    void (*prepare)(BenchFixture* fixture);     // Untimed, before every run
+    void (*run)(BenchFixture* fixture);
+} Benchmark;
+
+typedef struct {
+    int repetitions;
+    int warmup;
+    int cpu;                    // -1 leaves the thread unpinned
+    const char* filter;
+    const char* csv_file;
+} BenchOptions;
+
+// --- Fixture ---
+
+// The empty cell with the most empty cells around it, so casts travel far
+static void bench_place_camera(Engine* engine) {
+    int best_x = MAP_WIDTH / 2;
+    int best_y = MAP_HEIGHT / 2;
+    int best_open = -1;
+    
+    for (int y = 2; y < MAP_HEIGHT - 2; y++) {
+        for (int x = 2; x < MAP_WIDTH - 2; x++) {
+            if (map_get_tile(&engine->world, x, y) != 0) continue;
+            
+            int open = 0;
+            for (int dy = -2; dy <= 2; dy++) {
+                for (int dx = -2; dx <= 2; dx++) {
+                    if (map_get_tile(&engine->world, x + dx, y + dy) == 0) open++;
+                }
+            }
+            if (open > best_open) {
+                best_open = open;
+                best_x = x;
+                best_y = y;
+            }
+        }
+    }
+    
+    Camera* camera = &engine->camera;
+    camera->position = (Vec2){best_x + 0.5f, best_y + 0.5f};
+    camera->physics.position = camera->position;
+    engine->prev_camera = *camera;
+}
+
+// Post passes work in place and take scratch from the frame arena, so each
+// run starts from the fixture frame and an empty arena
+static void bench_restore_frame(BenchFixture* fixture) {
+    frame_arena_begin(&fixture->engine->frame_arena);
+    memcpy(fixture->engine->buffers.color_buffer, fixture->frame,
+           SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+}
+
+static bool bench_fixture_init(BenchFixture* fixture) {
+    static Engine engine;
+    engine_init_seeded(&engine, BENCH_SEED);
+    scene_load_demo(&engine);
+    bench_place_camera(&engine);
+    compute_init(&engine.compute_ctx, SCREEN_WIDTH * SCREEN_HEIGHT);
+    gi_init_probes(&engine);
+    fixture->engine = &engine;
+    
+    // Strengths that make every post pass do real work when called
+    engine.post_fx.motion_blur_strength = 0.5f;
+    engine.post_fx.aberration_strength = 1.0f;
+    engine.post_fx.vignette_intensity = 0.5f;
+    
+    engine_update(&engine, engine.fixed_dt);
+    bench_place_camera(&engine);
+    engine_render(&engine);
+    
+    size_t frame_bytes = SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t);
+    fixture->frame = (uint32_t*)memory_alloc(frame_bytes, 0, MEMORY_TAG_DIAGNOSTICS);
+    fixture->rays = (Ray*)memory_alloc(SCREEN_WIDTH * sizeof(Ray), 0, MEMORY_TAG_DIAGNOSTICS);
+    fixture->uv = (float*)memory_alloc(BENCH_SAMPLES * 2 * sizeof(float), 0, MEMORY_TAG_DIAGNOSTICS);
+    fixture->page_test = (uint32_t*)memory_alloc(frame_bytes, 0, MEMORY_TAG_DIAGNOSTICS);
+    fixture->huge_page_test = (uint32_t*)memory_alloc(frame_bytes, MEMORY_HUGE_PAGES,
+                                                       MEMORY_TAG_DIAGNOSTICS);
+    if (!fixture->frame || !fixture->rays || !fixture->uv ||
+        !fixture->page_test || !fixture->huge_page_test) {
+        fprintf(stderr, "Cannot allocate benchmark fixture\n");
+        return false;
+    }
+    
+    memcpy(fixture->frame, engine.buffers.color_buffer, frame_bytes);
+    memset(fixture->page_test, 0, frame_bytes);
+    memset(fixture->huge_page_test, 0, frame_bytes);
+    
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        memset(&fixture->rays[x], 0, sizeof(Ray));
+        raycast_dda(&engine, x, &fixture->rays[x]);
+    }
+    
+    uint32_t state = 0x2545F491u;
+    for (int i = 0; i < BENCH_SAMPLES * 2; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        fixture->uv[i] = (state >> 8) * (1.0f / 16777216.0f);
+    }
+    
+    AudioSource* source = audio_source_add(&engine);
+    if (source) {
+        source->audio_buffer_id = audio_load_sound("bench");
+        source->volume = 0.8f;
+        source->pitch = 1.0f;
+        source->max_distance = 20.0f;
+        source->rolloff_factor = 0.5f;
+        source->positional = true;
+        source->looping = true;
+    }
+    return true;
+}
+
+static void bench_fixture_cleanup(BenchFixture* fixture) {
+    memory_free(fixture->frame);
+    memory_free(fixture->rays);
+    memory_free(fixture->uv);
+    memory_free(fixture->page_test);
+    memory_free(fixture->huge_page_test);
+    compute_cleanup(&fixture->engine->compute_ctx);
+    engine_cleanup(fixture->engine);
+}
+
+// --- Kernels ---
+
+static void bench_raycast_column(BenchFixture* fixture) {
+    float sum = 0.0f;
+    for (int i = 0; i < SCREEN_WIDTH; i++) {
+        Ray ray = {0};
+        raycast_dda(fixture->engine, SCREEN_WIDTH / 2, &ray);
+        sum += ray.distance;
+    }
+    fixture->sink = sum;
+}
+
+static void bench_raycast_sweep(BenchFixture* fixture) {
+    float sum = 0.0f;
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        Ray ray = {0};
+        raycast_dda(fixture->engine, x, &ray);
+        sum += ray.distance;
+    }
+    fixture->sink = sum;
+}
+
+static void bench_floor_ceiling(BenchFixture* fixture) {
+    for (int y = SCREEN_HEIGHT / 2; y < SCREEN_HEIGHT; y++) {
+        raycast_floor_ceiling(fixture->engine, y, 0);
+    }
+}
+
+static void bench_textured_wall(BenchFixture* fixture) {
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        if (fixture->rays[x].distance < MAX_RENDER_DISTANCE) {
+            render_textured_wall(fixture->engine, x, &fixture->rays[x]);
+        }
+    }
+}
+
+static void bench_texture_sample(BenchFixture* fixture) {
+    Texture* texture = &fixture->engine->textures[0];
+    uint32_t sum = 0;
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        Color c = texture_sample(texture, fixture->uv[i * 2], fixture->uv[i * 2 + 1]);
+        sum += c.r + c.g + c.b;
+    }
+    fixture->sink = (float)sum;
+}
+
+static void bench_texture_sample_bilinear(BenchFixture* fixture) {
+    Texture* texture = &fixture->engine->textures[0];
+    uint32_t sum = 0;
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        Color c = texture_sample_bilinear(texture, fixture->uv[i * 2], fixture->uv[i * 2 + 1]);
+        sum += c.r + c.g + c.b;
+    }
+    fixture->sink = (float)sum;
+}
+
+static RenderTarget bench_color_target(BenchFixture* fixture) {
+    return (RenderTarget){fixture->engine->buffers.color_buffer, SCREEN_WIDTH * sizeof(uint32_t)};
+}
+
+static void bench_lighting(BenchFixture* fixture) { apply_lighting(fixture->engine); }
+static void bench_shadows(BenchFixture* fixture) { apply_shadows(fixture->engine); }
+static void bench_fog(BenchFixture* fixture) { apply_fog(fixture->engine); }
+static void bench_bloom(BenchFixture* fixture) { post_process_bloom(fixture->engine); }
+static void bench_prepare_motion_blur(BenchFixture* fixture) {
+    // The pass only runs while the camera moves
+    bench_restore_frame(fixture);
+    fixture->engine->camera.physics.velocity = (Vec2){2.0f, 1.0f};
+}
+
+static void bench_motion_blur(BenchFixture* fixture) {
+    post_process_motion_blur(fixture->engine);
+    fixture->engine->camera.physics.velocity = (Vec2){0.0f, 0.0f};
+}
+
+static void bench_chromatic_aberration(BenchFixture* fixture) {
+    post_process_chromatic_aberration(fixture->engine);
+}
+
+static void bench_tone_mapping(BenchFixture* fixture) {
+    post_process_tone_mapping(fixture->engine, bench_color_target(fixture));
+}
+
+static void bench_vignette(BenchFixture* fixture) {
+    post_process_vignette(fixture->engine, bench_color_target(fixture));
+}
+
+static void bench_fxaa(BenchFixture* fixture) {
+    post_process_fxaa(fixture->engine, bench_color_target(fixture));
+}
+
+static void bench_compute_post(BenchFixture* fixture) {
+    ComputeContext* ctx = &fixture->engine->compute_ctx;
+    compute_dispatch_post_process(ctx, fixture->frame, ctx->output_buffer, SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+static void bench_compute_post_simd(BenchFixture* fixture) {
+    ComputeContext* ctx = &fixture->engine->compute_ctx;
+    compute_dispatch_post_process_simd(ctx, ctx->input_buffer, ctx->output_buffer,
+                                       SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+static void bench_prepare_compute_simd(BenchFixture* fixture) {
+    // The SIMD kernel wants aligned input
+    ComputeContext* ctx = &fixture->engine->compute_ctx;
+    memcpy(ctx->input_buffer, fixture->frame, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+}
+
+static void bench_compute_lighting(BenchFixture* fixture) {
+    compute_dispatch_lighting(&fixture->engine->compute_ctx, fixture->engine);
+}
+
+static void bench_prepare_particles(BenchFixture* fixture) {
+    Engine* engine = fixture->engine;
+    engine->particles.count = 0;
+    engine->rng_state = BENCH_SEED;
+    
+    for (int i = 0; i < BENCH_PARTICLES; i++) {
+        Vec3 position = {engine->camera.position.x, engine->camera.position.y, 0.5f};
+        Vec3 velocity = {(i % 17) * 0.1f - 0.8f, (i % 13) * 0.1f - 0.6f, 1.0f + (i % 7) * 0.2f};
+        particle_emit(engine, position, velocity, (ColorF){1.0f, 0.6f, 0.2f, 1.0f}, 5.0f);
+    }
+}
+
+static void bench_particle_update(BenchFixture* fixture) {
+    particle_update(fixture->engine, fixture->engine->fixed_dt);
+}
+
+static void bench_prepare_probes(BenchFixture* fixture) {
+    Engine* engine = fixture->engine;
+    for (int i = 0; i < engine->probe_count; i++) engine->gi_probes[i].needs_update = true;
+}
+
+static void bench_gi_probes(BenchFixture* fixture) {
+    Engine* engine = fixture->engine;
+    for (int i = 0; i < engine->probe_count; i++) gi_update_probe(engine, &engine->gi_probes[i]);
+}
+
+static void bench_prepare_audio(BenchFixture* fixture) {
+    Engine* engine = fixture->engine;
+    for (int i = 0; i < engine->audio_source_count; i++) {
+        engine->audio_sources[i].playing = true;
+        engine->audio_sources[i].playback_position = 0.0f;
+    }
+}
+
+static void bench_audio_mix(BenchFixture* fixture) {
+    static float output[BENCH_AUDIO_SAMPLES];
+    audio_mix(fixture->engine, output, BENCH_AUDIO_SAMPLES);
+    fixture->sink = output[BENCH_AUDIO_SAMPLES / 2];
+}
+
+static void bench_perlin_2d(BenchFixture* fixture) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_NOISE_CALLS; i++) sum += perlin_noise_2d(fixture->uv[i] * 64.0f, i * 0.01f);
+    fixture->sink = sum;
+}
+
+static void bench_perlin_3d(BenchFixture* fixture) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_NOISE_CALLS; i++) {
+        sum += perlin_noise_3d(fixture->uv[i] * 64.0f, i * 0.01f, fixture->uv[i + 1] * 8.0f);
+    }
+    fixture->sink = sum;
+}
+
+static void bench_simplex_2d(BenchFixture* fixture) {
+    float sum = 0.0f;
+    for (int i = 0; i < BENCH_NOISE_CALLS; i++) sum += simplex_noise_2d(fixture->uv[i] * 64.0f, i * 0.01f);
+    fixture->sink = sum;
+}
+
+// Column-order walk over a framebuffer, as the wall and floor passes write
+// it: every pixel of a column sits on a different 4 KB page, so this is
+// bound by TLB reach. Compare the ordinary and the huge-page block.
+static void bench_column_walk(uint32_t* pixels) {
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) pixels[y * SCREEN_WIDTH + x] += x ^ y;
+    }
+}
+
+static void bench_column_walk_pages(BenchFixture* fixture) { bench_column_walk(fixture->page_test); }
+static void bench_column_walk_huge(BenchFixture* fixture) { bench_column_walk(fixture->huge_page_test); }
+
+static const Benchmark benchmarks[] = {
+    {"raycast_dda/column", "column", SCREEN_WIDTH, NULL, bench_raycast_column},
+    {"raycast_dda/sweep", "column", SCREEN_WIDTH, NULL, bench_raycast_sweep},
+    {"raycast_floor_ceiling", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT / 2, NULL, bench_floor_ceiling},
+    {"render_textured_wall", "column", SCREEN_WIDTH, NULL, bench_textured_wall},
+    {"texture_sample", "sample", BENCH_SAMPLES, NULL, bench_texture_sample},
+    {"texture_sample_bilinear", "sample", BENCH_SAMPLES, NULL, bench_texture_sample_bilinear},
+    {"apply_lighting", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_restore_frame, bench_lighting},
+    {"apply_shadows", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_restore_frame, bench_shadows},
+    {"apply_fog", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_restore_frame, bench_fog},
+    {"post_process_bloom", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_restore_frame, bench_bloom},
+    {"post_process_motion_blur", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_prepare_motion_blur,
+     bench_motion_blur},
+    {"post_process_chromatic_aberration", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_restore_frame,
+     bench_chromatic_aberration},
+    {"post_process_tone_mapping", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_restore_frame,
+     bench_tone_mapping},
+    {"post_process_vignette", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_restore_frame, bench_vignette},
+    {"post_process_fxaa", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_restore_frame, bench_fxaa},
+    {"compute_post_process", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, NULL, bench_compute_post},
+    {"compute_post_process_simd", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, bench_prepare_compute_simd,
+     bench_compute_post_simd},
+    {"compute_lighting", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, NULL, bench_compute_lighting},
+    {"particle_update", "particle", BENCH_PARTICLES, bench_prepare_particles, bench_particle_update},
+    {"gi_update_probe", "probe", IRRADIANCE_PROBES, bench_prepare_probes, bench_gi_probes},
+    {"audio_mix", "sample", BENCH_AUDIO_SAMPLES, bench_prepare_audio, bench_audio_mix},
+    {"perlin_noise_2d", "call", BENCH_NOISE_CALLS, NULL, bench_perlin_2d},
+    {"perlin_noise_3d", "call", BENCH_NOISE_CALLS, NULL, bench_perlin_3d},
+    {"simplex_noise_2d", "call", BENCH_NOISE_CALLS, NULL, bench_simplex_2d},
+    {"column_walk/4k_pages", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, NULL, bench_column_walk_pages},
+    {"column_walk/huge_pages", "pixel", SCREEN_WIDTH * SCREEN_HEIGHT, NULL, bench_column_walk_huge},
+};
+
+// --- Runner ---
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static bool bench_pin(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        fprintf(stderr, "Cannot pin to CPU %d\n", cpu);
+        return false;
+    }
+    return true;
+#else
+    fprintf(stderr, "CPU pinning is not supported on this platform\n");
+    return false;
+#endif
+}
+
+static void bench_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--filter TEXT] [--reps N] [--warmup N] [--cpu N | --no-pin] [--csv FILE]\n",
+            program);
+}
+
+static bool bench_parse(BenchOptions* options, int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--filter") == 0 && has_value) {
+            options->filter = argv[++i];
+        } else if (strcmp(argv[i], "--reps") == 0 && has_value) {
+            options->repetitions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+            options->warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cpu") == 0 && has_value) {
+            options->cpu = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-pin") == 0) {
+            options->cpu = -1;
+        } else if (strcmp(argv[i], "--csv") == 0 && has_value) {
+            options->csv_file = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return options->repetitions > 1 && options->warmup >= 0;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options = {15, 3, 0, NULL, NULL};
+    if (!bench_parse(&options, argc, argv)) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+    if (options.cpu >= 0 && !bench_pin(options.cpu)) return 1;
+    
+    BenchFixture fixture = {0};
+    if (!bench_fixture_init(&fixture)) return 1;
+    
+    FILE* csv = NULL;
+    if (options.csv_file) {
+        csv = fopen(options.csv_file, "w");
+        if (!csv) {
+            fprintf(stderr, "Cannot write %s\n", options.csv_file);
+        } else {
+            fprintf(csv, "kernel,unit,items,median_ns,mean_ns,stddev_ns,min_ns,cv_percent\n");
+        }
+    }
+    
+    printf("Kernel benchmarks: seed %d, %d repetitions after %d warm-up, %s\n", BENCH_SEED,
+           options.repetitions, options.warmup, options.cpu >= 0 ? "pinned" : "unpinned");
+    printf("%-34s %10s %10s %10s %10s %7s\n", "kernel", "median", "mean", "stddev", "min", "cv");
+    
+    double* samples = (double*)malloc(options.repetitions * sizeof(double));
+    int count = (int)(sizeof(benchmarks) / sizeof(benchmarks[0]));
+    
+    for (int b = 0; b < count; b++) {
+        const Benchmark* bench = &benchmarks[b];
+        if (options.filter && !strstr(bench->name, options.filter)) continue;
+        
+        for (int i = 0; i < options.warmup; i++) {
+            if (bench->prepare) bench->prepare(&fixture);
+            bench->run(&fixture);
+        }
+        
+        double mean = 0.0;
+        for (int i = 0; i < options.repetitions; i++) {
+            if (bench->prepare) bench->prepare(&fixture);
+            uint64_t start = profiler_now_ns();
+            bench->run(&fixture);
+            samples[i] = (double)(profiler_now_ns() - start) / bench->items;
+            mean += samples[i];
+        }
+        mean /= options.repetitions;
+        
+        double variance = 0.0;
+        for (int i = 0; i < options.repetitions; i++) {
+            variance += (samples[i] - mean) * (samples[i] - mean);
+        }
+        double stddev = sqrt(variance / (options.repetitions - 1));
+        
+        qsort(samples, options.repetitions, sizeof(double), compare_double);
+        double median = samples[options.repetitions / 2];
+        double cv = mean > 0.0 ? stddev / mean * 100.0 : 0.0;
+        
+        printf("%-34s %7.2f ns %7.2f ns %7.2f ns %7.2f ns %6.1f%%  /%s\n", bench->name, median, mean,
+               stddev, samples[0], cv, bench->unit);
+        if (csv) {
+            fprintf(csv, "%s,%s,%d,%.4f,%.4f,%.4f,%.4f,%.2f\n", bench->name, bench->unit, bench->items,
+                    median, mean, stddev, samples[0], cv);
+        }
+    }
+    
+    free(samples);
+    if (csv) fclose(csv);
+    bench_fixture_cleanup(&fixture);
+    return 0;
+}
@@ -0,0 +1,553 @@
+#include "../include/engine.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define gate_mkdir(path) _mkdir(path)
+#else
+#define gate_mkdir(path) mkdir(path, 0755)
+#endif
+
+// Golden-image and performance gate. Renders a few fixed-seed scenes with
+// one thread and with the worker pool, and captures the colour buffer after
+// every pass that writes it. The threaded frames must match the one-thread
+// frames bit for bit. The one-thread frames are compared with stored golden
+// frames under per-pass tolerances (largest channel difference and PSNR).
+// Pass times, the median of several renders, are checked against stored
+// budgets with an allowance for the noise seen in this run. Goldens and
+// budgets live in <golden>/<W>x<H>/ and are written by --update; they
+// depend on the compiler and flags, so regenerate them on the reference
+// machine when those change. Build with `make gate`.
+#define GATE_MAX_SCENES 8
+#define GATE_MAX_REPS 64
+#define GATE_MAX_ENTRIES (GATE_MAX_SCENES * FRAME_MAX_PASSES)
+#define GATE_NOISE_FLOOR_MS 0.05    // Timer and scheduling jitter on tiny passes
+#define GATE_NOISE_MADS 3.0         // Allowed excess in median absolute deviations
+#define GATE_PSNR_IDENTICAL 999.0   // No infinities under -ffast-math
+
+typedef struct {
+    const char* name;
+    uint32_t seed;
+    int ticks;                  // Simulated before the captured frame
+    uint32_t buttons;           // Held during those ticks
+    void (*setup)(Engine* engine);
+} GateScene;
+
+// One line of the manifest: tolerances and budget of a pass in a scene
+typedef struct {
+    char scene[32];
+    char pass[32];
+    int max_diff;               // Largest allowed channel difference
+    double min_psnr;            // dB; 0 disables
+    double budget_ms;
+} GateEntry;
+
+typedef struct {
+    GateEntry entries[GATE_MAX_ENTRIES];
+    int count;
+} GateManifest;
+
+// Colour buffer after each pass of one frame; NULL where a pass did not
+// write colour or did not run
+typedef struct {
+    uint32_t* images[FRAME_MAX_PASSES];
+    const char* names[FRAME_MAX_PASSES];
+    int pass_count;
+} GateCapture;
+
+typedef struct {
+    const char* golden_dir;
+    const char* scene_filter;
+    bool update;
+    bool timing;
+    int threads;
+    int reps;
+    double slack;               // Relative headroom over the budget
+} GateOptions;
+
+// --- Scenes ---
+
+// The empty cell with the most empty cells around it
+static Vec2 gate_open_cell(Engine* engine) {
+    int best_x = MAP_WIDTH / 2;
+    int best_y = MAP_HEIGHT / 2;
+    int best_open = -1;
+    
+    for (int y = 2; y < MAP_HEIGHT - 2; y++) {
+        for (int x = 2; x < MAP_WIDTH - 2; x++) {
+            if (map_get_tile(&engine->world, x, y) != 0) continue;
+            
+            int open = 0;
+            for (int dy = -2; dy <= 2; dy++) {
+                for (int dx = -2; dx <= 2; dx++) {
+                    if (map_get_tile(&engine->world, x + dx, y + dy) == 0) open++;
+                }
+            }
+            if (open > best_open) {
+                best_open = open;
+                best_x = x;
+                best_y = y;
+            }
+        }
+    }
+    return (Vec2){best_x + 0.5f, best_y + 0.5f};
+}
+
+static void gate_place_camera(Engine* engine) {
+    Camera* camera = &engine->camera;
+    camera->position = gate_open_cell(engine);
+    camera->physics.position = camera->position;
+    engine->prev_camera = *camera;
+}
+
+static void gate_setup_demo(Engine* engine) {
+    gate_place_camera(engine);
+}
+
+static void gate_setup_post_fx(Engine* engine) {
+    gate_place_camera(engine);
+    PostProcessing* fx = &engine->post_fx;
+    fx->bloom_enabled = true;
+    fx->motion_blur_enabled = true;
+    fx->motion_blur_strength = 0.5f;
+    fx->chromatic_aberration = true;
+    fx->aberration_strength = 1.0f;
+    fx->vignette = true;
+    fx->fxaa_enabled = true;
+}
+
+static void gate_setup_crowd(Engine* engine) {
+    gate_place_camera(engine);
+    Vec2 center = engine->camera.position;
+    
+    // Fixed rings around the camera; entries in walls are simply occluded
+    for (int i = 0; i < 12; i++) {
+        float angle = i * 0.5235988f;
+        Light light = {
+            {center.x + cosf(angle) * 4.0f, center.y + sinf(angle) * 4.0f, 1.5f},
+            {0.3f + (i % 3) * 0.3f, 0.6f, 1.0f - (i % 3) * 0.3f, 1.0f},
+            2.0f,
+            6.0f,
+            false,
+            0.0f
+        };
+        light_add(engine, &light);
+    }
+    
+    for (int i = 0; i < 48; i++) {
+        float angle = i * 0.1308997f;
+        float radius = 2.5f + (i % 4);
+        Sprite sprite = {0};
+        sprite.position = (Vec2){center.x + cosf(angle) * radius, center.y + sinf(angle) * radius};
+        sprite.texture_id = i % engine->texture_count;
+        sprite.scale = (Vec2){0.5f, 0.5f};
+        sprite.billboarding = true;
+        sprite.tint = (ColorF){1.0f, 1.0f, 1.0f, 1.0f};
+        sprite_create(engine, &sprite);
+    }
+    
+    for (int i = 0; i < 400; i++) {
+        float angle = i * 0.0157080f;
+        float radius = 2.0f + (i % 5) * 0.5f;
+        Vec3 position = {center.x + cosf(angle) * radius, center.y + sinf(angle) * radius, 0.2f + (i % 7) * 0.1f};
+        Vec3 velocity = {cosf(angle * 3.0f) * 0.3f, sinf(angle * 3.0f) * 0.3f, 1.0f + (i % 3) * 0.5f};
+        particle_emit(engine, position, velocity, (ColorF){1.0f, 0.6f, 0.2f, 0.8f}, 30.0f);
+    }
+}
+
+static const GateScene gate_scenes[] = {
+    {"demo", 1, 8, INPUT_LEFT, gate_setup_demo},
+    {"post_fx", 2, 12, INPUT_FORWARD | INPUT_LEFT, gate_setup_post_fx},
+    {"crowd", 3, 20, INPUT_RIGHT, gate_setup_crowd},
+};
+
+// --- Images ---
+
+static bool gate_write_ppm(const char* filename, const uint32_t* pixels) {
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", filename);
+        return false;
+    }
+    
+    fprintf(file, "P6\n%d %d\n255\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+    uint8_t row[SCREEN_WIDTH * 3];
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            Color c = uint32_to_color(pixels[y * SCREEN_WIDTH + x]);
+            row[x * 3 + 0] = c.r;
+            row[x * 3 + 1] = c.g;
+            row[x * 3 + 2] = c.b;
+        }
+        fwrite(row, 1, sizeof(row), file);
+    }
+    
+    fclose(file);
+    return true;
+}
+
+// Reads a PPM written by gate_write_ppm; returns false if it is missing or
+// has another size
+static bool gate_read_ppm(const char* filename, uint8_t* rgb) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return false;
+    
+    int width = 0;
+    int height = 0;
+    int max_value = 0;
+    bool ok = fscanf(file, "P6 %d %d %d", &width, &height, &max_value) == 3 && fgetc(file) != EOF &&
+              width == SCREEN_WIDTH && height == SCREEN_HEIGHT && max_value == 255 &&
+              fread(rgb, 3, SCREEN_WIDTH * SCREEN_HEIGHT, file) == SCREEN_WIDTH * SCREEN_HEIGHT;
+    fclose(file);
+    return ok;
+}
+
+// Largest channel difference and PSNR in dB (GATE_PSNR_IDENTICAL when equal)
+static void gate_compare(const uint32_t* pixels, const uint8_t* golden, int* max_diff, double* psnr) {
+    double squared = 0.0;
+    *max_diff = 0;
+    
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        Color c = uint32_to_color(pixels[i]);
+        int diff[3] = {c.r - golden[i * 3], c.g - golden[i * 3 + 1], c.b - golden[i * 3 + 2]};
+        for (int k = 0; k < 3; k++) {
+            int d = abs(diff[k]);
+            if (d > *max_diff) *max_diff = d;
+            squared += (double)d * d;
+        }
+    }
+    
+    double mse = squared / (SCREEN_WIDTH * SCREEN_HEIGHT * 3.0);
+    *psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : GATE_PSNR_IDENTICAL;
+}
+
+// --- Capture ---
+
+static void gate_observe(void* context, Engine* engine, int pass) {
+    GateCapture* capture = (GateCapture*)context;
+    const FramePass* frame_pass = &engine->frame_graph.passes[pass];
+    capture->names[pass] = frame_pass->name;
+    if (pass >= capture->pass_count) capture->pass_count = pass + 1;
+    if (!(frame_pass->writes & FRAME_RESOURCE_COLOR)) return;
+    
+    size_t bytes = SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t);
+    if (!capture->images[pass]) capture->images[pass] = (uint32_t*)malloc(bytes);
+    if (capture->images[pass]) memcpy(capture->images[pass], engine->buffers.color_buffer, bytes);
+}
+
+static void gate_capture_free(GateCapture* capture) {
+    for (int i = 0; i < FRAME_MAX_PASSES; i++) free(capture->images[i]);
+    memset(capture, 0, sizeof(GateCapture));
+}
+
+// Build the scene from its seed, simulate it and render one captured frame.
+// With `pass_ms` set, then renders `reps` more frames and records pass times.
+static void gate_render(const GateScene* scene, int threads, GateCapture* capture,
+                        double (*pass_ms)[GATE_MAX_REPS], int reps) {
+    static Engine engine;
+    engine_init_seeded(&engine, scene->seed);
+    scene_load_demo(&engine);
+    scene->setup(&engine);
+    threading_set_thread_count(&engine.thread_pool, threads);
+    
+    for (int i = 0; i < scene->ticks; i++) {
+        engine.input.buttons = scene->buttons;
+        engine_update(&engine, engine.fixed_dt);
+    }
+    engine.input.buttons = 0;
+    
+    engine.frame_graph.observer = gate_observe;
+    engine.frame_graph.observer_context = capture;
+    engine_render(&engine);
+    engine.frame_graph.observer = NULL;
+    
+    for (int r = 0; pass_ms && r < reps; r++) {
+        engine_render(&engine);
+        const FrameGraph* graph = &engine.frame_graph;
+        for (int p = 0; p < graph->pass_count; p++) {
+            const FramePass* pass = &graph->passes[p];
+            pass_ms[p][r] = pass->enabled ? pass->end_ms - pass->start_ms : 0.0;
+        }
+    }
+    
+    engine_cleanup(&engine);
+}
+
+// --- Manifest ---
+
+static void gate_manifest_path(const GateOptions* options, char* path, size_t size) {
+    snprintf(path, size, "%s/%dx%d/gate.txt", options->golden_dir, SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+static void gate_manifest_load(GateManifest* manifest, const char* path) {
+    manifest->count = 0;
+    FILE* file = fopen(path, "r");
+    if (!file) return;
+    
+    char line[256];
+    while (fgets(line, sizeof(line), file) && manifest->count < GATE_MAX_ENTRIES) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        
+        GateEntry* entry = &manifest->entries[manifest->count];
+        memset(entry, 0, sizeof(GateEntry));
+        if (sscanf(line, "%31s %31s %d %lf %lf", entry->scene, entry->pass, &entry->max_diff,
+                   &entry->min_psnr, &entry->budget_ms) == 5) {
+            manifest->count++;
+        }
+    }
+    fclose(file);
+}
+
+static bool gate_manifest_save(const GateManifest* manifest, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+    
+    fprintf(file, "# Golden-image gate, %dx%d. One line per scene and pass:\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+    fprintf(file, "#   scene pass max_channel_diff min_psnr_db budget_ms\n");
+    fprintf(file, "# Tolerances are kept by --update; budgets are re-measured. A min_psnr of 0\n");
+    fprintf(file, "# disables that check, a max_channel_diff of 255 disables the other.\n");
+    for (int i = 0; i < manifest->count; i++) {
+        const GateEntry* entry = &manifest->entries[i];
+        fprintf(file, "%-10s %-22s %3d %6.1f %10.4f\n", entry->scene, entry->pass, entry->max_diff,
+                entry->min_psnr, entry->budget_ms);
+    }
+    
+    fclose(file);
+    return true;
+}
+
+static GateEntry* gate_manifest_find(GateManifest* manifest, const char* scene, const char* pass) {
+    for (int i = 0; i < manifest->count; i++) {
+        GateEntry* entry = &manifest->entries[i];
+        if (strcmp(entry->scene, scene) == 0 && strcmp(entry->pass, pass) == 0) return entry;
+    }
+    return NULL;
+}
+
+// --- Checks ---
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// Median and median absolute deviation; sorts `values`
+static double gate_median(double* values, int count, double* mad) {
+    qsort(values, count, sizeof(double), compare_double);
+    double median = values[count / 2];
+    
+    double deviations[GATE_MAX_REPS];
+    for (int i = 0; i < count; i++) deviations[i] = fabs(values[i] - median);
+    qsort(deviations, count, sizeof(double), compare_double);
+    *mad = deviations[count / 2];
+    return median;
+}
+
+// Identical output whatever the thread count
+static int gate_check_threads(const GateCapture* single, const GateCapture* threaded, int threads) {
+    size_t bytes = SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t);
+    for (int p = 0; p < single->pass_count; p++) {
+        if (!single->images[p]) continue;
+        if (!threaded->images[p] || memcmp(single->images[p], threaded->images[p], bytes) != 0) {
+            printf("  FAIL %-22s %d threads differ from 1 thread\n", single->names[p], threads);
+            return 1;   // Later passes inherit the difference
+        }
+    }
+    return 0;
+}
+
+static int gate_check_images(const GateOptions* options, const GateScene* scene, const GateCapture* capture,
+                             GateManifest* manifest, uint8_t* golden) {
+    int failures = 0;
+    char path[512];
+    
+    for (int p = 0; p < capture->pass_count; p++) {
+        if (!capture->images[p]) continue;
+        
+        const char* pass = capture->names[p];
+        snprintf(path, sizeof(path), "%s/%dx%d/%s/%s.ppm", options->golden_dir, SCREEN_WIDTH, SCREEN_HEIGHT,
+                 scene->name, pass);
+        
+        if (options->update) {
+            if (!gate_write_ppm(path, capture->images[p])) failures++;
+            continue;
+        }
+        
+        GateEntry* entry = gate_manifest_find(manifest, scene->name, pass);
+        if (!entry || !gate_read_ppm(path, golden)) {
+            printf("  FAIL %-22s no golden frame (run with --update)\n", pass);
+            failures++;
+            continue;
+        }
+        
+        int max_diff;
+        double psnr;
+        gate_compare(capture->images[p], golden, &max_diff, &psnr);
+        bool ok = max_diff <= entry->max_diff && psnr >= entry->min_psnr;
+        
+        if (max_diff > 0 || !ok) {
+            printf("  %s %-22s max diff %d (limit %d), PSNR %.1f dB (limit %.1f)\n", ok ? "ok  " : "FAIL",
+                   pass, max_diff, entry->max_diff, psnr, entry->min_psnr);
+        }
+        if (!ok) {
+            snprintf(path, sizeof(path), "%s/%dx%d/%s/%s.actual.ppm", options->golden_dir, SCREEN_WIDTH,
+                     SCREEN_HEIGHT, scene->name, pass);
+            gate_write_ppm(path, capture->images[p]);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+static int gate_check_budgets(const GateOptions* options, const GateScene* scene, const GateCapture* capture,
+                              GateManifest* manifest, double (*pass_ms)[GATE_MAX_REPS]) {
+    int failures = 0;
+    
+    for (int p = 0; p < capture->pass_count; p++) {
+        if (!capture->names[p]) continue;
+        
+        double mad;
+        double median = gate_median(pass_ms[p], options->reps, &mad);
+        GateEntry* entry = gate_manifest_find(manifest, scene->name, capture->names[p]);
+        
+        if (options->update) {
+            if (!entry && manifest->count < GATE_MAX_ENTRIES) {
+                entry = &manifest->entries[manifest->count++];
+                memset(entry, 0, sizeof(GateEntry));
+                snprintf(entry->scene, sizeof(entry->scene), "%s", scene->name);
+                snprintf(entry->pass, sizeof(entry->pass), "%s", capture->names[p]);
+            }
+            if (entry && options->timing) entry->budget_ms = median;
+            continue;
+        }
+        if (!options->timing || !entry) continue;
+        
+        double limit = entry->budget_ms * (1.0 + options->slack) + GATE_NOISE_FLOOR_MS + GATE_NOISE_MADS * mad;
+        if (median > limit) {
+            printf("  FAIL %-22s %.3f ms (budget %.3f ms, limit %.3f ms with noise %.3f ms)\n",
+                   capture->names[p], median, entry->budget_ms, limit, mad);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// --- Main ---
+
+static void gate_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--golden DIR] [--update] [--scene NAME] [--threads N] [--reps N]\n"
+                    "       [--slack FRACTION] [--no-timing]\n", program);
+}
+
+static bool gate_parse(GateOptions* options, int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--golden") == 0 && has_value) {
+            options->golden_dir = argv[++i];
+        } else if (strcmp(argv[i], "--update") == 0) {
+            options->update = true;
+        } else if (strcmp(argv[i], "--scene") == 0 && has_value) {
+            options->scene_filter = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+            options->threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--reps") == 0 && has_value) {
+            options->reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--slack") == 0 && has_value) {
+            options->slack = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-timing") == 0) {
+            options->timing = false;
+        } else {
+            return false;
+        }
+    }
+    return options->threads >= 2 && options->threads <= THREADING_MAX_THREADS &&
+           options->reps >= 1 && options->reps <= GATE_MAX_REPS && options->slack >= 0.0;
+}
+
+static bool gate_make_dirs(const GateOptions* options) {
+    char path[512];
+    gate_mkdir(options->golden_dir);
+    snprintf(path, sizeof(path), "%s/%dx%d", options->golden_dir, SCREEN_WIDTH, SCREEN_HEIGHT);
+    gate_mkdir(path);
+    
+    int count = (int)(sizeof(gate_scenes) / sizeof(gate_scenes[0]));
+    for (int s = 0; s < count; s++) {
+        snprintf(path, sizeof(path), "%s/%dx%d/%s", options->golden_dir, SCREEN_WIDTH, SCREEN_HEIGHT,
+                 gate_scenes[s].name);
+        gate_mkdir(path);
+        
+        struct stat info;
+        if (stat(path, &info) != 0) {
+            fprintf(stderr, "Cannot create %s\n", path);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    GateOptions options = {"golden", NULL, false, true, MAX_THREADS, 5, 0.15};
+    if (!gate_parse(&options, argc, argv)) {
+        gate_usage(argv[0]);
+        return 1;
+    }
+    if (options.update && !gate_make_dirs(&options)) return 1;
+    
+    char manifest_path[512];
+    static GateManifest manifest;
+    gate_manifest_path(&options, manifest_path, sizeof(manifest_path));
+    gate_manifest_load(&manifest, manifest_path);
+    if (!options.update && manifest.count == 0) {
+        fprintf(stderr, "No golden manifest at %s (run with --update)\n", manifest_path);
+        return 1;
+    }
+    
+    uint8_t* golden = (uint8_t*)malloc(SCREEN_WIDTH * SCREEN_HEIGHT * 3);
+    static double pass_ms[FRAME_MAX_PASSES][GATE_MAX_REPS];
+    if (!golden) return 1;
+    
+    printf("Gate: %dx%d, 1 and %d threads, %s\n", SCREEN_WIDTH, SCREEN_HEIGHT, options.threads,
+           options.update ? "updating goldens and budgets" : "checking goldens and budgets");
+    
+    int failures = 0;
+    int count = (int)(sizeof(gate_scenes) / sizeof(gate_scenes[0]));
+    for (int s = 0; s < count; s++) {
+        const GateScene* scene = &gate_scenes[s];
+        if (options.scene_filter && strcmp(options.scene_filter, scene->name) != 0) continue;
+        
+        GateCapture single = {0};
+        GateCapture threaded = {0};
+        gate_render(scene, 1, &single, NULL, 0);
+        gate_render(scene, options.threads, &threaded, pass_ms, options.reps);
+        
+        printf("Scene %s (seed %u)\n", scene->name, scene->seed);
+        int scene_failures = gate_check_threads(&single, &threaded, options.threads);
+        scene_failures += gate_check_images(&options, scene, &single, &manifest, golden);
+        scene_failures += gate_check_budgets(&options, scene, &threaded, &manifest, pass_ms);
+        if (scene_failures == 0) printf("  ok\n");
+        failures += scene_failures;
+        
+        gate_capture_free(&single);
+        gate_capture_free(&threaded);
+    }
+    
+    if (options.update) {
+        if (failures == 0 && gate_manifest_save(&manifest, manifest_path)) {
+            printf("Wrote %s\n", manifest_path);
+        } else {
+            failures++;
+        }
+    }
+    
+    free(golden);
+    printf("%s: %d failure%s\n", failures ? "FAILED" : "PASSED", failures, failures == 1 ? "" : "s");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,526 @@
+#include "../include/engine.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define headless_mkdir(path) _mkdir(path)
+#else
+#define headless_mkdir(path) mkdir(path, 0755)
+#endif
+
+// Headless benchmark runner. Links the engine without SDL (build with
+// ENGINE_HEADLESS, see `make headless`), loads a map by seed or file, flies
+// the camera along a keyframed path or drives it from a replay log, renders
+// a fixed number of frames at the fixed tick rate and writes per-frame and
+// per-pass timings as CSV or JSON. Selected frames can be saved as PPM. The
+// same arguments always produce the same frames.
+#define HEADLESS_MAX_KEYFRAMES 256
+#define HEADLESS_MAX_SAVED 32
+
+typedef struct {
+    int frame;
+    float x;
+    float y;
+    float yaw;          // Degrees, 0 = +x, counter-clockwise
+    float pitch;
+} CameraKey;
+
+typedef struct {
+    CameraKey keys[HEADLESS_MAX_KEYFRAMES];
+    int count;
+} CameraPath;
+
+typedef struct {
+    uint32_t seed;
+    const char* map_path;
+    const char* path_file;
+    const char* replay_file;
+    const char* csv_file;
+    const char* json_file;
+    const char* trace_file;
+    const char* metrics_target;
+    double flight_threshold_ms; // Dump recorded frames into out_dir above this
+    DebugView debug_view;
+    const char* out_dir;
+    int frames;
+    int warmup;
+    int saved[HEADLESS_MAX_SAVED];
+    int saved_count;
+    bool counters;
+    bool memory;                // Memory by subsystem over the recorded frames
+} HeadlessOptions;
+
+// One line per keyframe: "frame x y yaw [pitch]", '#' starts a comment.
+// Frames must increase; the camera moves linearly between keys.
+static bool camera_path_load(CameraPath* path, const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open camera path %s\n", filename);
+        return false;
+    }
+    
+    char line[256];
+    path->count = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        
+        CameraKey key = {0};
+        int fields = sscanf(line, "%d %f %f %f %f", &key.frame, &key.x, &key.y, &key.yaw, &key.pitch);
+        if (fields <= 0) continue;
+        if (fields < 4 || (path->count > 0 && key.frame <= path->keys[path->count - 1].frame)) {
+            fprintf(stderr, "Bad keyframe in %s: %s", filename, line);
+            fclose(file);
+            return false;
+        }
+        if (path->count == HEADLESS_MAX_KEYFRAMES) {
+            fprintf(stderr, "Camera path %s has more than %d keyframes\n", filename, HEADLESS_MAX_KEYFRAMES);
+            fclose(file);
+            return false;
+        }
+        path->keys[path->count++] = key;
+    }
+    
+    fclose(file);
+    if (path->count == 0) {
+        fprintf(stderr, "Camera path %s has no keyframes\n", filename);
+        return false;
+    }
+    return true;
+}
+
+// Without a path file: one full turn on the spot over the run
+static void camera_path_default(CameraPath* path, const Camera* camera, int frames) {
+    float yaw = atan2f(camera->direction.y, camera->direction.x) * 180.0f / 3.14159265f;
+    path->keys[0] = (CameraKey){0, camera->position.x, camera->position.y, yaw, 0.0f};
+    path->keys[1] = (CameraKey){frames > 1 ? frames - 1 : 1, camera->position.x, camera->position.y,
+                                yaw + 360.0f, 0.0f};
+    path->count = 2;
+}
+
+static CameraKey camera_path_sample(const CameraPath* path, int frame) {
+    if (frame <= path->keys[0].frame) return path->keys[0];
+    
+    for (int i = 1; i < path->count; i++) {
+        const CameraKey* a = &path->keys[i - 1];
+        const CameraKey* b = &path->keys[i];
+        if (frame > b->frame) continue;
+        
+        float t = (float)(frame - a->frame) / (float)(b->frame - a->frame);
+        return (CameraKey){frame, a->x + (b->x - a->x) * t, a->y + (b->y - a->y) * t,
+                           a->yaw + (b->yaw - a->yaw) * t, a->pitch + (b->pitch - a->pitch) * t};
+    }
+    return path->keys[path->count - 1];
+}
+
+// Place the camera exactly; prev_camera matches so interpolation is a no-op
+static void camera_apply_key(Engine* engine, const CameraKey* key) {
+    Camera* camera = &engine->camera;
+    float plane_length = vec2_length(camera->plane);
+    float yaw = key->yaw * 3.14159265f / 180.0f;
+    
+    camera->position = (Vec2){key->x, key->y};
+    camera->direction = (Vec2){cosf(yaw), sinf(yaw)};
+    camera->plane = (Vec2){camera->direction.y * plane_length, -camera->direction.x * plane_length};
+    camera->pitch = key->pitch;
+    camera->physics.position = camera->position;
+    camera->physics.velocity = (Vec2){0.0f, 0.0f};
+    engine->prev_camera = *camera;
+}
+
+// Binary PPM of the colour buffer
+static bool headless_save_ppm(const Engine* engine, const char* filename) {
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", filename);
+        return false;
+    }
+    
+    fprintf(file, "P6\n%d %d\n255\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+    uint8_t row[SCREEN_WIDTH * 3];
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint32_t* pixels = engine->buffers.color_buffer + y * SCREEN_WIDTH;
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            row[x * 3 + 0] = (pixels[x] >> 16) & 0xFF;
+            row[x * 3 + 1] = (pixels[x] >> 8) & 0xFF;
+            row[x * 3 + 2] = pixels[x] & 0xFF;
+        }
+        fwrite(row, 1, sizeof(row), file);
+    }
+    
+    fclose(file);
+    return true;
+}
+
+static uint32_t headless_image_hash(const Engine* engine) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        hash ^= engine->buffers.color_buffer[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static double percentile(const double* values, int count, double p) {
+    if (count == 0) return 0.0;
+    
+    double* sorted = (double*)malloc(count * sizeof(double));
+    memcpy(sorted, values, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_double);
+    double value = sorted[(int)(p / 100.0 * (count - 1) + 0.5)];
+    free(sorted);
+    return value;
+}
+
+typedef struct {
+    int frames;
+    int pass_count;
+    const char* pass_names[FRAME_MAX_PASSES];
+    double* render_ms;      // Wall time of engine_render, per frame
+    double* critical_ms;
+    double* pass_ms;        // frames x pass_count; 0 for skipped passes
+    uint64_t* ticks;
+} HeadlessResults;
+
+static void headless_write_csv(const HeadlessResults* results, const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", filename);
+        return;
+    }
+    
+    fprintf(file, "frame,tick,render_ms,critical_ms");
+    for (int p = 0; p < results->pass_count; p++) fprintf(file, ",%s", results->pass_names[p]);
+    fprintf(file, "\n");
+    
+    for (int f = 0; f < results->frames; f++) {
+        fprintf(file, "%d,%llu,%.4f,%.4f", f, (unsigned long long)results->ticks[f],
+                results->render_ms[f], results->critical_ms[f]);
+        for (int p = 0; p < results->pass_count; p++) {
+            fprintf(file, ",%.4f", results->pass_ms[f * results->pass_count + p]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+static void json_write_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static void headless_write_json(const HeadlessResults* results, const HeadlessOptions* options,
+                                uint32_t image_hash, uint32_t checksum, const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", filename);
+        return;
+    }
+    
+    int n = results->frames;
+    double total = 0.0;
+    for (int f = 0; f < n; f++) total += results->render_ms[f];
+    
+    fprintf(file, "{\n  \"seed\": %u,\n  \"map\": ", options->seed);
+    json_write_string(file, options->map_path ? options->map_path : "procedural");
+    fprintf(file, ",\n");
+    fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %d,\n", SCREEN_WIDTH, SCREEN_HEIGHT, n);
+    fprintf(file, "  \"image_hash\": \"%08x\",\n  \"state_checksum\": \"%08x\",\n", image_hash, checksum);
+    fprintf(file, "  \"render_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+            n ? total / n : 0.0, percentile(results->render_ms, n, 50.0), percentile(results->render_ms, n, 95.0),
+            percentile(results->render_ms, n, 99.0), percentile(results->render_ms, n, 100.0));
+    
+    fprintf(file, "  \"passes\": {");
+    for (int p = 0; p < results->pass_count; p++) {
+        double sum = 0.0;
+        for (int f = 0; f < n; f++) sum += results->pass_ms[f * results->pass_count + p];
+        fprintf(file, "%s\n    \"%s\": {\"mean_ms\": %.4f}", p ? "," : "", results->pass_names[p], n ? sum / n : 0.0);
+    }
+    fprintf(file, "\n  },\n  \"per_frame\": [");
+    
+    for (int f = 0; f < n; f++) {
+        fprintf(file, "%s\n    {\"frame\": %d, \"tick\": %llu, \"render_ms\": %.4f, \"critical_ms\": %.4f, \"passes\": [",
+                f ? "," : "", f, (unsigned long long)results->ticks[f], results->render_ms[f], results->critical_ms[f]);
+        for (int p = 0; p < results->pass_count; p++) {
+            fprintf(file, "%s%.4f", p ? ", " : "", results->pass_ms[f * results->pass_count + p]);
+        }
+        fprintf(file, "]}");
+    }
+    fprintf(file, "\n  ]\n}\n");
+    fclose(file);
+}
+
+static void headless_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--seed N | --map FILE] [--path FILE | --replay FILE]\n"
+            "          [--frames N] [--warmup N] [--csv FILE] [--json FILE] [--trace FILE]\n"
+            "          [--counters] [--metrics FILE|unix:PATH] [--debug-view VIEW]\n"
+            "          [--flight-threshold MS] [--memory] [--save-frame N]... [--out-dir DIR]\n", program);
+}
+
+static bool headless_parse(HeadlessOptions* options, int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            options->seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--map") == 0 && has_value) {
+            options->map_path = argv[++i];
+        } else if (strcmp(argv[i], "--path") == 0 && has_value) {
+            options->path_file = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && has_value) {
+            options->replay_file = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && has_value) {
+            options->frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+            options->warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0 && has_value) {
+            options->csv_file = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && has_value) {
+            options->json_file = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && has_value) {
+            options->trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--counters") == 0) {
+            options->counters = true;
+        } else if (strcmp(argv[i], "--memory") == 0) {
+            options->memory = true;
+        } else if (strcmp(argv[i], "--metrics") == 0 && has_value) {
+            options->metrics_target = argv[++i];
+        } else if (strcmp(argv[i], "--flight-threshold") == 0 && has_value) {
+            options->flight_threshold_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--debug-view") == 0 && has_value) {
+            options->debug_view = debug_view_from_name(argv[++i]);
+            if (options->debug_view == DEBUG_VIEW_COUNT) {
+                fprintf(stderr, "Debug views: dda_steps, overdraw, light_cost\n");
+                return false;
+            }
+        } else if (strcmp(argv[i], "--out-dir") == 0 && has_value) {
+            options->out_dir = argv[++i];
+        } else if (strcmp(argv[i], "--save-frame") == 0 && has_value) {
+            if (options->saved_count == HEADLESS_MAX_SAVED) {
+                fprintf(stderr, "At most %d frames can be saved\n", HEADLESS_MAX_SAVED);
+                return false;
+            }
+            options->saved[options->saved_count++] = atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    
+    if (options->path_file && options->replay_file) {
+        fprintf(stderr, "--path and --replay are exclusive\n");
+        return false;
+    }
+    return options->frames > 0 && options->warmup >= 0;
+}
+
+// Creates `path` and its missing parents, or only the parents of a file
+// path; failures show up when the output is opened
+static void headless_make_dirs(const char* path, bool parents_only) {
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", path);
+    if (parents_only) {
+        char* slash = strrchr(dir, '/');
+        if (!slash) return;
+        *slash = '\0';
+    }
+    
+    for (char* c = dir + 1; *c; c++) {
+        if (*c != '/') continue;
+        *c = '\0';
+        headless_mkdir(dir);
+        *c = '/';
+    }
+    headless_mkdir(dir);
+}
+
+static bool headless_should_save(const HeadlessOptions* options, int frame) {
+    for (int i = 0; i < options->saved_count; i++) {
+        if (options->saved[i] == frame) return true;
+    }
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    static Engine engine;
+    static CameraPath path;
+    static FlightRecorder flight;
+    MemoryReport memory_start = {0};
+    HeadlessOptions options = {0};
+    options.seed = 1;
+    options.frames = 600;
+    options.warmup = 10;
+    options.out_dir = ".";
+    
+    if (!headless_parse(&options, argc, argv)) {
+        headless_usage(argv[0]);
+        return 1;
+    }
+    if (options.counters) profiler_enable_counters();
+    
+    // Frames, dumps and results may go to directories that do not exist yet
+    if (options.saved_count > 0 || options.flight_threshold_ms > 0.0) {
+        headless_make_dirs(options.out_dir, false);
+    }
+    if (options.csv_file) headless_make_dirs(options.csv_file, true);
+    if (options.json_file) headless_make_dirs(options.json_file, true);
+    if (options.trace_file) headless_make_dirs(options.trace_file, true);
+    
+    if (options.replay_file && !replay_read_seed(options.replay_file, &options.seed)) {
+        fprintf(stderr, "Cannot read replay log %s\n", options.replay_file);
+        return 1;
+    }
+    if (options.path_file && !camera_path_load(&path, options.path_file)) return 1;
+    
+    engine_init_seeded(&engine, options.seed);
+    scene_load_demo(&engine);
+    if (!debug_view_set(&engine, options.debug_view)) {
+        engine_cleanup(&engine);
+        return 1;
+    }
+    
+    if (options.map_path) {
+        // map_load_from_file falls back to a time-seeded map; refuse instead
+        FILE* map = fopen(options.map_path, "r");
+        if (!map) {
+            fprintf(stderr, "Cannot open map %s\n", options.map_path);
+            engine_cleanup(&engine);
+            return 1;
+        }
+        fclose(map);
+        map_load_from_file(&engine.world, options.map_path);
+    }
+    
+    if (options.replay_file) {
+        if (!replay_begin_playback(&engine, options.replay_file)) {
+            engine_cleanup(&engine);
+            return 1;
+        }
+    } else if (!options.path_file) {
+        camera_path_default(&path, &engine.camera, options.frames);
+    }
+    
+    HeadlessResults results = {0};
+    results.render_ms = (double*)calloc(options.frames, sizeof(double));
+    results.critical_ms = (double*)calloc(options.frames, sizeof(double));
+    results.pass_ms = (double*)calloc((size_t)options.frames * FRAME_MAX_PASSES, sizeof(double));
+    results.ticks = (uint64_t*)calloc(options.frames, sizeof(uint64_t));
+    if (!results.render_ms || !results.critical_ms || !results.pass_ms || !results.ticks) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    if (options.flight_threshold_ms > 0.0 && flight_recorder_init(&flight, options.flight_threshold_ms,
+                                                                  options.out_dir)) {
+        flight.seed = options.seed;
+        flight.replay_file = options.replay_file;
+        flight_recorder_install_signal();
+    }
+    
+    // Warm-up frames settle caches, the frame arena and the worker pool;
+    // they use the first path position and are not recorded
+    int total = options.warmup + options.frames;
+    for (int i = 0; i < total && !engine.replay.finished; i++) {
+        int frame = i - options.warmup;
+        if (frame == 0) {
+            profiler_reset();
+            memory_get_report(&memory_start);
+        }
+        
+        engine_update(&engine, engine.fixed_dt);
+        if (!options.replay_file) {
+            CameraKey key = camera_path_sample(&path, frame > 0 ? frame : 0);
+            camera_apply_key(&engine, &key);
+        }
+        
+        double start = sim_pipeline_now_ms();
+        engine_render(&engine);
+        double end = sim_pipeline_now_ms();
+        double elapsed = end - start;
+        if (frame < 0) continue;
+        flight_recorder_frame(&flight, &engine, end);
+        
+        const FrameGraph* graph = &engine.frame_graph;
+        if (results.pass_count == 0) {
+            results.pass_count = graph->pass_count;
+            for (int p = 0; p < graph->pass_count; p++) results.pass_names[p] = graph->passes[p].name;
+        }
+        
+        results.render_ms[frame] = elapsed;
+        telemetry_add(TELEMETRY_FRAMES, 1);
+        telemetry_record(TELEMETRY_FRAME_TIME, (uint64_t)(elapsed * 1.0e6));
+        results.critical_ms[frame] = graph->critical_path_ms;
+        results.ticks[frame] = engine.tick_count;
+        for (int p = 0; p < results.pass_count && p < graph->pass_count; p++) {
+            const FramePass* pass = &graph->passes[p];
+            results.pass_ms[frame * results.pass_count + p] = pass->enabled ? pass->end_ms - pass->start_ms : 0.0;
+        }
+        results.frames = frame + 1;
+        
+        if (headless_should_save(&options, frame)) {
+            char filename[512];
+            snprintf(filename, sizeof(filename), "%s/frame_%05d.ppm", options.out_dir, frame);
+            if (headless_save_ppm(&engine, filename)) printf("Saved %s\n", filename);
+        }
+    }
+    
+    uint32_t image_hash = headless_image_hash(&engine);
+    uint32_t checksum = replay_state_checksum(&engine);
+    double sum = 0.0;
+    for (int f = 0; f < results.frames; f++) sum += results.render_ms[f];
+    
+    printf("Headless: seed %u, %s, %d frames at %dx%d\n", options.seed,
+           options.map_path ? options.map_path : "procedural map", results.frames, SCREEN_WIDTH, SCREEN_HEIGHT);
+    printf("  Render:   %.4f ms mean, %.4f ms p50, %.4f ms p95, %.4f ms max\n",
+           results.frames ? sum / results.frames : 0.0, percentile(results.render_ms, results.frames, 50.0),
+           percentile(results.render_ms, results.frames, 95.0), percentile(results.render_ms, results.frames, 100.0));
+    printf("  Image:    %08x (last frame)\n", image_hash);
+    printf("  Checksum: %08x\n", checksum);
+    if (options.debug_view != DEBUG_VIEW_NONE) {
+        printf("  View:     %s, white = %d\n", debug_view_name(options.debug_view), engine.debug_scale);
+    }
+    
+    if (options.memory) {
+        MemoryReport memory_end;
+        memory_get_report(&memory_end);
+        memory_print_report(&memory_end, &memory_start);
+    }
+    
+    if (options.csv_file) headless_write_csv(&results, options.csv_file);
+    if (options.json_file) headless_write_json(&results, &options, image_hash, checksum, options.json_file);
+    
+#ifdef ENGINE_PROFILER
+    profiler_print_summary();
+#endif
+    if (options.trace_file && profiler_write_trace(options.trace_file)) {
+        printf("Trace written to %s\n", options.trace_file);
+    }
+    if (options.metrics_target) {
+        if (telemetry_export(options.metrics_target)) {
+            printf("Metrics written to %s\n", options.metrics_target);
+        } else {
+            fprintf(stderr, "Cannot export telemetry to %s\n", options.metrics_target);
+        }
+    }
+    
+    free(results.render_ms);
+    free(results.critical_ms);
+    free(results.pass_ms);
+    free(results.ticks);
+    flight_recorder_cleanup(&flight);
+    engine_cleanup(&engine);
+    return 0;
+}
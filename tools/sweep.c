@@ -0,0 +1,455 @@
+#include "../include/engine.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Scalability sweep. Renders the same frames (a replay, or the demo scene
+// turning on the spot) with 1..N worker threads, for a base workload and
+// for heavier light, sprite and particle counts, and prints each pass's
+// time with its speedup and parallel efficiency over the one-thread run.
+// Passes the frame graph cannot split are marked serial; together they set
+// the Amdahl limit of the frame. The internal resolution is a build
+// setting, see tools/sweep_resolutions.sh. Build with `make sweep`.
+#define SWEEP_MAX_VALUES 16
+#define SWEEP_MAX_WORKLOADS (1 + 3 * SWEEP_MAX_VALUES)
+#define SWEEP_EFFICIENCY_FLOOR 0.7      // "Still scaling" down to this efficiency
+#define SWEEP_PARTICLE_LIFETIME 1.0e6f
+
+typedef struct {
+    int values[SWEEP_MAX_VALUES];
+    int count;
+} SweepList;
+
+typedef struct {
+    const char* axis;
+    int lights;                 // Added to the scene's own torch
+    int sprites;
+    int particles;
+} SweepWorkload;
+
+// Mean wall times of one workload at one thread count
+typedef struct {
+    int pass_count;
+    const char* pass_names[FRAME_MAX_PASSES];
+    bool pass_parallel[FRAME_MAX_PASSES];
+    double pass_ms[FRAME_MAX_PASSES];
+    double render_ms;
+    double critical_ms;
+    double update_ms;
+} SweepResult;
+
+typedef struct {
+    uint32_t seed;
+    const char* replay_file;
+    const char* csv_file;
+    int frames;
+    int warmup;
+    SweepList threads;
+    SweepList lights;
+    SweepList sprites;
+    SweepList particles;
+} SweepOptions;
+
+static bool sweep_parse_list(SweepList* list, const char* text) {
+    list->count = 0;
+    const char* c = text;
+    while (*c) {
+        char* end;
+        long value = strtol(c, &end, 10);
+        if (end == c || value < 0 || list->count == SWEEP_MAX_VALUES) return false;
+        list->values[list->count++] = (int)value;
+        c = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return list->count > 0;
+}
+
+// 1..N, every count up to 8 and then doubling, always ending at N
+static void sweep_default_threads(SweepList* list) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max = cores > 1 ? (int)cores : 1;
+    if (max > THREADING_MAX_THREADS) max = THREADING_MAX_THREADS;
+    
+    list->count = 0;
+    for (int t = 1; t <= max && list->count < SWEEP_MAX_VALUES - 1; t = t < 8 ? t + 1 : t * 2) {
+        list->values[list->count++] = t;
+    }
+    if (list->values[list->count - 1] != max) list->values[list->count++] = max;
+}
+
+// --- Scene ---
+
+// The empty cell with the most empty cells around it
+static Vec2 sweep_open_cell(Engine* engine) {
+    int best_x = MAP_WIDTH / 2;
+    int best_y = MAP_HEIGHT / 2;
+    int best_open = -1;
+    
+    for (int y = 2; y < MAP_HEIGHT - 2; y++) {
+        for (int x = 2; x < MAP_WIDTH - 2; x++) {
+            if (map_get_tile(&engine->world, x, y) != 0) continue;
+            
+            int open = 0;
+            for (int dy = -2; dy <= 2; dy++) {
+                for (int dx = -2; dx <= 2; dx++) {
+                    if (map_get_tile(&engine->world, x + dx, y + dy) == 0) open++;
+                }
+            }
+            if (open > best_open) {
+                best_open = open;
+                best_x = x;
+                best_y = y;
+            }
+        }
+    }
+    return (Vec2){best_x + 0.5f, best_y + 0.5f};
+}
+
+static void sweep_face(Engine* engine, Vec2 position, float yaw) {
+    Camera* camera = &engine->camera;
+    float plane_length = vec2_length(camera->plane);
+    camera->position = position;
+    camera->direction = (Vec2){cosf(yaw), sinf(yaw)};
+    camera->plane = (Vec2){camera->direction.y * plane_length, -camera->direction.x * plane_length};
+    camera->physics.position = position;
+    camera->physics.velocity = (Vec2){0.0f, 0.0f};
+    engine->prev_camera = *camera;
+}
+
+static uint32_t sweep_random(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Random empty cell within `radius` cells of `center`, but not right next to
+// it: a particle or sprite at the camera would cover the screen and swamp
+// every other cost
+static Vec2 sweep_scatter(Engine* engine, Vec2 center, int radius, uint32_t* state) {
+    for (int attempt = 0; attempt < 64; attempt++) {
+        int dx = (int)(sweep_random(state) % (2 * radius + 1)) - radius;
+        int dy = (int)(sweep_random(state) % (2 * radius + 1)) - radius;
+        if (abs(dx) < 2 && abs(dy) < 2) continue;
+        
+        int x = (int)center.x + dx;
+        int y = (int)center.y + dy;
+        if (map_get_tile(&engine->world, x, y) == 0) {
+            return (Vec2){x + 0.25f + (sweep_random(state) % 50) * 0.01f,
+                          y + 0.25f + (sweep_random(state) % 50) * 0.01f};
+        }
+    }
+    return center;
+}
+
+// Extra lights, sprites and particles around the camera, the same every run.
+// Added lights do not cast shadows, so the shadow pass keeps its cost.
+static void sweep_populate(Engine* engine, const SweepWorkload* workload, Vec2 center) {
+    uint32_t state = 0x9E3779B9u;
+    
+    for (int i = 0; i < workload->lights; i++) {
+        Vec2 p = sweep_scatter(engine, center, 8, &state);
+        Light light = {
+            {p.x, p.y, 1.5f},
+            {0.4f + (i % 3) * 0.3f, 0.5f, 1.0f - (i % 3) * 0.3f, 1.0f},
+            2.0f,
+            6.0f,
+            false,
+            0.0f
+        };
+        light_add(engine, &light);
+    }
+    
+    for (int i = 0; i < workload->sprites; i++) {
+        Sprite sprite = {0};
+        sprite.position = sweep_scatter(engine, center, 8, &state);
+        sprite.texture_id = i % (engine->texture_count > 0 ? engine->texture_count : 1);
+        sprite.scale = (Vec2){0.5f, 0.5f};
+        sprite.billboarding = true;
+        sprite.tint = (ColorF){1.0f, 1.0f, 1.0f, 1.0f};
+        sprite_create(engine, &sprite);
+    }
+    
+    for (int i = 0; i < workload->particles; i++) {
+        Vec2 p = sweep_scatter(engine, center, 6, &state);
+        Vec3 velocity = {((int)(sweep_random(&state) % 200) - 100) * 0.005f,
+                         ((int)(sweep_random(&state) % 200) - 100) * 0.005f,
+                         (sweep_random(&state) % 100) * 0.02f};
+        particle_emit(engine, (Vec3){p.x, p.y, 0.5f}, velocity, (ColorF){1.0f, 0.7f, 0.3f, 1.0f},
+                      SWEEP_PARTICLE_LIFETIME);
+    }
+}
+
+// --- Runs ---
+
+static bool sweep_run(const SweepOptions* options, const SweepWorkload* workload, int threads,
+                      SweepResult* result) {
+    static Engine engine;
+    memset(result, 0, sizeof(SweepResult));
+    
+    engine_init_seeded(&engine, options->seed);
+    scene_load_demo(&engine);
+    
+    Vec2 spawn = sweep_open_cell(&engine);
+    float yaw = atan2f(engine.camera.direction.y, engine.camera.direction.x);
+    if (!options->replay_file) sweep_face(&engine, spawn, yaw);
+    sweep_populate(&engine, workload, options->replay_file ? engine.camera.position : spawn);
+    
+    if (options->replay_file && !replay_begin_playback(&engine, options->replay_file)) {
+        engine_cleanup(&engine);
+        return false;
+    }
+    threading_set_thread_count(&engine.thread_pool, threads);
+    
+    int frames = 0;
+    int total = options->warmup + options->frames;
+    for (int i = 0; i < total && !engine.replay.finished; i++) {
+        double start = sim_pipeline_now_ms();
+        engine_update(&engine, engine.fixed_dt);
+        double update_ms = sim_pipeline_now_ms() - start;
+        
+        // Without a replay the camera turns once over the measured frames
+        if (!options->replay_file) {
+            int frame = i > options->warmup ? i - options->warmup : 0;
+            sweep_face(&engine, spawn, yaw + 6.2831853f * frame / options->frames);
+        }
+        
+        start = sim_pipeline_now_ms();
+        engine_render(&engine);
+        double render_ms = sim_pipeline_now_ms() - start;
+        if (i < options->warmup) continue;
+        
+        const FrameGraph* graph = &engine.frame_graph;
+        result->pass_count = graph->pass_count;
+        for (int p = 0; p < graph->pass_count; p++) {
+            const FramePass* pass = &graph->passes[p];
+            result->pass_names[p] = pass->name;
+            result->pass_parallel[p] = pass->items > 1;
+            if (pass->enabled) result->pass_ms[p] += pass->end_ms - pass->start_ms;
+        }
+        result->render_ms += render_ms;
+        result->critical_ms += graph->critical_path_ms;
+        result->update_ms += update_ms;
+        frames++;
+    }
+    
+    if (frames > 0) {
+        for (int p = 0; p < result->pass_count; p++) result->pass_ms[p] /= frames;
+        result->render_ms /= frames;
+        result->critical_ms /= frames;
+        result->update_ms /= frames;
+    }
+    
+    engine_cleanup(&engine);
+    if (frames == 0) {
+        fprintf(stderr, "No frames measured (replay too short for the warm-up?)\n");
+        return false;
+    }
+    return true;
+}
+
+// --- Report ---
+
+static double sweep_speedup(double base_ms, double ms) {
+    return ms > 0.0 ? base_ms / ms : 0.0;
+}
+
+// Largest thread count that still ran at SWEEP_EFFICIENCY_FLOOR or better
+static int sweep_scales_to(const SweepList* threads, const double* ms) {
+    int scales_to = threads->values[0];
+    for (int t = 1; t < threads->count; t++) {
+        double efficiency = sweep_speedup(ms[0], ms[t]) * threads->values[0] / threads->values[t];
+        if (efficiency < SWEEP_EFFICIENCY_FLOOR) break;
+        scales_to = threads->values[t];
+    }
+    return scales_to;
+}
+
+static void sweep_print_row(const char* name, const char* kind, const SweepList* threads, const double* ms) {
+    printf("  %-22s %-6s", name, kind);
+    for (int t = 0; t < threads->count; t++) {
+        double speedup = sweep_speedup(ms[0], ms[t]);
+        double efficiency = speedup * threads->values[0] / threads->values[t];
+        printf(" %8.3f %5.2fx %3.0f%%", ms[t], speedup, efficiency * 100.0);
+    }
+    if (strcmp(kind, "serial") == 0) {
+        printf("    -\n");     // Runs on one thread whatever the pool size
+    } else {
+        printf("  %3d\n", sweep_scales_to(threads, ms));
+    }
+}
+
+static void sweep_write_csv_row(FILE* csv, const SweepWorkload* workload, const SweepList* threads,
+                                const char* name, const char* kind, const double* ms) {
+    for (int t = 0; t < threads->count; t++) {
+        double speedup = sweep_speedup(ms[0], ms[t]);
+        fprintf(csv, "%s,%d,%d,%d,%dx%d,%d,%s,%s,%.4f,%.4f,%.4f\n", workload->axis, workload->lights,
+                workload->sprites, workload->particles, SCREEN_WIDTH, SCREEN_HEIGHT, threads->values[t],
+                name, kind, ms[t], speedup, speedup * threads->values[0] / threads->values[t]);
+    }
+}
+
+static void sweep_report(const SweepWorkload* workload, const SweepList* threads,
+                         const SweepResult* results, FILE* csv) {
+    const SweepResult* base = &results[0];
+    double ms[SWEEP_MAX_VALUES];
+    
+    printf("\nWorkload %s: +%d lights, %d sprites, %d particles\n", workload->axis, workload->lights,
+           workload->sprites, workload->particles);
+    printf("  %-22s %-6s", "pass", "");
+    for (int t = 0; t < threads->count; t++) {
+        char label[32];
+        snprintf(label, sizeof(label), "%d thread%s", threads->values[t], threads->values[t] == 1 ? "" : "s");
+        printf(" %-20s", label);
+    }
+    printf("  scales to\n");
+    
+    double serial_ms = 0.0;
+    for (int p = 0; p < base->pass_count; p++) {
+        if (base->pass_ms[p] <= 0.0) continue;
+        
+        const char* kind = base->pass_parallel[p] ? "split" : "serial";
+        for (int t = 0; t < threads->count; t++) ms[t] = results[t].pass_ms[p];
+        sweep_print_row(base->pass_names[p], kind, threads, ms);
+        if (csv) sweep_write_csv_row(csv, workload, threads, base->pass_names[p], kind, ms);
+        if (!base->pass_parallel[p]) serial_ms += base->pass_ms[p];
+    }
+    
+    for (int t = 0; t < threads->count; t++) ms[t] = results[t].critical_ms;
+    sweep_print_row("critical path", "", threads, ms);
+    if (csv) sweep_write_csv_row(csv, workload, threads, "critical_path", "", ms);
+    
+    for (int t = 0; t < threads->count; t++) ms[t] = results[t].render_ms;
+    sweep_print_row("render", "", threads, ms);
+    if (csv) sweep_write_csv_row(csv, workload, threads, "render", "", ms);
+    int frame_scales_to = sweep_scales_to(threads, ms);
+    
+    for (int t = 0; t < threads->count; t++) ms[t] = results[t].update_ms;
+    sweep_print_row("simulation", "", threads, ms);
+    if (csv) sweep_write_csv_row(csv, workload, threads, "simulation", "", ms);
+    
+    // Serial passes may still overlap each other in the graph, so this is
+    // a bound, not a prediction
+    double serial = base->render_ms > 0.0 ? serial_ms / base->render_ms : 0.0;
+    printf("  Render stays above %.0f%% efficiency up to %d thread%s. Serial passes take %.1f%% of the\n",
+           SWEEP_EFFICIENCY_FLOOR * 100.0, frame_scales_to, frame_scales_to == 1 ? "" : "s", serial * 100.0);
+    printf("  one-thread frame; Amdahl limit %.2fx.\n", serial > 0.0 ? 1.0 / serial : 0.0);
+}
+
+// --- Main ---
+
+static void sweep_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--seed N | --replay FILE] [--frames N] [--warmup N] [--threads LIST]\n"
+                    "       [--lights LIST] [--sprites LIST] [--particles LIST] [--csv FILE]\n"
+                    "LIST is comma separated, e.g. --threads 1,2,4,8\n", program);
+}
+
+static bool sweep_parse(SweepOptions* options, int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            options->seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--replay") == 0 && has_value) {
+            options->replay_file = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && has_value) {
+            options->frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+            options->warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && has_value) {
+            if (!sweep_parse_list(&options->threads, argv[++i])) return false;
+        } else if (strcmp(argv[i], "--lights") == 0 && has_value) {
+            if (!sweep_parse_list(&options->lights, argv[++i])) return false;
+        } else if (strcmp(argv[i], "--sprites") == 0 && has_value) {
+            if (!sweep_parse_list(&options->sprites, argv[++i])) return false;
+        } else if (strcmp(argv[i], "--particles") == 0 && has_value) {
+            if (!sweep_parse_list(&options->particles, argv[++i])) return false;
+        } else if (strcmp(argv[i], "--csv") == 0 && has_value) {
+            options->csv_file = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    
+    for (int t = 0; t < options->threads.count; t++) {
+        if (options->threads.values[t] < 1 || options->threads.values[t] > THREADING_MAX_THREADS) return false;
+    }
+    return options->frames > 0 && options->warmup >= 0;
+}
+
+// The base workload, then each axis value on its own
+static int sweep_workloads(const SweepOptions* options, SweepWorkload* workloads) {
+    int count = 0;
+    workloads[count++] = (SweepWorkload){"base", 0, 0, 0};
+    
+    for (int i = 0; i < options->lights.count; i++) {
+        if (options->lights.values[i] > 0) {
+            workloads[count++] = (SweepWorkload){"lights", options->lights.values[i], 0, 0};
+        }
+    }
+    for (int i = 0; i < options->sprites.count; i++) {
+        if (options->sprites.values[i] > 0) {
+            workloads[count++] = (SweepWorkload){"sprites", 0, options->sprites.values[i], 0};
+        }
+    }
+    for (int i = 0; i < options->particles.count; i++) {
+        if (options->particles.values[i] > 0) {
+            workloads[count++] = (SweepWorkload){"particles", 0, 0, options->particles.values[i]};
+        }
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    SweepOptions options = {0};
+    options.seed = 1;
+    options.frames = 30;
+    options.warmup = 3;
+    sweep_default_threads(&options.threads);
+    sweep_parse_list(&options.lights, "8,32");
+    sweep_parse_list(&options.sprites, "64,256");
+    sweep_parse_list(&options.particles, "2000,8000");
+    
+    if (!sweep_parse(&options, argc, argv)) {
+        sweep_usage(argv[0]);
+        return 1;
+    }
+    if (options.replay_file && !replay_read_seed(options.replay_file, &options.seed)) {
+        fprintf(stderr, "Cannot read replay log %s\n", options.replay_file);
+        return 1;
+    }
+    
+    FILE* csv = NULL;
+    if (options.csv_file) {
+        csv = fopen(options.csv_file, "w");
+        if (!csv) {
+            fprintf(stderr, "Cannot write %s\n", options.csv_file);
+            return 1;
+        }
+        fprintf(csv, "workload,lights,sprites,particles,resolution,threads,pass,kind,ms,speedup,efficiency\n");
+    }
+    
+    static SweepWorkload workloads[SWEEP_MAX_WORKLOADS];
+    int workload_count = sweep_workloads(&options, workloads);
+    
+    printf("Scalability sweep: %s, %dx%d, %d frames after %d warm-up, %ld CPUs online\n",
+           options.replay_file ? options.replay_file : "demo scene", SCREEN_WIDTH, SCREEN_HEIGHT,
+           options.frames, options.warmup, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("Each cell: mean ms, speedup and efficiency against the first thread count.\n");
+    
+    SweepResult results[SWEEP_MAX_VALUES];
+    for (int w = 0; w < workload_count; w++) {
+        for (int t = 0; t < options.threads.count; t++) {
+            if (!sweep_run(&options, &workloads[w], options.threads.values[t], &results[t])) {
+                if (csv) fclose(csv);
+                return 1;
+            }
+        }
+        sweep_report(&workloads[w], &options.threads, results, csv);
+        if (csv) fflush(csv);
+    }
+    
+    if (csv) fclose(csv);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#!/bin/bash
+# Runs the scalability sweep at several internal resolutions. The resolution
+# is fixed at compile time, so each one gets its own build directory.
+#
+# Usage: tools/sweep_resolutions.sh [WxH ...] [-- raycast_sweep arguments]
+# Example: tools/sweep_resolutions.sh 640x360 1280x720 1920x1080 -- --frames 30
+# Writes sweep-WxH.csv for each resolution into the current directory.
+
+RESOLUTIONS=()
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    RESOLUTIONS+=("$1")
+    shift
+done
+[ "$1" == "--" ] && shift
+[ ${#RESOLUTIONS[@]} -eq 0 ] && RESOLUTIONS=(640x360 1280x720 1920x1080)
+
+for RES in "${RESOLUTIONS[@]}"; do
+    DIR="build/sweep-$RES"
+    echo "=== $RES ==="
+    make -s sweep RESOLUTION="$RES" BUILD_DIR="$DIR" BIN_DIR="$DIR/bin" || exit 1
+    "$DIR/bin/raycast_sweep" "$@" --csv "sweep-$RES.csv" || exit 1
+done